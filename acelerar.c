@@ -0,0 +1,120 @@
+/*
+// Aceleracao da iteracao de Jacobi
+// Sistemas Operativos, DEI/IST/ULisboa 2017-18
+*/
+
+#include "acelerar.h"
+
+#include <math.h>
+#include <string.h>
+
+/*--------------------------------------------------------------------
+| Function: aceleracaoPorNome
+| Description: Devolve 0 e o tipo em *tipo, ou -1 se o nome for
+|              desconhecido
+---------------------------------------------------------------------*/
+
+int aceleracaoPorNome(char const *nome, TipoAceleracao *tipo) {
+  if (strcmp(nome, "nenhuma") == 0)
+    *tipo = ACEL_NENHUMA;
+  else if (strcmp(nome, "chebyshev") == 0)
+    *tipo = ACEL_CHEBYSHEV;
+  else if (strcmp(nome, "anderson") == 0)
+    *tipo = ACEL_ANDERSON;
+  else
+    return -1;
+  return 0;
+}
+
+char const *aceleracaoNome(TipoAceleracao tipo) {
+  switch (tipo) {
+    case ACEL_CHEBYSHEV: return "chebyshev";
+    case ACEL_ANDERSON:  return "anderson";
+    default:             return "nenhuma";
+  }
+}
+
+/*--------------------------------------------------------------------
+| Function: chebyshevOmega
+---------------------------------------------------------------------*/
+
+double chebyshevOmega(int k, double omega_ant, double rho) {
+  if (k == 0)
+    return 1;
+  if (k == 1)
+    return 1 / (1 - rho * rho / 2);
+  return 1 / (1 - rho * rho * omega_ant / 4);
+}
+
+/*--------------------------------------------------------------------
+| Function: kernelChebyshev
+---------------------------------------------------------------------*/
+
+double kernelChebyshev(DoubleMatrix2D *de, DoubleMatrix2D *para,
+                       int ini, int fim, int N, double omega) {
+  double max_delta = 0;
+
+  for (int i = ini; i < fim; i++) {
+    double const *restrict cima  = dm2dGetLine(de, i-1);
+    double const *restrict meio  = dm2dGetLine(de, i);
+    double const *restrict baixo = dm2dGetLine(de, i+1);
+    double       *restrict saida = dm2dGetLine(para, i);
+
+    for (int j = 1; j <= N; j++) {
+      double val   = (cima[j] + baixo[j] + meio[j-1] + meio[j+1])/4;
+      double delta = fabs(val - meio[j]);
+      max_delta = delta > max_delta ? delta : max_delta;
+      saida[j] = saida[j] + omega * (val - saida[j]);
+    }
+  }
+  return max_delta;
+}
+
+/*--------------------------------------------------------------------
+| Function: andersonProdutos
+---------------------------------------------------------------------*/
+
+double andersonProdutos(DoubleMatrix2D *de, DoubleMatrix2D *ant, DoubleMatrix2D *g_ant,
+                        int ini, int fim, int N, double produtos[2]) {
+  double max_delta = 0, fdf = 0, dfdf = 0;
+
+  for (int i = ini; i < fim; i++) {
+    double const *restrict cima  = dm2dGetLine(de, i-1);
+    double const *restrict meio  = dm2dGetLine(de, i);
+    double const *restrict baixo = dm2dGetLine(de, i+1);
+    double const *restrict x_ant = dm2dGetLine(ant, i);
+    double const *restrict g     = dm2dGetLine(g_ant, i);
+
+    for (int j = 1; j <= N; j++) {
+      double f  = (cima[j] + baixo[j] + meio[j-1] + meio[j+1])/4 - meio[j];
+      double df = f - (g[j] - x_ant[j]);
+      max_delta = fabs(f) > max_delta ? fabs(f) : max_delta;
+      fdf  += f * df;
+      dfdf += df * df;
+    }
+  }
+  produtos[0] += fdf;
+  produtos[1] += dfdf;
+  return max_delta;
+}
+
+/*--------------------------------------------------------------------
+| Function: andersonAtualizar
+---------------------------------------------------------------------*/
+
+void andersonAtualizar(DoubleMatrix2D *de, DoubleMatrix2D *ant, DoubleMatrix2D *g_ant,
+                       int ini, int fim, int N, double theta) {
+  for (int i = ini; i < fim; i++) {
+    double const *restrict cima  = dm2dGetLine(de, i-1);
+    double const *restrict meio  = dm2dGetLine(de, i);
+    double const *restrict baixo = dm2dGetLine(de, i+1);
+    double       *restrict x     = dm2dGetLine(ant, i);
+    double       *restrict g     = dm2dGetLine(g_ant, i);
+
+    for (int j = 1; j <= N; j++) {
+      double val = (cima[j] + baixo[j] + meio[j-1] + meio[j+1])/4;
+      x[j] = val - theta * (val - g[j]);
+      g[j] = val;
+    }
+  }
+}
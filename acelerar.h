@@ -0,0 +1,66 @@
+/*
+// Aceleracao da iteracao de Jacobi
+// Sistemas Operativos, DEI/IST/ULisboa 2017-18
+//
+// Chebyshev: x(k+1) = x(k-1) + w(k+1) * (J x(k) - x(k-1)), com
+//   w(1) = 1, w(2) = 1/(1 - rho^2/2), w(k+1) = 1/(1 - rho^2 w(k)/4)
+// e rho = cos(pi/(N+1)), o raio espectral de Jacobi na grelha
+// uniforme. x(k-1) esta' na matriz de destino, que e' actualizada
+// ponto a ponto, pelo que bastam as duas matrizes de sempre.
+//
+// Anderson com historia 1: com g(k) = J x(k) e f(k) = g(k) - x(k),
+//   x(k+1) = g(k) - theta * (g(k) - g(k-1)),
+//   theta  = <f(k), df> / <df, df>,  df = f(k) - f(k-1)
+// g(k-1) fica numa terceira matriz e x(k-1) na de destino. Os produtos
+// internos precisam de uma reducao a meio de cada iteracao.
+//
+// Em ambos os casos o delta devolvido e' max |J x(k) - x(k)|, o mesmo
+// criterio de paragem de Jacobi.
+*/
+
+#ifndef ACELERAR_H
+#define ACELERAR_H
+
+#include "matrix2d.h"
+
+typedef enum {
+  ACEL_NENHUMA,
+  ACEL_CHEBYSHEV,
+  ACEL_ANDERSON
+} TipoAceleracao;
+
+int         aceleracaoPorNome(char const *nome, TipoAceleracao *tipo);
+char const *aceleracaoNome(TipoAceleracao tipo);
+
+/*--------------------------------------------------------------------
+| Function: chebyshevOmega
+| Description: Peso da iteracao k (a partir de 0), dado o da anterior
+---------------------------------------------------------------------*/
+double chebyshevOmega(int k, double omega_ant, double rho);
+
+/*--------------------------------------------------------------------
+| Function: kernelChebyshev
+| Description: Linhas [ini, fim[: para = para + omega*(J de - para)
+---------------------------------------------------------------------*/
+double kernelChebyshev(DoubleMatrix2D *de, DoubleMatrix2D *para,
+                       int ini, int fim, int N, double omega);
+
+/*--------------------------------------------------------------------
+| Function: andersonProdutos
+| Description: Primeira passagem de Anderson, so' de leitura: soma em
+|              produtos[0] e produtos[1] as contribuicoes das linhas
+|              [ini, fim[ para <f, df> e <df, df>. 'ant' tem x(k-1) e
+|              'g_ant' tem g(k-1).
+---------------------------------------------------------------------*/
+double andersonProdutos(DoubleMatrix2D *de, DoubleMatrix2D *ant, DoubleMatrix2D *g_ant,
+                        int ini, int fim, int N, double produtos[2]);
+
+/*--------------------------------------------------------------------
+| Function: andersonAtualizar
+| Description: Segunda passagem: escreve x(k+1) em 'ant' e g(k) em
+|              'g_ant'. Com theta = 0 e' uma iteracao de Jacobi.
+---------------------------------------------------------------------*/
+void   andersonAtualizar(DoubleMatrix2D *de, DoubleMatrix2D *ant, DoubleMatrix2D *g_ant,
+                         int ini, int fim, int N, double theta);
+
+#endif
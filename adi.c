@@ -0,0 +1,142 @@
+/*
+// Passos implicitos ADI (Peaceman-Rachford) para a equacao do calor
+// Sistemas Operativos, DEI/IST/ULisboa 2017-18
+*/
+
+#include "adi.h"
+
+#include <stdlib.h>
+#include <math.h>
+
+/*--------------------------------------------------------------------
+| Function: adiPlano
+| Description: Pre-calcula a eliminacao de Thomas para a matriz
+|              tridiagonal (-r, 1+2r, -r) de ordem N
+---------------------------------------------------------------------*/
+
+PlanoADI *adiPlano(int N, double dt) {
+  PlanoADI *p = (PlanoADI*) malloc(sizeof(PlanoADI));
+  if (p == NULL)
+    return NULL;
+
+  p->N     = N;
+  p->r     = dt * (N + 1) * (N + 1) / 2;
+  p->c     = (double*) malloc(N * sizeof(double));
+  p->inv_m = (double*) malloc(N * sizeof(double));
+  p->segundo = dm2dNew(N+2, N+2);
+  if (p->c == NULL || p->inv_m == NULL || p->segundo == NULL) {
+    adiLibertar(p);
+    return NULL;
+  }
+
+  double a = -p->r, b = 1 + 2 * p->r;
+  for (int i = 0; i < N; i++) {
+    double m = i == 0 ? b : b - a * p->c[i-1];
+    p->inv_m[i] = 1 / m;
+    p->c[i]     = a / m;
+  }
+  return p;
+}
+
+void adiLibertar(PlanoADI *p) {
+  free(p->c);
+  free(p->inv_m);
+  if (p->segundo != NULL)
+    dm2dFree(p->segundo);
+  free(p);
+}
+
+/*--------------------------------------------------------------------
+| Function: adiLinhas
+---------------------------------------------------------------------*/
+
+double adiLinhas(PlanoADI const *p, DoubleMatrix2D *de, DoubleMatrix2D *para, int ini, int fim) {
+  int    N = p->N;
+  double r = p->r;
+  double max_delta = 0;
+
+  for (int i = ini; i < fim; i++) {
+    double const *restrict cima  = dm2dGetLine(de, i-1);
+    double const *restrict meio  = dm2dGetLine(de, i);
+    double const *restrict baixo = dm2dGetLine(de, i+1);
+    double       *restrict x     = dm2dGetLine(para, i);
+
+    // eliminacao: x(j) guarda d'(j)
+    double ant = 0;
+    for (int j = 1; j <= N; j++) {
+      double d = (1 - 2*r) * meio[j] + r * (cima[j] + baixo[j]);
+      if (j == 1) d += r * meio[0];
+      if (j == N) d += r * meio[N+1];
+      ant  = (d + r * ant) * p->inv_m[j-1];
+      x[j] = ant;
+    }
+    // substituicao para tras
+    for (int j = N - 1; j >= 1; j--)
+      x[j] -= p->c[j-1] * x[j+1];
+    for (int j = 1; j <= N; j++) {
+      double delta = fabs(x[j] - meio[j]);
+      max_delta = delta > max_delta ? delta : max_delta;
+    }
+  }
+  return max_delta;
+}
+
+/*--------------------------------------------------------------------
+| Function: adiSegundoMembro
+---------------------------------------------------------------------*/
+
+void adiSegundoMembro(PlanoADI const *p, DoubleMatrix2D *de, DoubleMatrix2D *para,
+                      int ini, int fim) {
+  int    N = p->N;
+  double r = p->r;
+
+  for (int i = 1; i <= N; i++) {
+    double const *restrict u = dm2dGetLine(para, i);
+    double       *restrict d = dm2dGetLine(p->segundo, i);
+    for (int j = ini; j < fim; j++)
+      d[j] = (1 - 2*r) * u[j] + r * (u[j-1] + u[j+1]);
+  }
+  // fronteiras de cima e de baixo, iguais nas duas matrizes
+  double const *sup = dm2dGetLine(de, 0), *inf = dm2dGetLine(de, N+1);
+  double       *d1  = dm2dGetLine(p->segundo, 1), *dN = dm2dGetLine(p->segundo, N);
+  for (int j = ini; j < fim; j++) {
+    d1[j] += r * sup[j];
+    dN[j] += r * inf[j];
+  }
+}
+
+/*--------------------------------------------------------------------
+| Function: adiColunas
+---------------------------------------------------------------------*/
+
+void adiColunas(PlanoADI const *p, DoubleMatrix2D *para, int ini, int fim) {
+  int             N = p->N;
+  double          r = p->r;
+  DoubleMatrix2D *de = p->segundo;
+
+  // eliminacao, linha a linha, para todas as colunas do bloco
+  double *restrict d = dm2dGetLine(de, 1);
+  for (int j = ini; j < fim; j++)
+    d[j] *= p->inv_m[0];
+  for (int i = 2; i <= N; i++) {
+    double const *restrict ant = dm2dGetLine(de, i-1);
+    double        inv_m = p->inv_m[i-1];
+    d = dm2dGetLine(de, i);
+    for (int j = ini; j < fim; j++)
+      d[j] = (d[j] + r * ant[j]) * inv_m;
+  }
+
+  // substituicao para tras, escrevendo em 'para'
+  double const *restrict dN = dm2dGetLine(de, N);
+  double       *restrict xN = dm2dGetLine(para, N);
+  for (int j = ini; j < fim; j++)
+    xN[j] = dN[j];
+  for (int i = N - 1; i >= 1; i--) {
+    double const *restrict di   = dm2dGetLine(de, i);
+    double const *restrict xseg = dm2dGetLine(para, i+1);
+    double       *restrict x    = dm2dGetLine(para, i);
+    double        c = p->c[i-1];
+    for (int j = ini; j < fim; j++)
+      x[j] = di[j] - c * xseg[j];
+  }
+}
@@ -0,0 +1,62 @@
+/*
+// Passos implicitos ADI (Peaceman-Rachford) para a equacao do calor
+// Sistemas Operativos, DEI/IST/ULisboa 2017-18
+//
+// u_t = Laplaciano(u) no quadrado unitario, com espacamento
+// h = 1/(N+1) e r = dt/(2h^2). Cada passo tem dois meios passos:
+//   (1+2r)u* - r(u*[i,j-1] + u*[i,j+1]) = (1-2r)u + r(u[i-1,j] + u[i+1,j])
+//   (1+2r)v  - r(v[i-1,j]  + v[i+1,j])  = (1-2r)u* + r(u*[i,j-1] + u*[i,j+1])
+// O primeiro resolve um sistema tridiagonal por linha e o segundo um
+// por coluna, ambos pelo algoritmo de Thomas. Os coeficientes sao
+// constantes, pelo que a eliminacao (c' e 1/m) e' calculada uma vez.
+//
+// Com as matrizes de/para de Jacobi, um passo e':
+//   adiLinhas:        u* (em 'para') a partir de u (em 'de')
+//   adiSegundoMembro: segundo membro do segundo meio passo, no plano
+//   adiColunas:       v (em 'para') a partir do segundo membro
+// com uma barreira entre cada fase. 'de' so' e' lida: continua a ser a
+// iteracao anterior inteira, que a salvaguarda pode copiar a meio. As colunas sao resolvidas em lote:
+// o varrimento percorre as linhas e, em cada uma, as colunas do bloco,
+// pelo que os acessos sao sempre contiguos.
+*/
+
+#ifndef ADI_H
+#define ADI_H
+
+#include "matrix2d.h"
+
+typedef struct {
+  int     N;
+  double  r;
+  double *c;        // c'(i) da eliminacao, i = 1..N (indice i-1)
+  double *inv_m;    // 1 / (b - a c'(i-1))
+  DoubleMatrix2D *segundo;  // segundo membro, (N+2) x (N+2), partilhado
+} PlanoADI;
+
+PlanoADI *adiPlano(int N, double dt);
+void      adiLibertar(PlanoADI *p);
+
+/*--------------------------------------------------------------------
+| Function: adiLinhas
+| Description: Primeiro meio passo para as linhas [ini, fim[. Devolve
+|              max |u* - u| dessas linhas.
+---------------------------------------------------------------------*/
+double    adiLinhas(PlanoADI const *p, DoubleMatrix2D *de, DoubleMatrix2D *para, int ini, int fim);
+
+/*--------------------------------------------------------------------
+| Function: adiSegundoMembro
+| Description: Escreve em p->segundo, nas colunas [ini, fim[, o
+|              segundo membro do segundo meio passo, calculado a partir
+|              de u* em 'para' e das fronteiras de 'de'
+---------------------------------------------------------------------*/
+void      adiSegundoMembro(PlanoADI const *p, DoubleMatrix2D *de, DoubleMatrix2D *para,
+                           int ini, int fim);
+
+/*--------------------------------------------------------------------
+| Function: adiColunas
+| Description: Resolve as colunas [ini, fim[: eliminacao em
+|              p->segundo e substituicao para tras em 'para'
+---------------------------------------------------------------------*/
+void      adiColunas(PlanoADI const *p, DoubleMatrix2D *para, int ini, int fim);
+
+#endif
@@ -0,0 +1,266 @@
+/*
+// Afinacao automatica de parametros do heatSim
+// Sistemas Operativos, DEI/IST/ULisboa 2017-18
+*/
+
+#include "afinacao.h"
+#include "medicao.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define MAX_LINHAS_FICHEIRO 1024
+
+/*--------------------------------------------------------------------
+| Function: ler_cache_sysfs
+| Description: Le o tamanho (em bytes) da cache de nivel 'nivel' de
+|              dados ou unificada do cpu0 a partir do sysfs
+---------------------------------------------------------------------*/
+
+static long ler_cache_sysfs(int nivel) {
+  for (int idx = 0; idx < 8; idx++) {
+    char  caminho[128], tipo[32];
+    int   lvl = 0;
+    long  tam = 0;
+    char  unidade = 0;
+    FILE *f;
+
+    snprintf(caminho, sizeof(caminho), "/sys/devices/system/cpu/cpu0/cache/index%d/level", idx);
+    if ((f = fopen(caminho, "r")) == NULL)
+      break;
+    if (fscanf(f, "%d", &lvl) != 1)
+      lvl = 0;
+    fclose(f);
+
+    snprintf(caminho, sizeof(caminho), "/sys/devices/system/cpu/cpu0/cache/index%d/type", idx);
+    if ((f = fopen(caminho, "r")) == NULL)
+      continue;
+    if (fscanf(f, "%31s", tipo) != 1)
+      tipo[0] = 0;
+    fclose(f);
+
+    if (lvl != nivel || strcmp(tipo, "Instruction") == 0)
+      continue;
+
+    snprintf(caminho, sizeof(caminho), "/sys/devices/system/cpu/cpu0/cache/index%d/size", idx);
+    if ((f = fopen(caminho, "r")) == NULL)
+      continue;
+    if (fscanf(f, "%ld%c", &tam, &unidade) < 1)
+      tam = 0;
+    fclose(f);
+
+    if (unidade == 'K')
+      tam <<= 10;
+    else if (unidade == 'M')
+      tam <<= 20;
+    return tam;
+  }
+  return 0;
+}
+
+/*--------------------------------------------------------------------
+| Function: maquinaDetectar
+---------------------------------------------------------------------*/
+
+void maquinaDetectar(Maquina *m, int medir) {
+  char  linha[256];
+  FILE *f = fopen("/proc/cpuinfo", "r");
+
+  snprintf(m->modelo, sizeof(m->modelo), "desconhecido");
+  while (f != NULL && fgets(linha, sizeof(linha), f) != NULL) {
+    char *p = strchr(linha, ':');
+    if (p == NULL || (strncmp(linha, "model name", 10) != 0 &&
+                      strncmp(linha, "Model", 5) != 0 &&
+                      strncmp(linha, "cpu model", 9) != 0))
+      continue;
+    for (p++; *p == ' ' || *p == '\t'; p++)
+      ;
+    p[strcspn(p, "\n")] = 0;
+    snprintf(m->modelo, sizeof(m->modelo), "%s", p);
+    break;
+  }
+  if (f != NULL)
+    fclose(f);
+  // o separador do ficheiro de afinacao nao pode aparecer no modelo
+  for (char *c = m->modelo; *c; c++)
+    if (*c == '|')
+      *c = '/';
+
+  m->ncpus = (int) sysconf(_SC_NPROCESSORS_ONLN);
+  if (m->ncpus < 1)
+    m->ncpus = 1;
+
+  m->cache_l1 = sysconf(_SC_LEVEL1_DCACHE_SIZE);
+  m->cache_l2 = sysconf(_SC_LEVEL2_CACHE_SIZE);
+  m->cache_l3 = sysconf(_SC_LEVEL3_CACHE_SIZE);
+  if (m->cache_l1 <= 0) m->cache_l1 = ler_cache_sysfs(1);
+  if (m->cache_l2 <= 0) m->cache_l2 = ler_cache_sysfs(2);
+  if (m->cache_l3 <= 0) m->cache_l3 = ler_cache_sysfs(3);
+  if (m->cache_l1 <= 0) m->cache_l1 = 32 << 10;
+  if (m->cache_l2 <= 0) m->cache_l2 = 256 << 10;
+
+  m->largura_banda = 0;
+  if (medir) {
+    // vectores bem maiores do que a ultima cache, mas sem exagerar
+    size_t bytes = 64u << 20;
+    if (m->cache_l3 > 0 && (size_t) m->cache_l3 * 2 > bytes)
+      bytes = (size_t) m->cache_l3 * 2;
+    if (bytes > (512u << 20))
+      bytes = 512u << 20;
+    m->largura_banda = medirLarguraBandaCopia(bytes, 5);
+  }
+}
+
+/*--------------------------------------------------------------------
+| Function: afinacaoFaixa
+---------------------------------------------------------------------*/
+
+int afinacaoFaixa(int N) {
+  int f = 0;
+  while (N > 1) {
+    N >>= 1;
+    f++;
+  }
+  return f;
+}
+
+/*--------------------------------------------------------------------
+| Function: potencia_abaixo
+| Description: Maior potencia de 2 menor ou igual a x (minimo 8)
+---------------------------------------------------------------------*/
+
+static int potencia_abaixo(long x) {
+  int p = 8;
+  while ((long) p * 2 <= x)
+    p *= 2;
+  return p;
+}
+
+/*--------------------------------------------------------------------
+| Function: afinacaoCandidatas
+---------------------------------------------------------------------*/
+
+int afinacaoCandidatas(Maquina const *m, int N, Configuracao *cand) {
+  int trabs[32], nt = 0;
+  int blocos[4], nb = 0;
+  int n = 0;
+
+  // numeros de tarefas: potencias de 2 ate' 2x os CPUs, e o proprio
+  // numero de CPUs, desde que dividam N
+  for (int t = 1; t <= 2 * m->ncpus && nt < 31; t *= 2)
+    if (N % t == 0)
+      trabs[nt++] = t;
+  if (N % m->ncpus == 0 && (m->ncpus & (m->ncpus - 1)) != 0)
+    trabs[nt++] = m->ncpus;
+
+  // blocos de colunas cujas 4 linhas (3 lidas, 1 escrita) cabem em
+  // metade da L1 e da L2
+  int b1 = potencia_abaixo(m->cache_l1 / (4 * 8 * 2));
+  int b2 = potencia_abaixo(m->cache_l2 / (4 * 8 * 2));
+  if (b1 < N) blocos[nb++] = b1;
+  if (b2 < N && b2 != b1) blocos[nb++] = b2;
+
+  for (int t = 0; t < nt; t++)
+  for (int k = 0; k < 2 + nb; k++)
+  for (int a = 0; a < (m->ncpus > 1 ? 2 : 1); a++)
+  for (int b = 0; b < 2; b++) {
+    Configuracao *c = &cand[n];
+
+    // espera activa com mais tarefas do que CPUs so' desperdica tempo
+    if (b == 1 && trabs[t] > m->ncpus)
+      continue;
+    if (n >= AFINACAO_MAX_CAND)
+      return n;
+
+    c->trab = trabs[t];
+    c->afinidade = a;
+    c->barreira = b ? BARREIRA_SPIN : BARREIRA_COND;
+    c->tempo_iter = 0;
+    // blocos com bloco == N seria igual a linhas
+    snprintf(c->kernel, sizeof(c->kernel), "%s", k == 0 ? "simples" : k == 1 ? "linhas" : "blocos");
+    c->bloco = k < 2 ? N : blocos[k - 2];
+    n++;
+  }
+  return n;
+}
+
+/*--------------------------------------------------------------------
+| Function: ler_linha
+| Description: Interpreta uma linha do ficheiro de afinacao:
+|              modelo|faixa|trab|kernel|bloco|afinidade|barreira|tempo
+---------------------------------------------------------------------*/
+
+static int ler_linha(char *linha, char *modelo, int *faixa, Configuracao *c) {
+  char barreira[AFINACAO_TAM_NOME];
+  char *sep = strchr(linha, '|');
+
+  if (sep == NULL || linha[0] == '#')
+    return -1;
+  *sep = 0;
+  snprintf(modelo, 128, "%s", linha);
+  *sep = '|';
+  if (sscanf(sep + 1, "%d|%d|%31[^|]|%d|%d|%31[^|]|%lf", faixa, &c->trab, c->kernel,
+             &c->bloco, &c->afinidade, barreira, &c->tempo_iter) != 7)
+    return -1;
+  return barreiraPorNome(barreira, &c->barreira);
+}
+
+/*--------------------------------------------------------------------
+| Function: afinacaoCarregar
+---------------------------------------------------------------------*/
+
+int afinacaoCarregar(char const *fich, char const *modelo, int faixa, Configuracao *c) {
+  FILE *f = fopen(fich, "r");
+  char  linha[512], m[128];
+  int   fx, encontrou = -1;
+
+  if (f == NULL)
+    return -1;
+  while (fgets(linha, sizeof(linha), f) != NULL) {
+    Configuracao lida;
+    if (ler_linha(linha, m, &fx, &lida) == 0 && fx == faixa && strcmp(m, modelo) == 0) {
+      *c = lida;
+      encontrou = 0;
+    }
+  }
+  fclose(f);
+  return encontrou;
+}
+
+/*--------------------------------------------------------------------
+| Function: afinacaoGuardar
+---------------------------------------------------------------------*/
+
+int afinacaoGuardar(char const *fich, char const *modelo, int faixa, Configuracao const *c) {
+  static char linhas[MAX_LINHAS_FICHEIRO][512];
+  char  tmp[512], m[128];
+  int   n = 0, fx;
+  FILE *f = fopen(fich, "r");
+
+  // manter as entradas das outras maquinas e faixas
+  while (f != NULL && n < MAX_LINHAS_FICHEIRO && fgets(linhas[n], sizeof(linhas[n]), f) != NULL) {
+    Configuracao lida;
+    char copia[512];
+    snprintf(copia, sizeof(copia), "%s", linhas[n]);
+    if (ler_linha(copia, m, &fx, &lida) == 0 && fx == faixa && strcmp(m, modelo) == 0)
+      continue;
+    n++;
+  }
+  if (f != NULL)
+    fclose(f);
+
+  snprintf(tmp, sizeof(tmp), "%s~", fich);
+  if ((f = fopen(tmp, "w")) == NULL)
+    return -1;
+  if (n == 0)
+    fprintf(f, "# modelo|faixa(log2 N)|trab|kernel|bloco|afinidade|barreira|s/iter\n");
+  for (int i = 0; i < n; i++)
+    fputs(linhas[i], f);
+  fprintf(f, "%s|%d|%d|%s|%d|%d|%s|%.6e\n", modelo, faixa, c->trab, c->kernel,
+          c->bloco, c->afinidade, barreiraNome(c->barreira), c->tempo_iter);
+  if (fclose(f) != 0)
+    return -1;
+  return rename(tmp, fich);
+}
@@ -0,0 +1,81 @@
+/*
+// Afinacao automatica de parametros do heatSim
+// Sistemas Operativos, DEI/IST/ULisboa 2017-18
+*/
+
+#ifndef AFINACAO_H
+#define AFINACAO_H
+
+#include "barreira.h"
+
+#define AFINACAO_FICHEIRO  "heatSim.afinacao"
+#define AFINACAO_TAM_NOME  32
+#define AFINACAO_MAX_CAND  256
+
+/*--------------------------------------------------------------------
+| Type: Configuracao
+| Description: Parametros de execucao escolhidos pela afinacao
+---------------------------------------------------------------------*/
+
+typedef struct {
+  int          trab;
+  char         kernel[AFINACAO_TAM_NOME];
+  int          bloco;
+  int          afinidade;
+  TipoBarreira barreira;
+  double       tempo_iter;
+} Configuracao;
+
+/*--------------------------------------------------------------------
+| Type: Maquina
+| Description: Caracteristicas medidas ou lidas do sistema
+---------------------------------------------------------------------*/
+
+typedef struct {
+  char   modelo[128];
+  int    ncpus;
+  long   cache_l1;
+  long   cache_l2;
+  long   cache_l3;
+  double largura_banda;   // GB/s, copia ao estilo STREAM
+} Maquina;
+
+/*--------------------------------------------------------------------
+| Function: maquinaDetectar
+| Description: Preenche modelo do CPU, numero de CPUs e tamanhos de
+|              cache. Se 'medir' for diferente de 0 mede tambem a
+|              largura de banda de memoria.
+---------------------------------------------------------------------*/
+void maquinaDetectar(Maquina *m, int medir);
+
+/*--------------------------------------------------------------------
+| Function: afinacaoFaixa
+| Description: Faixa de N usada como chave da cache de afinacao
+|              (floor(log2 N)); tamanhos da mesma faixa partilham a
+|              melhor configuracao.
+---------------------------------------------------------------------*/
+int  afinacaoFaixa(int N);
+
+/*--------------------------------------------------------------------
+| Function: afinacaoCandidatas
+| Description: Gera as configuracoes candidatas para N pontos
+|              interiores em 'cand' (no maximo AFINACAO_MAX_CAND).
+|              Devolve o numero de candidatas.
+---------------------------------------------------------------------*/
+int  afinacaoCandidatas(Maquina const *m, int N, Configuracao *cand);
+
+/*--------------------------------------------------------------------
+| Function: afinacaoCarregar
+| Description: Procura no ficheiro a configuracao guardada para o
+|              modelo de CPU e faixa de N. Devolve 0 se encontrou.
+---------------------------------------------------------------------*/
+int  afinacaoCarregar(char const *fich, char const *modelo, int faixa, Configuracao *c);
+
+/*--------------------------------------------------------------------
+| Function: afinacaoGuardar
+| Description: Guarda (ou substitui) a configuracao para o modelo de
+|              CPU e faixa de N. Devolve 0 em caso de sucesso.
+---------------------------------------------------------------------*/
+int  afinacaoGuardar(char const *fich, char const *modelo, int faixa, Configuracao const *c);
+
+#endif
@@ -0,0 +1,180 @@
+/*
+// Arranque a quente: armazem de solucoes e interpolacao
+// Sistemas Operativos, DEI/IST/ULisboa 2017-18
+*/
+
+#include "arranque.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+/*--------------------------------------------------------------------
+| Type: CabecalhoSolucao
+---------------------------------------------------------------------*/
+
+typedef struct {
+  char    magico[4];
+  int32_t N;
+  int32_t iteracoes;
+  int32_t reservado;
+  double  t[4];
+  double  maxD;
+} CabecalhoSolucao;
+
+/*--------------------------------------------------------------------
+| Function: arranqueGuardar
+---------------------------------------------------------------------*/
+
+int arranqueGuardar(char const *dir, DoubleMatrix2D *m, SolucaoGuardada const *s) {
+  char             nome[512], tmp[520];
+  CabecalhoSolucao cab;
+  size_t           pontos = (size_t) m->n_l * m->n_c;
+
+  mkdir(dir, 0755);
+  snprintf(nome, sizeof(nome), "%s/sol_N%d_%g_%g_%g_%g.bin", dir, s->N,
+           s->t[0], s->t[1], s->t[2], s->t[3]);
+  snprintf(tmp, sizeof(tmp), "%s~", nome);
+
+  memcpy(cab.magico, "HSWS", 4);
+  cab.N         = s->N;
+  cab.iteracoes = s->iteracoes;
+  cab.reservado = 0;
+  memcpy(cab.t, s->t, sizeof(cab.t));
+  cab.maxD      = s->maxD;
+
+  FILE *f = fopen(tmp, "wb");
+  if (f == NULL)
+    return -1;
+  if (fwrite(&cab, sizeof(cab), 1, f) != 1 || fwrite(m->data, sizeof(double), pontos, f) != pontos) {
+    fclose(f);
+    unlink(tmp);
+    return -1;
+  }
+  if (fclose(f) != 0)
+    return -1;
+  return rename(tmp, nome);
+}
+
+/*--------------------------------------------------------------------
+| Function: distancia
+---------------------------------------------------------------------*/
+
+static double distancia(int N, double const t[4], CabecalhoSolucao const *c) {
+  double escala = 1e-12, d = 0;
+
+  for (int b = 0; b < 4; b++) {
+    escala = fabs(t[b]) > escala ? fabs(t[b]) : escala;
+    d += fabs(t[b] - c->t[b]);
+  }
+  d /= escala;
+  // uma solucao de outro tamanho tem de ser interpolada
+  if (c->N != N)
+    d += fabs(log2((double) c->N / N));
+  return d;
+}
+
+/*--------------------------------------------------------------------
+| Function: arranqueProcurar
+---------------------------------------------------------------------*/
+
+DoubleMatrix2D *arranqueProcurar(char const *dir, int N, double const t[4], SolucaoGuardada *s) {
+  DIR             *d = opendir(dir);
+  struct dirent   *ent;
+  char             melhor[512] = "", nome[512];
+  double           melhor_dist = INFINITY;
+  CabecalhoSolucao cab, melhor_cab;
+
+  if (d == NULL)
+    return NULL;
+
+  while ((ent = readdir(d)) != NULL) {
+    if (strncmp(ent->d_name, "sol_", 4) != 0)
+      continue;
+    snprintf(nome, sizeof(nome), "%s/%s", dir, ent->d_name);
+    FILE *f = fopen(nome, "rb");
+    if (f == NULL)
+      continue;
+    if (fread(&cab, sizeof(cab), 1, f) == 1 && memcmp(cab.magico, "HSWS", 4) == 0 &&
+        cab.N > 0 && distancia(N, t, &cab) < melhor_dist) {
+      melhor_dist = distancia(N, t, &cab);
+      melhor_cab  = cab;
+      snprintf(melhor, sizeof(melhor), "%s", nome);
+    }
+    fclose(f);
+  }
+  closedir(d);
+
+  if (melhor[0] == 0)
+    return NULL;
+
+  FILE *f = fopen(melhor, "rb");
+  if (f == NULL)
+    return NULL;
+  DoubleMatrix2D *m = dm2dNew(melhor_cab.N + 2, melhor_cab.N + 2);
+  size_t pontos = (size_t) (melhor_cab.N + 2) * (melhor_cab.N + 2);
+  if (m == NULL || fseek(f, sizeof(cab), SEEK_SET) != 0 ||
+      fread(m->data, sizeof(double), pontos, f) != pontos) {
+    fclose(f);
+    if (m != NULL)
+      dm2dFree(m);
+    return NULL;
+  }
+  fclose(f);
+
+  s->N         = melhor_cab.N;
+  s->iteracoes = melhor_cab.iteracoes;
+  s->maxD      = melhor_cab.maxD;
+  memcpy(s->t, melhor_cab.t, sizeof(s->t));
+  return m;
+}
+
+/*--------------------------------------------------------------------
+| Function: arranqueInterpolar
+---------------------------------------------------------------------*/
+
+void arranqueInterpolar(DoubleMatrix2D *orig, DoubleMatrix2D *dest) {
+  // o dominio [0, n+1] de cada matriz corresponde ao mesmo quadrado
+  double esc_l = (double) (orig->n_l - 1) / (dest->n_l - 1);
+  double esc_c = (double) (orig->n_c - 1) / (dest->n_c - 1);
+
+  for (int i = 1; i < dest->n_l - 1; i++) {
+    double y  = i * esc_l;
+    int    i0 = (int) y;
+    double fy = y - i0;
+    if (i0 >= orig->n_l - 1) {
+      i0 = orig->n_l - 2;
+      fy = 1;
+    }
+    for (int j = 1; j < dest->n_c - 1; j++) {
+      double x  = j * esc_c;
+      int    j0 = (int) x;
+      double fx = x - j0;
+      if (j0 >= orig->n_c - 1) {
+        j0 = orig->n_c - 2;
+        fx = 1;
+      }
+      double v = (1 - fy) * ((1 - fx) * dm2dGetEntry(orig, i0,   j0) + fx * dm2dGetEntry(orig, i0,   j0+1)) +
+                 fy       * ((1 - fx) * dm2dGetEntry(orig, i0+1, j0) + fx * dm2dGetEntry(orig, i0+1, j0+1));
+      dm2dSetEntry(dest, i, j, v);
+    }
+  }
+}
+
+/*--------------------------------------------------------------------
+| Function: arranqueIteracoesFrio
+---------------------------------------------------------------------*/
+
+double arranqueIteracoesFrio(int N, double const t[4], double maxD) {
+  double tmax = 0;
+  for (int b = 0; b < 4; b++)
+    tmax = fabs(t[b]) > tmax ? fabs(t[b]) : tmax;
+  if (maxD <= 0 || tmax / 4 <= maxD)
+    return 1;
+  return 1 + log(maxD / (tmax / 4)) / log(cos(M_PI / (N + 1)));
+}
@@ -0,0 +1,61 @@
+/*
+// Arranque a quente: armazem de solucoes e interpolacao
+// Sistemas Operativos, DEI/IST/ULisboa 2017-18
+//
+// Cada solucao fica em DIR/sol_N<N>_<tEsq>_<tSup>_<tDir>_<tInf>.bin com
+// o cabecalho "HSWS", int32 N, int32 iteracoes, double tEsq, tSup,
+// tDir, tInf, maxD, seguido de (N+2)*(N+2) doubles.
+*/
+
+#ifndef ARRANQUE_H
+#define ARRANQUE_H
+
+#include "matrix2d.h"
+
+/*--------------------------------------------------------------------
+| Type: SolucaoGuardada
+| Description: Descricao de uma solucao do armazem
+---------------------------------------------------------------------*/
+
+typedef struct {
+  int    N;
+  int    iteracoes;
+  double t[4];      // tEsq, tSup, tDir, tInf
+  double maxD;
+} SolucaoGuardada;
+
+/*--------------------------------------------------------------------
+| Function: arranqueGuardar
+| Description: Guarda a solucao m (N x N pontos interiores) no
+|              armazem. Devolve 0 em caso de sucesso.
+---------------------------------------------------------------------*/
+int             arranqueGuardar(char const *dir, DoubleMatrix2D *m, SolucaoGuardada const *s);
+
+/*--------------------------------------------------------------------
+| Function: arranqueProcurar
+| Description: Procura no armazem a solucao mais proxima do caso
+|              pedido: a distancia e' a soma das diferencas das
+|              temperaturas de fronteira, relativa ao seu maximo,
+|              mais uma penalizacao para um N diferente. Devolve a
+|              matriz lida (e a descricao em *s) ou NULL.
+---------------------------------------------------------------------*/
+DoubleMatrix2D *arranqueProcurar(char const *dir, int N, double const t[4], SolucaoGuardada *s);
+
+/*--------------------------------------------------------------------
+| Function: arranqueInterpolar
+| Description: Preenche os pontos interiores de 'dest' por
+|              interpolacao bilinear dos de 'orig', que pode ter outro
+|              tamanho. As fronteiras de 'dest' nao sao alteradas.
+---------------------------------------------------------------------*/
+void            arranqueInterpolar(DoubleMatrix2D *orig, DoubleMatrix2D *dest);
+
+/*--------------------------------------------------------------------
+| Function: arranqueIteracoesFrio
+| Description: Estimativa das iteracoes de Jacobi necessarias a partir
+|              do interior a zero: o delta da primeira iteracao e'
+|              cerca de max|t|/4 e decai com o raio espectral
+|              cos(pi/(N+1)).
+---------------------------------------------------------------------*/
+double          arranqueIteracoesFrio(int N, double const t[4], double maxD);
+
+#endif
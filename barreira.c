@@ -0,0 +1,212 @@
+/*
+// Barreira dupla com max-reduction
+// Sistemas Operativos, DEI/IST/ULisboa 2017-18
+*/
+
+#include "barreira.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+
+// numero de voltas de espera activa antes de ceder o CPU
+#define SPIN_VOLTAS 256
+
+/*--------------------------------------------------------------------
+| Function: dualBarrierInit
+| Description: Inicializa uma barreira dupla
+---------------------------------------------------------------------*/
+
+DualBarrierWithMax *dualBarrierInit(int ntasks, TipoBarreira tipo) {
+  DualBarrierWithMax *b;
+  b = (DualBarrierWithMax*) malloc (sizeof(DualBarrierWithMax));
+  if (b == NULL) return NULL;
+
+  b->tipo        = tipo;
+  b->total_nodes = ntasks;
+  b->pending[0]  = ntasks;
+  b->pending[1]  = ntasks;
+  b->maxdelta[0] = 0;
+  b->maxdelta[1] = 0;
+  b->iteracoes_concluidas = 0;
+  b->geracao     = 0;
+  b->hook        = NULL;
+  b->hook_arg    = NULL;
+
+  if (pthread_mutex_init(&(b->mutex), NULL) != 0) {
+    fprintf(stderr, "\nErro a inicializar mutex\n");
+    exit(1);
+  }
+  if (pthread_cond_init(&(b->wait[0]), NULL) != 0) {
+    fprintf(stderr, "\nErro a inicializar variável de condição\n");
+    exit(1);
+  }
+  if (pthread_cond_init(&(b->wait[1]), NULL) != 0) {
+    fprintf(stderr, "\nErro a inicializar variável de condição\n");
+    exit(1);
+  }
+  return b;
+}
+
+/*--------------------------------------------------------------------
+| Function: dualBarrierFree
+| Description: Liberta os recursos de uma barreira dupla
+---------------------------------------------------------------------*/
+
+void dualBarrierFree(DualBarrierWithMax* b) {
+  if (pthread_mutex_destroy(&(b->mutex)) != 0) {
+    fprintf(stderr, "\nErro a destruir mutex\n");
+    exit(1);
+  }
+  if (pthread_cond_destroy(&(b->wait[0])) != 0) {
+    fprintf(stderr, "\nErro a destruir variável de condição\n");
+    exit(1);
+  }
+  if (pthread_cond_destroy(&(b->wait[1])) != 0) {
+    fprintf(stderr, "\nErro a destruir variável de condição\n");
+    exit(1);
+  }
+  free(b);
+}
+
+/*--------------------------------------------------------------------
+| Function: dualBarrierSetHook
+| Description: Regista a funcao a chamar no fim de cada iteracao
+---------------------------------------------------------------------*/
+
+void dualBarrierSetHook(DualBarrierWithMax* b, BarrierHook hook, void *arg) {
+  b->hook     = hook;
+  b->hook_arg = arg;
+}
+
+/*--------------------------------------------------------------------
+| Function: dualBarrierWaitCond
+| Description: Variante com mutex e variaveis de condicao
+---------------------------------------------------------------------*/
+
+static double dualBarrierWaitCond (DualBarrierWithMax* b, int current, double localmax) {
+  int next = 1 - current;
+  if (pthread_mutex_lock(&(b->mutex)) != 0) {
+    fprintf(stderr, "\nErro a bloquear mutex\n");
+    exit(1);
+  }
+  // decrementar contador de tarefas restantes
+  b->pending[current]--;
+  // actualizar valor maxDelta entre todas as threads
+  if (b->maxdelta[current]<localmax)
+    b->maxdelta[current]=localmax;
+  // verificar se sou a ultima tarefa
+  if (b->pending[current]==0) {
+    // sim -- inicializar proxima barreira e libertar threads
+    b->iteracoes_concluidas++;
+    b->pending[next]  = b->total_nodes;
+    b->maxdelta[next] = 0;
+    if (b->hook != NULL)
+      b->hook(b->hook_arg, b->iteracoes_concluidas, b->maxdelta[current]);
+    if (pthread_cond_broadcast(&(b->wait[current])) != 0) {
+      fprintf(stderr, "\nErro a assinalar todos em variável de condição\n");
+      exit(1);
+    }
+  }
+  else {
+    // nao -- esperar pelas outras tarefas
+    while (b->pending[current]>0) {
+      if (pthread_cond_wait(&(b->wait[current]), &(b->mutex)) != 0) {
+        fprintf(stderr, "\nErro a esperar em variável de condição\n");
+        exit(1);
+      }
+    }
+  }
+  double maxdelta = b->maxdelta[current];
+  if (pthread_mutex_unlock(&(b->mutex)) != 0) {
+    fprintf(stderr, "\nErro a desbloquear mutex\n");
+    exit(1);
+  }
+  return maxdelta;
+}
+
+/*--------------------------------------------------------------------
+| Function: dualBarrierWaitSpin
+| Description: Variante sem mutex. O delta e' reduzido com
+|              compare-and-swap e as tarefas esperam activamente que
+|              a ultima a chegar avance a geracao, cedendo o CPU de
+|              tempos a tempos para nao penalizar maquinas com menos
+|              cores do que tarefas.
+---------------------------------------------------------------------*/
+
+static double dualBarrierWaitSpin (DualBarrierWithMax* b, int current, double localmax) {
+  int next = 1 - current;
+  int geracao = __atomic_load_n(&(b->geracao), __ATOMIC_ACQUIRE);
+  double visto, maxdelta;
+
+  __atomic_load(&(b->maxdelta[current]), &visto, __ATOMIC_RELAXED);
+
+  // actualizar valor maxDelta entre todas as threads
+  while (visto < localmax &&
+         !__atomic_compare_exchange(&(b->maxdelta[current]), &visto, &localmax,
+                                    1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+    ;
+
+  if (__atomic_sub_fetch(&(b->pending[current]), 1, __ATOMIC_ACQ_REL) == 0) {
+    // ultima tarefa -- inicializar proxima fase e so' depois libertar
+    b->iteracoes_concluidas++;
+    b->pending[next]  = b->total_nodes;
+    b->maxdelta[next] = 0;
+    if (b->hook != NULL)
+      b->hook(b->hook_arg, b->iteracoes_concluidas, b->maxdelta[current]);
+    __atomic_store_n(&(b->geracao), geracao + 1, __ATOMIC_RELEASE);
+  }
+  else {
+    int voltas = 0;
+    while (__atomic_load_n(&(b->geracao), __ATOMIC_ACQUIRE) == geracao) {
+      if (++voltas >= SPIN_VOLTAS) {
+        voltas = 0;
+        sched_yield();
+      }
+    }
+  }
+  __atomic_load(&(b->maxdelta[current]), &maxdelta, __ATOMIC_RELAXED);
+  return maxdelta;
+}
+
+/*--------------------------------------------------------------------
+| Function: dualBarrierWait
+| Description: Ao chamar esta funcao, a tarefa fica bloqueada ate que
+|              o numero 'ntasks' de tarefas necessario tenham chamado
+|              esta funcao, especificado ao ininializar a barreira em
+|              dualBarrierInit(ntasks). Esta funcao tambem calcula o
+|              delta maximo entre todas as threads e devolve o
+|              resultado no valor de retorno
+---------------------------------------------------------------------*/
+
+double dualBarrierWait (DualBarrierWithMax* b, int current, double localmax) {
+  if (b->tipo == BARREIRA_SPIN)
+    return dualBarrierWaitSpin(b, current, localmax);
+  return dualBarrierWaitCond(b, current, localmax);
+}
+
+/*--------------------------------------------------------------------
+| Function: barreiraPorNome
+| Description: Converte o nome de uma variante em TipoBarreira.
+|              Devolve 0 em caso de sucesso e -1 se o nome for
+|              desconhecido.
+---------------------------------------------------------------------*/
+
+int barreiraPorNome(char const *nome, TipoBarreira *tipo) {
+  if (strcmp(nome, "cond") == 0)
+    *tipo = BARREIRA_COND;
+  else if (strcmp(nome, "spin") == 0)
+    *tipo = BARREIRA_SPIN;
+  else
+    return -1;
+  return 0;
+}
+
+/*--------------------------------------------------------------------
+| Function: barreiraNome
+---------------------------------------------------------------------*/
+
+char const *barreiraNome(TipoBarreira tipo) {
+  return tipo == BARREIRA_SPIN ? "spin" : "cond";
+}
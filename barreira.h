@@ -0,0 +1,59 @@
+/*
+// Barreira dupla com max-reduction
+// Sistemas Operativos, DEI/IST/ULisboa 2017-18
+*/
+
+#ifndef BARREIRA_H
+#define BARREIRA_H
+
+#include <pthread.h>
+
+/*--------------------------------------------------------------------
+| Type: TipoBarreira
+| Description: Variantes de implementacao da barreira. BARREIRA_COND
+|              usa mutex e variaveis de condicao; BARREIRA_SPIN usa
+|              operacoes atomicas e espera activa com cedencia do CPU.
+---------------------------------------------------------------------*/
+
+typedef enum {
+  BARREIRA_COND,
+  BARREIRA_SPIN
+} TipoBarreira;
+
+/*--------------------------------------------------------------------
+| Type: BarrierHook
+| Description: Funcao chamada pela ultima tarefa a chegar a barreira,
+|              antes de libertar as restantes, com o numero de
+|              iteracoes concluidas e o delta maximo global dessa
+|              iteracao. Deve ser curta: as outras tarefas esperam.
+---------------------------------------------------------------------*/
+
+typedef void (*BarrierHook)(void *arg, int iteracoes, double maxdelta);
+
+/*--------------------------------------------------------------------
+| Type: doubleBarrierWithMax
+| Description: Barreira dupla com variavel de max-reduction
+---------------------------------------------------------------------*/
+
+typedef struct {
+  TipoBarreira    tipo;
+  int             total_nodes;
+  int             pending[2];
+  double          maxdelta[2];
+  int             iteracoes_concluidas;
+  int             geracao;
+  BarrierHook     hook;
+  void           *hook_arg;
+  pthread_mutex_t mutex;
+  pthread_cond_t  wait[2];
+} DualBarrierWithMax;
+
+DualBarrierWithMax *dualBarrierInit(int ntasks, TipoBarreira tipo);
+void                dualBarrierFree(DualBarrierWithMax* b);
+void                dualBarrierSetHook(DualBarrierWithMax* b, BarrierHook hook, void *arg);
+double              dualBarrierWait(DualBarrierWithMax* b, int current, double localmax);
+
+int                 barreiraPorNome(char const *nome, TipoBarreira *tipo);
+char const         *barreiraNome(TipoBarreira tipo);
+
+#endif
@@ -0,0 +1,307 @@
+/*
+// heatBench - bateria de benchmarks do heatSim
+// Sistemas Operativos, DEI/IST/ULisboa 2017-18
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "medicao.h"
+#include "util.h"
+
+#define MAX_LISTA    32
+#define MAX_REPS     256
+#define MAX_LINHAS   4096
+#define TAM_NOME     32
+
+/*--------------------------------------------------------------------
+| Type: Resultado
+| Description: Uma linha do ficheiro de resultados
+---------------------------------------------------------------------*/
+
+typedef struct {
+  int    N;
+  int    trab;
+  char   kernel[TAM_NOME];
+  char   barreira[TAM_NOME];
+  int    bloco;
+  int    iteracoes;
+  int    repeticoes;
+  double mediana;
+  double iqr;
+  double gbs;
+  double fracao_stream;
+} Resultado;
+
+/*--------------------------------------------------------------------
+| Function: dividir_lista
+| Description: Parte uma lista separada por virgulas, alterando str.
+|              Devolve o numero de elementos.
+---------------------------------------------------------------------*/
+
+static int dividir_lista(char *str, char **itens, int max) {
+  int n = 0;
+  for (char *tok = strtok(str, ","); tok != NULL && n < max; tok = strtok(NULL, ","))
+    itens[n++] = tok;
+  return n;
+}
+
+static int comparar_doubles(const void *a, const void *b) {
+  double x = *(const double*) a, y = *(const double*) b;
+  return (x > y) - (x < y);
+}
+
+/*--------------------------------------------------------------------
+| Function: quantil
+| Description: Quantil q de um vector ordenado, com interpolacao linear
+---------------------------------------------------------------------*/
+
+static double quantil(double *ordenado, int n, double q) {
+  double pos = q * (n - 1);
+  int    i   = (int) pos;
+  double f   = pos - i;
+  if (i + 1 >= n)
+    return ordenado[n - 1];
+  return ordenado[i] * (1 - f) + ordenado[i + 1] * f;
+}
+
+/*--------------------------------------------------------------------
+| Function: executar_heatSim
+| Description: Executa uma vez o heatSim em modo --bench e devolve o
+|              tempo de calculo em segundos (-1 em caso de erro).
+|              O numero de iteracoes efectuadas fica em *iteracoes.
+---------------------------------------------------------------------*/
+
+static double executar_heatSim(char const *exe, int N, int trab, char const *kernel,
+                               char const *barreira, int bloco, int iter, int *iteracoes) {
+  char sN[16], sIter[16], sTrab[16], sBloco[16], fich[64];
+  int  tubo[2];
+
+  snprintf(sN,     sizeof(sN),     "%d", N);
+  snprintf(sIter,  sizeof(sIter),  "%d", iter);
+  snprintf(sTrab,  sizeof(sTrab),  "%d", trab);
+  snprintf(sBloco, sizeof(sBloco), "%d", bloco > 0 ? bloco : N);
+  // o ficheiro de salvaguarda nao pode existir, senao seria lido
+  snprintf(fich,   sizeof(fich),   "/tmp/heatBench_%d.txt", (int) getpid());
+  unlink(fich);
+
+  if (pipe(tubo) != 0)
+    die("Erro ao criar pipe");
+
+  pid_t pid = fork();
+  if (pid < 0)
+    die("Erro ao criar processo");
+
+  if (pid == 0) {
+    close(tubo[0]);
+    dup2(tubo[1], STDOUT_FILENO);
+    close(tubo[1]);
+    execl(exe, exe, sN, "100", "100", "0", "0", sIter, sTrab, "0", fich, "0",
+          "--kernel", kernel, "--barreira", barreira, "--bloco", sBloco, "--sem-afinacao", "--bench",
+          (char*) NULL);
+    perror(exe);
+    _exit(127);
+  }
+
+  close(tubo[1]);
+  FILE *saida = fdopen(tubo[0], "r");
+  char  linha[512];
+  double tempo = -1;
+
+  while (saida != NULL && fgets(linha, sizeof(linha), saida) != NULL) {
+    char *p = strstr(linha, "iteracoes=");
+    char *q = strstr(linha, "tempo=");
+    if (p != NULL && q != NULL &&
+        sscanf(p, "iteracoes=%d", iteracoes) == 1 && sscanf(q, "tempo=%lf", &tempo) == 1)
+      break;
+  }
+  if (saida != NULL)
+    fclose(saida);
+
+  int status;
+  waitpid(pid, &status, 0);
+  if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+    return -1;
+  return tempo;
+}
+
+/*--------------------------------------------------------------------
+| Function: ler_resultados
+| Description: Le um ficheiro de resultados. Devolve o numero de
+|              linhas lidas ou -1 se o ficheiro nao abrir.
+---------------------------------------------------------------------*/
+
+static int ler_resultados(char const *nome, Resultado *res, int max) {
+  FILE *f = fopen(nome, "r");
+  char  linha[512];
+  int   n = 0;
+
+  if (f == NULL)
+    return -1;
+
+  while (n < max && fgets(linha, sizeof(linha), f) != NULL) {
+    Resultado *r = &res[n];
+    if (linha[0] == '#' || strncmp(linha, "N,", 2) == 0)
+      continue;
+    if (sscanf(linha, "%d,%d,%31[^,],%31[^,],%d,%d,%d,%lf,%lf,%lf,%lf",
+               &r->N, &r->trab, r->kernel, r->barreira, &r->bloco, &r->iteracoes,
+               &r->repeticoes, &r->mediana, &r->iqr, &r->gbs, &r->fracao_stream) == 11)
+      n++;
+  }
+  fclose(f);
+  return n;
+}
+
+/*--------------------------------------------------------------------
+| Function: comparar
+| Description: Compara dois ficheiros de resultados e assinala as
+|              configuracoes cujo tempo mediano por iteracao piorou
+|              mais do que 'limiar' (fraccao). Devolve o numero de
+|              regressoes.
+---------------------------------------------------------------------*/
+
+static int comparar(char const *base_nome, char const *novo_nome, double limiar) {
+  static Resultado base[MAX_LINHAS], novo[MAX_LINHAS];
+  int nb = ler_resultados(base_nome, base, MAX_LINHAS);
+  int nn = ler_resultados(novo_nome, novo, MAX_LINHAS);
+  int regressoes = 0;
+
+  if (nb < 0 || nn < 0)
+    die("Nao foi possivel ler os ficheiros de resultados");
+
+  printf("%6s %5s %-10s %-8s %6s %12s %12s %8s\n",
+         "N", "trab", "kernel", "barreira", "bloco", "base(s/it)", "novo(s/it)", "var");
+  for (int i = 0; i < nn; i++) {
+    Resultado *n = &novo[i];
+    for (int j = 0; j < nb; j++) {
+      Resultado *b = &base[j];
+      if (b->N != n->N || b->trab != n->trab || b->bloco != n->bloco ||
+          strcmp(b->kernel, n->kernel) != 0 || strcmp(b->barreira, n->barreira) != 0)
+        continue;
+
+      double var = n->mediana / b->mediana - 1;
+      int    pior = var > limiar;
+      regressoes += pior;
+      printf("%6d %5d %-10s %-8s %6d %12.4e %12.4e %+7.1f%%%s\n",
+             n->N, n->trab, n->kernel, n->barreira, n->bloco,
+             b->mediana, n->mediana, 100 * var, pior ? "  REGRESSAO" : "");
+      break;
+    }
+  }
+  printf("\n%d regressao(oes) acima de %.1f%%\n", regressoes, 100 * limiar);
+  return regressoes;
+}
+
+/*--------------------------------------------------------------------
+| Function: main
+---------------------------------------------------------------------*/
+
+int main(int argc, char **argv) {
+  char const *exe       = "./heatSim";
+  char const *saida     = "bench_resultados.csv";
+  char        listaN[256]  = "256,512,1024";
+  char        listaT[256]  = "1,2,4";
+  char        listaK[256]  = "simples,linhas,blocos";
+  char        listaB[256]  = "cond,spin";
+  int         bloco    = 0;
+  int         iter     = 200;
+  int         reps     = 5;
+  int         aquecer  = 1;
+  int         opt;
+
+  if (argc >= 2 && strcmp(argv[1], "-c") == 0) {
+    if (argc < 4) {
+      fprintf(stderr, "Utilizacao: ./heatBench -c base.csv novo.csv [limiar%%]\n");
+      return 2;
+    }
+    double limiar = argc > 4 ? parse_double_or_exit(argv[4], "limiar", 0) / 100 : 0.05;
+    return comparar(argv[2], argv[3], limiar) > 0;
+  }
+
+  while ((opt = getopt(argc, argv, "s:N:t:k:b:B:i:r:w:o:")) != -1) {
+    switch (opt) {
+      case 's': exe = optarg; break;
+      case 'N': snprintf(listaN, sizeof(listaN), "%s", optarg); break;
+      case 't': snprintf(listaT, sizeof(listaT), "%s", optarg); break;
+      case 'k': snprintf(listaK, sizeof(listaK), "%s", optarg); break;
+      case 'b': snprintf(listaB, sizeof(listaB), "%s", optarg); break;
+      case 'B': bloco = parse_integer_or_exit(optarg, "bloco", 1); break;
+      case 'i': iter  = parse_integer_or_exit(optarg, "iter", 1); break;
+      case 'r': reps  = parse_integer_or_exit(optarg, "repeticoes", 1); break;
+      case 'w': aquecer = parse_integer_or_exit(optarg, "aquecimento", 0); break;
+      case 'o': saida = optarg; break;
+      default:
+        fprintf(stderr, "Utilizacao: ./heatBench [-s heatSim] [-N 256,512] [-t 1,2,4]"
+                        " [-k simples,linhas,blocos] [-b cond,spin] [-B bloco] [-i iter]"
+                        " [-r repeticoes] [-w aquecimento] [-o resultados.csv]\n"
+                        "            ./heatBench -c base.csv novo.csv [limiar%%]\n");
+        return 2;
+    }
+  }
+  if (reps > MAX_REPS)
+    reps = MAX_REPS;
+
+  char *Ns[MAX_LISTA], *Ts[MAX_LISTA], *Ks[MAX_LISTA], *Bs[MAX_LISTA];
+  int nN = dividir_lista(listaN, Ns, MAX_LISTA);
+  int nT = dividir_lista(listaT, Ts, MAX_LISTA);
+  int nK = dividir_lista(listaK, Ks, MAX_LISTA);
+  int nB = dividir_lista(listaB, Bs, MAX_LISTA);
+
+  // referencia: copia ao estilo STREAM sobre vectores de 64MB
+  double stream = medirLarguraBandaCopia(64u << 20, 10);
+  fprintf(stderr, "Largura de banda de referencia (copia): %.2f GB/s\n", stream);
+
+  FILE *f = fopen(saida, "w");
+  if (f == NULL)
+    die("Erro ao abrir ficheiro de resultados");
+  fprintf(f, "# heatBench iter=%d repeticoes=%d aquecimento=%d\n", iter, reps, aquecer);
+  fprintf(f, "# stream_copia_gbs=%.3f\n", stream);
+  fprintf(f, "N,trab,kernel,barreira,bloco,iteracoes,repeticoes,"
+             "mediana_s_iter,iqr_s_iter,gbs,fracao_stream\n");
+
+  for (int a = 0; a < nN; a++)
+  for (int b = 0; b < nT; b++)
+  for (int c = 0; c < nK; c++)
+  for (int d = 0; d < nB; d++) {
+    int    N    = parse_integer_or_exit(Ns[a], "N", 1);
+    int    trab = parse_integer_or_exit(Ts[b], "trab", 1);
+    int    blk  = bloco > 0 ? bloco : N;
+    int    iteracoes = 0;
+    double tempos[MAX_REPS];
+
+    if (N % trab != 0)
+      continue;
+
+    for (int r = 0; r < aquecer; r++)
+      executar_heatSim(exe, N, trab, Ks[c], Bs[d], blk, iter, &iteracoes);
+
+    int ok = 1;
+    for (int r = 0; r < reps && ok; r++) {
+      double t = executar_heatSim(exe, N, trab, Ks[c], Bs[d], blk, iter, &iteracoes);
+      ok = t >= 0 && iteracoes > 0;
+      tempos[r] = ok ? t / iteracoes : 0;
+    }
+    if (!ok) {
+      fprintf(stderr, "Falhou: N=%d trab=%d kernel=%s barreira=%s\n", N, trab, Ks[c], Bs[d]);
+      continue;
+    }
+
+    qsort(tempos, reps, sizeof(double), comparar_doubles);
+    double mediana = quantil(tempos, reps, 0.5);
+    double iqr     = quantil(tempos, reps, 0.75) - quantil(tempos, reps, 0.25);
+    double gbs     = bytesPorIteracao(N) / mediana / 1e9;
+
+    fprintf(f, "%d,%d,%s,%s,%d,%d,%d,%.6e,%.6e,%.3f,%.3f\n",
+            N, trab, Ks[c], Bs[d], blk, iteracoes, reps, mediana, iqr, gbs,
+            stream > 0 ? gbs / stream : 0);
+    fflush(f);
+    fprintf(stderr, "N=%-6d trab=%-3d kernel=%-8s barreira=%-5s  %.4e s/iter (IQR %.2e)  %.2f GB/s\n",
+            N, trab, Ks[c], Bs[d], mediana, iqr, gbs);
+  }
+
+  fclose(f);
+  return 0;
+}
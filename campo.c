@@ -0,0 +1,72 @@
+/*
+// heatCampo - le o campo publicado por um heatSim com --shm
+// Sistemas Operativos, DEI/IST/ULisboa 2017-18
+//
+// Exemplo de leitor: so' usa campopartilhado.h. Escreve, a cada
+// intervalo, a iteracao, o delta, o valor num ponto e a media do
+// interior, calculados directamente sobre o segmento.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "campopartilhado.h"
+
+int main(int argc, char **argv) {
+  CampoCabecalho const *c;
+  long                  ms = argc > 2 ? atol(argv[2]) : 100;
+  long                  anterior = -1;
+  struct timespec       espera = { ms / 1000, (ms % 1000) * 1000000L };
+
+  if (argc < 2) {
+    fprintf(stderr, "Utilizacao: ./heatCampo NOME [intervalo_ms] [linha coluna]\n");
+    return 2;
+  }
+  c = campoAbrir(argv[1]);
+  if (c == NULL) {
+    fprintf(stderr, "Segmento %s inexistente ou invalido\n", argv[1]);
+    return 1;
+  }
+
+  int  l = argc > 4 ? atoi(argv[3]) : c->linhas / 2;
+  int  col = argc > 4 ? atoi(argv[4]) : c->colunas / 2;
+  long repeticoes = 0;
+
+  if (l < 0 || l >= c->linhas || col < 0 || col >= c->colunas) {
+    fprintf(stderr, "Ponto fora da matriz %dx%d\n", c->linhas, c->colunas);
+    return 1;
+  }
+
+  for (;;) {
+    int           terminado = __atomic_load_n(&c->terminado, __ATOMIC_ACQUIRE);
+    CampoLeitura  lei;
+    double const *m;
+    double        ponto, soma;
+
+    do {
+      m = campoLerInicio(c, &lei);
+      if (m == NULL)
+        break;
+      ponto = m[(long) l * c->colunas + col];
+      soma  = 0;
+      for (int i = 1; i < c->linhas - 1; i++)
+        for (int j = 1; j < c->colunas - 1; j++)
+          soma += m[(long) i * c->colunas + j];
+    } while (!campoLerValida(c, &lei) && ++repeticoes);
+
+    if (m != NULL && lei.iteracao != anterior) {
+      printf("iteracao %ld  delta %.6e  m[%d][%d] = %.6f  media %.6f\n", lei.iteracao,
+             lei.delta, l, col, ponto,
+             soma / ((double) (c->linhas - 2) * (c->colunas - 2)));
+      fflush(stdout);
+      anterior = lei.iteracao;
+    }
+    if (terminado)
+      break;
+    nanosleep(&espera, NULL);
+  }
+  fprintf(stderr, "%ld leituras repetidas\n", repeticoes);
+  campoFechar(c);
+  return 0;
+}
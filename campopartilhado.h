@@ -0,0 +1,157 @@
+/*
+// Campo publicado pelo heatSim em memoria partilhada (--shm NOME)
+// Sistemas Operativos, DEI/IST/ULisboa 2017-18
+//
+// Este ficheiro e' autonomo: os leitores externos so' precisam dele.
+//
+// O segmento POSIX (shm_open) comeca por um CampoCabecalho de 64 bytes,
+// seguido de 'nslots' slots de 'tam_slot' bytes. Cada slot tem um
+// CampoSlot de 64 bytes e as linhas x colunas entradas da matriz, por
+// linhas. O heatSim escreve os slots de forma circular e nunca espera
+// pelos leitores; cada slot e' protegido por um seqlock: 'seq' e' impar
+// enquanto o slot esta' a ser escrito e muda a cada escrita.
+//
+// Leitura sem copias:
+//
+//   CampoCabecalho const *c = campoAbrir("/heatsim");
+//   CampoLeitura l;
+//   double const *m;
+//   do {
+//     m = campoLerInicio(c, &l);
+//     ... usar m[i * c->colunas + j], l.iteracao, l.delta ...
+//   } while (!campoLerValida(c, &l));
+//
+// Os valores lidos so' sao de confianca depois de campoLerValida
+// devolver 1; uma leitura mais longa do que 'nslots' publicacoes
+// (ver 'periodo') e' sempre repetida.
+*/
+
+#ifndef CAMPOPARTILHADO_H
+#define CAMPOPARTILHADO_H
+
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define CAMPO_MAGIA   0x4d435348u   // "HSCM"
+#define CAMPO_VERSAO  1
+
+/*--------------------------------------------------------------------
+| Type: CampoCabecalho
+---------------------------------------------------------------------*/
+
+typedef struct {
+  uint32_t magia;
+  uint32_t versao;
+  int32_t  linhas;         // N+2, com as fronteiras
+  int32_t  colunas;
+  int32_t  nslots;
+  int32_t  periodo;        // iteracoes entre publicacoes
+  uint64_t tam_slot;       // bytes entre o inicio de dois slots
+  uint32_t ultimo;         // slot da publicacao mais recente
+  uint32_t terminado;      // 1 depois da ultima publicacao
+  uint64_t publicacoes;    // 0 enquanto nao houver nenhuma
+  char     reservado[16];
+} CampoCabecalho;
+
+/*--------------------------------------------------------------------
+| Type: CampoSlot
+---------------------------------------------------------------------*/
+
+typedef struct {
+  uint64_t seq;            // impar durante a escrita
+  int64_t  iteracao;
+  double   delta;
+  char     reservado[40];
+} CampoSlot;
+
+/*--------------------------------------------------------------------
+| Type: CampoLeitura
+| Description: Estado de uma leitura em curso
+---------------------------------------------------------------------*/
+
+typedef struct {
+  CampoSlot const *slot;
+  uint64_t         seq;
+  long             iteracao;
+  double           delta;
+} CampoLeitura;
+
+/*--------------------------------------------------------------------
+| Function: campoSlot
+---------------------------------------------------------------------*/
+
+static inline CampoSlot const *campoSlot(CampoCabecalho const *c, int s) {
+  return (CampoSlot const*) ((char const*) c + sizeof(CampoCabecalho) + s * c->tam_slot);
+}
+
+/*--------------------------------------------------------------------
+| Function: campoAbrir
+| Description: Mapeia o segmento so' para leitura. Devolve NULL se nao
+|              existir ou nao for de um heatSim desta versao.
+---------------------------------------------------------------------*/
+
+static inline CampoCabecalho const *campoAbrir(char const *nome) {
+  struct stat           st;
+  CampoCabecalho const *c;
+  int                   fd = shm_open(nome, O_RDONLY, 0);
+
+  if (fd < 0)
+    return NULL;
+  if (fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(CampoCabecalho)) {
+    close(fd);
+    return NULL;
+  }
+  c = (CampoCabecalho const*) mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (c == MAP_FAILED)
+    return NULL;
+  if (c->magia != CAMPO_MAGIA || c->versao != CAMPO_VERSAO ||
+      sizeof(CampoCabecalho) + c->nslots * c->tam_slot > (uint64_t) st.st_size) {
+    munmap((void*) c, st.st_size);
+    return NULL;
+  }
+  return c;
+}
+
+/*--------------------------------------------------------------------
+| Function: campoFechar
+---------------------------------------------------------------------*/
+
+static inline void campoFechar(CampoCabecalho const *c) {
+  munmap((void*) c, sizeof(CampoCabecalho) + c->nslots * c->tam_slot);
+}
+
+/*--------------------------------------------------------------------
+| Function: campoLerInicio
+| Description: Comeca a ler a publicacao mais recente: espera que o
+|              slot nao esteja a ser escrito e devolve as entradas.
+|              Devolve NULL se ainda nao houver publicacoes.
+---------------------------------------------------------------------*/
+
+static inline double const *campoLerInicio(CampoCabecalho const *c, CampoLeitura *l) {
+  if (__atomic_load_n(&c->publicacoes, __ATOMIC_ACQUIRE) == 0)
+    return NULL;
+  do {
+    l->slot = campoSlot(c, __atomic_load_n(&c->ultimo, __ATOMIC_ACQUIRE));
+    l->seq  = __atomic_load_n(&l->slot->seq, __ATOMIC_ACQUIRE);
+  } while (l->seq & 1);
+  l->iteracao = l->slot->iteracao;
+  l->delta    = l->slot->delta;
+  return (double const*) (l->slot + 1);
+}
+
+/*--------------------------------------------------------------------
+| Function: campoLerValida
+| Description: 1 se o slot nao foi reescrito desde campoLerInicio, e
+|              os valores lidos entretanto sao de uma so' iteracao
+---------------------------------------------------------------------*/
+
+static inline int campoLerValida(CampoCabecalho const *c, CampoLeitura const *l) {
+  __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  return __atomic_load_n(&l->slot->seq, __ATOMIC_RELAXED) == l->seq;
+}
+
+#endif
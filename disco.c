@@ -0,0 +1,498 @@
+/*
+// Resolucao fora do nucleo: a grelha fica num ficheiro
+// Sistemas Operativos, DEI/IST/ULisboa 2017-18
+*/
+
+#include "disco.h"
+#include "medicao.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+
+// buffers de leitura antecipada e de escrita diferida
+#define DISCO_BUFFERS 2
+
+/*--------------------------------------------------------------------
+| Type: Disco
+| Description: Estado partilhado com a tarefa de E/S. Cada buffer de
+|              leitura guarda a fatia f no indice f % DISCO_BUFFERS.
+---------------------------------------------------------------------*/
+
+typedef struct {
+  int             fd;
+  long            colunas;
+  long            linhas;
+  int             S;
+  int             nfatias;
+  pthread_mutex_t mutex;
+  pthread_cond_t  cond;
+  double         *leit[DISCO_BUFFERS];
+  int             leit_fatia[DISCO_BUFFERS];    // -1 se livre
+  int             leit_pronta[DISCO_BUFFERS];
+  int             proxima_leitura;
+  int             ativa;
+  double         *escr[DISCO_BUFFERS];
+  long            escr_linha[DISCO_BUFFERS];
+  long            escr_n[DISCO_BUFFERS];
+  int             escr_pendente[DISCO_BUFFERS];
+  int             proxima_escrita;
+  int             terminar;
+  int             erro;
+} Disco;
+
+/*--------------------------------------------------------------------
+| Type: Calculo
+| Description: Estado partilhado pelas trabalhadoras. So' a tarefa 0
+|              fala com a tarefa de E/S e decide as passagens.
+---------------------------------------------------------------------*/
+
+typedef struct {
+  Disco            *d;
+  int               N;
+  int               S;
+  int               anel;       // S+2 linhas por nivel
+  int               Tmax;
+  int               T;          // niveis da passagem actual
+  int               iter;
+  double            maxD;
+  int               feitas;
+  double            delta;
+  int               abaixo;     // primeira iteracao com delta < maxD
+  int               fim;
+  int               trab;
+  double          **nivel;
+  double           *deltas;     // [trab][Tmax]
+  pthread_barrier_t barreira;
+} Calculo;
+
+typedef struct {
+  Calculo *c;
+  int      id;
+} TarefaCalculo;
+
+/*--------------------------------------------------------------------
+| Function: transferir
+| Description: pread/pwrite completos de 'bytes' bytes
+---------------------------------------------------------------------*/
+
+static int transferir(int fd, void *buf, size_t bytes, off_t pos, int escrever) {
+  char *p = (char*) buf;
+  while (bytes > 0) {
+    ssize_t n = escrever ? pwrite(fd, p, bytes, pos) : pread(fd, p, bytes, pos);
+    if (n <= 0)
+      return -1;
+    p     += n;
+    pos   += n;
+    bytes -= n;
+  }
+  return 0;
+}
+
+/*--------------------------------------------------------------------
+| Function: tarefa_es
+| Description: Escreve as fatias pendentes (primeiro, para libertar os
+|              buffers) e le as seguintes da passagem actual enquanto
+|              houver buffers livres
+---------------------------------------------------------------------*/
+
+static void *tarefa_es(void *arg) {
+  Disco *d = (Disco*) arg;
+  size_t tam_linha = d->colunas * sizeof(double);
+
+  pthread_mutex_lock(&d->mutex);
+  for (;;) {
+    int k, s = d->proxima_leitura % DISCO_BUFFERS;
+
+    for (k = 0; k < DISCO_BUFFERS && !d->escr_pendente[k]; k++)
+      ;
+    if (k < DISCO_BUFFERS) {
+      pthread_mutex_unlock(&d->mutex);
+      int r = transferir(d->fd, d->escr[k], d->escr_n[k] * tam_linha,
+                         (off_t) d->escr_linha[k] * tam_linha, 1);
+      pthread_mutex_lock(&d->mutex);
+      d->erro |= r;
+      d->escr_pendente[k] = 0;
+      pthread_cond_broadcast(&d->cond);
+    } else if (d->ativa && d->proxima_leitura < d->nfatias && d->leit_fatia[s] == -1) {
+      int  f  = d->proxima_leitura++;
+      long l0 = (long) f * d->S;
+      long n  = l0 + d->S <= d->linhas ? d->S : d->linhas - l0;
+      d->leit_fatia[s]  = f;
+      d->leit_pronta[s] = 0;
+      pthread_mutex_unlock(&d->mutex);
+      int r = transferir(d->fd, d->leit[s], n * tam_linha, (off_t) l0 * tam_linha, 0);
+      pthread_mutex_lock(&d->mutex);
+      d->erro |= r;
+      d->leit_pronta[s] = 1;
+      pthread_cond_broadcast(&d->cond);
+    } else if (d->terminar) {
+      break;
+    } else {
+      pthread_cond_wait(&d->cond, &d->mutex);
+    }
+  }
+  pthread_mutex_unlock(&d->mutex);
+  return NULL;
+}
+
+/*--------------------------------------------------------------------
+| Function: disco_nova_passagem
+| Description: Espera que as escritas da passagem anterior terminem e
+|              recomeca a leitura antecipada no inicio do ficheiro
+---------------------------------------------------------------------*/
+
+static void disco_nova_passagem(Disco *d) {
+  pthread_mutex_lock(&d->mutex);
+  for (int k = 0; k < DISCO_BUFFERS; k++)
+    while (d->escr_pendente[k])
+      pthread_cond_wait(&d->cond, &d->mutex);
+  for (int s = 0; s < DISCO_BUFFERS; s++)
+    d->leit_fatia[s] = -1;
+  d->proxima_leitura = 0;
+  d->ativa = 1;
+  pthread_cond_broadcast(&d->cond);
+  pthread_mutex_unlock(&d->mutex);
+}
+
+static double *disco_obter_leitura(Disco *d, int f) {
+  int s = f % DISCO_BUFFERS;
+  pthread_mutex_lock(&d->mutex);
+  while (d->leit_fatia[s] != f || !d->leit_pronta[s])
+    pthread_cond_wait(&d->cond, &d->mutex);
+  pthread_mutex_unlock(&d->mutex);
+  return d->leit[s];
+}
+
+static void disco_libertar_leitura(Disco *d, int f) {
+  pthread_mutex_lock(&d->mutex);
+  d->leit_fatia[f % DISCO_BUFFERS] = -1;
+  pthread_cond_broadcast(&d->cond);
+  pthread_mutex_unlock(&d->mutex);
+}
+
+static double *disco_obter_escrita(Disco *d) {
+  int k = d->proxima_escrita;
+  pthread_mutex_lock(&d->mutex);
+  while (d->escr_pendente[k])
+    pthread_cond_wait(&d->cond, &d->mutex);
+  pthread_mutex_unlock(&d->mutex);
+  return d->escr[k];
+}
+
+static void disco_submeter_escrita(Disco *d, long linha, long n) {
+  int k = d->proxima_escrita;
+  pthread_mutex_lock(&d->mutex);
+  d->escr_linha[k]    = linha;
+  d->escr_n[k]        = n;
+  d->escr_pendente[k] = 1;
+  d->proxima_escrita  = (k + 1) % DISCO_BUFFERS;
+  pthread_cond_broadcast(&d->cond);
+  pthread_mutex_unlock(&d->mutex);
+}
+
+/*--------------------------------------------------------------------
+| Function: linha_disco
+| Description: Uma linha de Jacobi, com as mesmas operacoes e pela
+|              mesma ordem que os kernels em memoria
+---------------------------------------------------------------------*/
+
+static double linha_disco(double const *restrict cima, double const *restrict meio,
+                          double const *restrict baixo, double *restrict saida, int N) {
+  double max_delta = 0;
+
+  saida[0]   = meio[0];
+  saida[N+1] = meio[N+1];
+  for (int j = 1; j <= N; j++) {
+    double val   = (cima[j] + baixo[j] + meio[j-1] + meio[j+1])/4;
+    double delta = fabs(val - meio[j]);
+    max_delta = delta > max_delta ? delta : max_delta;
+    saida[j] = val;
+  }
+  return max_delta;
+}
+
+static inline double *linha_nivel(Calculo *c, int t, long q) {
+  return c->nivel[t] + (q % c->anel) * (long) (c->N + 2);
+}
+
+/*--------------------------------------------------------------------
+| Function: tarefa_calculo
+| Description: Cada trabalhadora calcula, em cada nivel de cada passo,
+|              a sua parte das linhas desse nivel. Os niveis sao
+|              separados por barreiras.
+---------------------------------------------------------------------*/
+
+static void *tarefa_calculo(void *arg) {
+  TarefaCalculo *tc = (TarefaCalculo*) arg;
+  Calculo       *c  = tc->c;
+  Disco         *d  = c->d;
+  int            N  = c->N, S = c->S, id = tc->id;
+  long           linhas = N + 2;
+  size_t         tam_linha = linhas * sizeof(double);
+
+  for (;;) {
+    if (id == 0) {
+      if (c->feitas >= c->iter || c->abaixo > 0) {
+        c->fim = 1;
+      } else {
+        c->T = c->iter - c->feitas < c->Tmax ? c->iter - c->feitas : c->Tmax;
+        memset(c->deltas, 0, c->trab * c->Tmax * sizeof(double));
+        disco_nova_passagem(d);
+      }
+    }
+    pthread_barrier_wait(&c->barreira);
+    if (c->fim)
+      break;
+
+    int T = c->T;
+    int npassos = (int) ((linhas + T + S - 1) / S);
+    for (int j = 0; j < npassos; j++) {
+      if (id == 0 && j < d->nfatias) {
+        // nivel 0: a fatia j acabada de ler
+        double *buf = disco_obter_leitura(d, j);
+        long    l0 = (long) j * S;
+        long    n  = l0 + S <= linhas ? S : linhas - l0;
+        for (long q = 0; q < n; q++)
+          memcpy(linha_nivel(c, 0, l0 + q), buf + q * linhas, tam_linha);
+        disco_libertar_leitura(d, j);
+      }
+      pthread_barrier_wait(&c->barreira);
+
+      for (int t = 1; t <= T; t++) {
+        long lo = (long) j * S - t, hi = (long) (j + 1) * S - t;
+        lo = lo < 0 ? 0 : lo;
+        hi = hi > linhas ? linhas : hi;
+        if (lo < hi) {
+          long   a = lo + (hi - lo) * id / c->trab;
+          long   b = lo + (hi - lo) * (id + 1) / c->trab;
+          double max_delta = c->deltas[id * c->Tmax + t - 1];
+          for (long q = a; q < b; q++) {
+            if (q == 0 || q == linhas - 1) {
+              memcpy(linha_nivel(c, t, q), linha_nivel(c, t - 1, q), tam_linha);
+            } else {
+              double dl = linha_disco(linha_nivel(c, t - 1, q - 1), linha_nivel(c, t - 1, q),
+                                      linha_nivel(c, t - 1, q + 1), linha_nivel(c, t, q), N);
+              max_delta = dl > max_delta ? dl : max_delta;
+            }
+          }
+          c->deltas[id * c->Tmax + t - 1] = max_delta;
+        }
+        pthread_barrier_wait(&c->barreira);
+      }
+
+      if (id == 0) {
+        // linhas do nivel T completas neste passo voltam ao ficheiro
+        long lo = (long) j * S - T, hi = (long) (j + 1) * S - T;
+        lo = lo < 0 ? 0 : lo;
+        hi = hi > linhas ? linhas : hi;
+        if (lo < hi) {
+          double *buf = disco_obter_escrita(d);
+          for (long q = lo; q < hi; q++)
+            memcpy(buf + (q - lo) * linhas, linha_nivel(c, T, q), tam_linha);
+          disco_submeter_escrita(d, lo, hi - lo);
+        }
+      }
+    }
+
+    if (id == 0) {
+      // o criterio de paragem so' e' avaliado no fim da passagem, com
+      // o nivel T ja' escrito; regista-se onde pararia em memoria
+      for (int t = 0; t < T; t++) {
+        double m = 0;
+        for (int k = 0; k < c->trab; k++)
+          m = c->deltas[k * c->Tmax + t] > m ? c->deltas[k * c->Tmax + t] : m;
+        if (m < c->maxD && c->abaixo == 0)
+          c->abaixo = c->feitas + t + 1;
+        c->delta = m;
+      }
+      c->feitas += T;
+    }
+  }
+  return NULL;
+}
+
+/*--------------------------------------------------------------------
+| Function: discoIniciar
+---------------------------------------------------------------------*/
+
+int discoIniciar(char const *fich, int N, double tEsq, double tSup, double tDir, double tInf) {
+  long    colunas = N + 2;
+  double *linha = (double*) malloc(colunas * sizeof(double));
+  int     fd = open(fich, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  int     res = 0;
+
+  if (linha == NULL || fd < 0) {
+    free(linha);
+    if (fd >= 0)
+      close(fd);
+    return -1;
+  }
+  // mesmos valores, cantos incluidos, que preparar_matrizes
+  for (long i = 0; i < colunas && res == 0; i++) {
+    double v = i == 0 ? tSup : i == colunas - 1 ? tInf : 0;
+    for (long j = 0; j < colunas; j++)
+      linha[j] = v;
+    linha[0]           = tEsq;
+    linha[colunas - 1] = tDir;
+    res = transferir(fd, linha, colunas * sizeof(double), (off_t) i * colunas * sizeof(double), 1);
+  }
+  free(linha);
+  if (close(fd) != 0)
+    res = -1;
+  return res;
+}
+
+/*--------------------------------------------------------------------
+| Function: discoResolver
+---------------------------------------------------------------------*/
+
+int discoResolver(char const *fich, int N, int iter, double maxD, size_t memoria, int trab,
+                  ResultadoDisco *r) {
+  Disco     d;
+  Calculo   c;
+  pthread_t es;
+  long      linhas = N + 2;
+  size_t    tam_linha = linhas * sizeof(double);
+  int       res = 0;
+
+  // um quarto da memoria para os buffers de E/S, o resto para os niveis
+  long S = (long) (memoria / (4 * DISCO_BUFFERS * tam_linha));
+  S = S < 1 ? 1 : S > linhas ? linhas : S;
+  if (memoria < (2 * DISCO_BUFFERS * S + 2 * (S + 2)) * tam_linha)
+    return -1;
+  long Tmax = (long) ((memoria - 2 * DISCO_BUFFERS * S * tam_linha) / ((S + 2) * tam_linha)) - 1;
+  if (Tmax > iter)
+    Tmax = iter;
+  if (trab > S)
+    trab = (int) S;
+
+  memset(&d, 0, sizeof(d));
+  d.fd = open(fich, O_RDWR);
+  if (d.fd < 0)
+    return -1;
+  d.colunas = linhas;
+  d.linhas  = linhas;
+  d.S       = (int) S;
+  d.nfatias = (int) ((linhas + S - 1) / S);
+  pthread_mutex_init(&d.mutex, NULL);
+  pthread_cond_init(&d.cond, NULL);
+  for (int k = 0; k < DISCO_BUFFERS; k++) {
+    d.leit[k] = (double*) malloc(S * tam_linha);
+    d.escr[k] = (double*) malloc(S * tam_linha);
+    d.leit_fatia[k] = -1;
+    if (d.leit[k] == NULL || d.escr[k] == NULL)
+      res = -1;
+  }
+
+  memset(&c, 0, sizeof(c));
+  c.d      = &d;
+  c.N      = N;
+  c.S      = (int) S;
+  c.anel   = (int) S + 2;
+  c.Tmax   = (int) Tmax;
+  c.iter   = iter;
+  c.maxD   = maxD;
+  c.delta  = INFINITY;
+  c.trab   = trab;
+  c.nivel  = (double**) calloc(Tmax + 1, sizeof(double*));
+  c.deltas = (double*) malloc(trab * Tmax * sizeof(double));
+  if (c.nivel == NULL || c.deltas == NULL)
+    res = -1;
+  for (long t = 0; res == 0 && t <= Tmax; t++)
+    if ((c.nivel[t] = (double*) malloc((S + 2) * tam_linha)) == NULL)
+      res = -1;
+
+  if (res == 0) {
+    TarefaCalculo *tc = (TarefaCalculo*) malloc(trab * sizeof(TarefaCalculo));
+    pthread_t     *tarefas = (pthread_t*) malloc(trab * sizeof(pthread_t));
+    if (tc == NULL || tarefas == NULL ||
+        pthread_barrier_init(&c.barreira, NULL, trab) != 0 ||
+        pthread_create(&es, NULL, tarefa_es, &d) != 0) {
+      fprintf(stderr, "\nErro ao criar tarefas fora do nucleo\n");
+      exit(1);
+    }
+
+    double t0 = tempoAgora();
+    for (int i = 0; i < trab; i++) {
+      tc[i].c  = &c;
+      tc[i].id = i;
+      if (pthread_create(&tarefas[i], NULL, tarefa_calculo, &tc[i]) != 0) {
+        fprintf(stderr, "\nErro ao criar tarefa\n");
+        exit(1);
+      }
+    }
+    for (int i = 0; i < trab; i++)
+      pthread_join(tarefas[i], NULL);
+
+    pthread_mutex_lock(&d.mutex);
+    d.terminar = 1;
+    pthread_cond_broadcast(&d.cond);
+    pthread_mutex_unlock(&d.mutex);
+    pthread_join(es, NULL);
+    if (fsync(d.fd) != 0 || d.erro)
+      res = -1;
+
+    r->tempo     = tempoAgora() - t0;
+    r->iteracoes = c.feitas;
+    r->delta     = c.delta;
+    r->abaixo    = c.abaixo;
+    r->fatia     = (int) S;
+    r->niveis    = (int) Tmax;
+    r->trab      = trab;
+    r->celulas_s = (double) N * N * c.feitas / r->tempo;
+
+    pthread_barrier_destroy(&c.barreira);
+    free(tc);
+    free(tarefas);
+  }
+
+  for (long t = 0; c.nivel != NULL && t <= Tmax; t++)
+    free(c.nivel[t]);
+  free(c.nivel);
+  free(c.deltas);
+  for (int k = 0; k < DISCO_BUFFERS; k++) {
+    free(d.leit[k]);
+    free(d.escr[k]);
+  }
+  pthread_mutex_destroy(&d.mutex);
+  pthread_cond_destroy(&d.cond);
+  close(d.fd);
+  return res;
+}
+
+/*--------------------------------------------------------------------
+| Function: discoMapear
+---------------------------------------------------------------------*/
+
+DoubleMatrix2D *discoMapear(char const *fich, int N) {
+  size_t          tam = (size_t) (N + 2) * (N + 2) * sizeof(double);
+  DoubleMatrix2D *m = (DoubleMatrix2D*) malloc(sizeof(DoubleMatrix2D));
+  int             fd = open(fich, O_RDONLY);
+
+  if (m == NULL || fd < 0) {
+    free(m);
+    if (fd >= 0)
+      close(fd);
+    return NULL;
+  }
+  m->n_l  = N + 2;
+  m->n_c  = N + 2;
+  m->data = (double*) mmap(NULL, tam, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (m->data == MAP_FAILED) {
+    free(m);
+    return NULL;
+  }
+  return m;
+}
+
+void discoDesmapear(DoubleMatrix2D *m) {
+  munmap(m->data, (size_t) m->n_l * m->n_c * sizeof(double));
+  free(m);
+}
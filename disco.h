@@ -0,0 +1,66 @@
+/*
+// Resolucao fora do nucleo: a grelha fica num ficheiro
+// Sistemas Operativos, DEI/IST/ULisboa 2017-18
+//
+// O ficheiro tem as (N+2) x (N+2) entradas em binario, por linhas, e
+// e' reescrito no proprio sitio. Cada passagem le o ficheiro por fatias
+// de S linhas e avanca T iteracoes: o nivel t (t = 0..T) guarda as
+// linhas ja' calculadas na iteracao k+t numa janela circular de S+2
+// linhas, e quando a fatia j chega ao nivel 0 cada nivel t calcula as
+// linhas [jS-t, (j+1)S-t[ a partir do nivel t-1. As linhas do nivel T
+// sao escritas no lugar das originais, que ja' foram lidas. Uma tarefa
+// de E/S le as fatias seguintes e escreve as anteriores enquanto as
+// trabalhadoras calculam.
+*/
+
+#ifndef DISCO_H
+#define DISCO_H
+
+#include <stddef.h>
+
+#include "matrix2d.h"
+
+/*--------------------------------------------------------------------
+| Type: ResultadoDisco
+---------------------------------------------------------------------*/
+
+typedef struct {
+  int    iteracoes;
+  double delta;         // delta da ultima iteracao
+  int    abaixo;        // primeira iteracao com delta < maxD; 0 se nenhuma
+  int    fatia;         // S, linhas por fatia
+  int    niveis;        // T, iteracoes por passagem
+  int    trab;          // trabalhadoras usadas, no maximo S
+  double tempo;         // segundos de calculo, incluindo E/S
+  double celulas_s;     // pontos actualizados por segundo
+} ResultadoDisco;
+
+/*--------------------------------------------------------------------
+| Function: discoIniciar
+| Description: Cria o ficheiro com o estado inicial (interior a zero),
+|              escrito linha a linha. Devolve 0 em caso de sucesso.
+---------------------------------------------------------------------*/
+int discoIniciar(char const *fich, int N, double tEsq, double tSup, double tDir, double tInf);
+
+/*--------------------------------------------------------------------
+| Function: discoResolver
+| Description: Faz ate' 'iter' iteracoes sobre o ficheiro com no
+|              maximo 'memoria' bytes de janelas e buffers e 'trab'
+|              trabalhadoras. Para no fim da passagem em que o delta
+|              desce abaixo de maxD: o ficheiro fica com o nivel T
+|              dessa passagem, ate' T-1 iteracoes depois da paragem em
+|              memoria (r->abaixo). Devolve 0 em caso de sucesso e -1
+|              se a memoria nao chegar para tres linhas por nivel.
+---------------------------------------------------------------------*/
+int discoResolver(char const *fich, int N, int iter, double maxD, size_t memoria, int trab,
+                  ResultadoDisco *r);
+
+/*--------------------------------------------------------------------
+| Function: discoMapear
+| Description: Mapeia o ficheiro (so' leitura) como matriz, para a
+|              saida. Libertar com discoDesmapear.
+---------------------------------------------------------------------*/
+DoubleMatrix2D *discoMapear(char const *fich, int N);
+void            discoDesmapear(DoubleMatrix2D *m);
+
+#endif
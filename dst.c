@@ -0,0 +1,346 @@
+/*
+// Resolucao directa da equacao de Laplace por transformada de senos
+// Sistemas Operativos, DEI/IST/ULisboa 2017-18
+*/
+
+#include "dst.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <complex.h>
+#include <pthread.h>
+
+/*--------------------------------------------------------------------
+| Type: PlanoDST
+| Description: Dados pre-calculados, partilhados (so' leitura) por
+|              todas as tarefas, para DSTs de comprimento N
+---------------------------------------------------------------------*/
+
+typedef struct {
+  int             N;
+  int             M;          // comprimento da FFT equivalente, 2(N+1)
+  int             L;          // comprimento da FFT radix-2 usada
+  double complex *raizes;     // e^(-2 pi i k/L), k < L/2
+  double complex *chirp;      // e^(-pi i n^2/M), n < M (so' Bluestein)
+  double complex *chirp_fft;  // FFT de conj(chirp) estendido (so' Bluestein)
+  double         *lambda;     // 2 - 2cos(pi k/(N+1)), k = 1..N
+} PlanoDST;
+
+/*--------------------------------------------------------------------
+| Type: TarefaDST
+---------------------------------------------------------------------*/
+
+typedef struct {
+  PlanoDST const    *p;
+  DoubleMatrix2D    *m;
+  double            *w;       // interior N x N, por linhas
+  int                id;
+  int                trab;
+  pthread_barrier_t *barreira;
+} TarefaDST;
+
+/*--------------------------------------------------------------------
+| Function: fft_radix2
+| Description: FFT iterativa in-place de comprimento L (potencia de 2).
+|              A inversa nao e' normalizada.
+---------------------------------------------------------------------*/
+
+static void fft_radix2(double complex *a, int L, double complex const *raizes, int inversa) {
+  for (int i = 1, j = 0; i < L; i++) {
+    int bit = L >> 1;
+    for (; j & bit; bit >>= 1)
+      j ^= bit;
+    j ^= bit;
+    if (i < j) {
+      double complex t = a[i];
+      a[i] = a[j];
+      a[j] = t;
+    }
+  }
+  for (int tam = 2; tam <= L; tam <<= 1) {
+    int metade = tam / 2, passo = L / tam;
+    for (int i = 0; i < L; i += tam) {
+      for (int k = 0; k < metade; k++) {
+        // produto escrito a' mao: o operador * de complex.h verifica
+        // infinitos e NaN em cada multiplicacao
+        double         wr = creal(raizes[k * passo]);
+        double         wi = inversa ? -cimag(raizes[k * passo]) : cimag(raizes[k * passo]);
+        double         br = creal(a[i + k + metade]), bi = cimag(a[i + k + metade]);
+        double complex u  = a[i + k];
+        double complex v  = (br * wr - bi * wi) + I * (br * wi + bi * wr);
+        a[i + k]          = u + v;
+        a[i + k + metade] = u - v;
+      }
+    }
+  }
+}
+
+/*--------------------------------------------------------------------
+| Function: fft_plano
+| Description: FFT de comprimento p->M de 'a'. Se M nao for potencia
+|              de 2, usa Bluestein: X(k) = w(k) * soma x(n) w(n)
+|              conj(w(k-n)), com w(n) = e^(-pi i n^2/M), sendo a
+|              convolucao feita com FFTs de comprimento L >= 2M-1 em
+|              'trabalho'.
+---------------------------------------------------------------------*/
+
+static void fft_plano(PlanoDST const *p, double complex *a, double complex *trabalho) {
+  if (p->L == p->M) {
+    fft_radix2(a, p->L, p->raizes, 0);
+    return;
+  }
+  for (int n = 0; n < p->M; n++)
+    trabalho[n] = a[n] * p->chirp[n];
+  for (int n = p->M; n < p->L; n++)
+    trabalho[n] = 0;
+  fft_radix2(trabalho, p->L, p->raizes, 0);
+  for (int n = 0; n < p->L; n++)
+    trabalho[n] *= p->chirp_fft[n];
+  fft_radix2(trabalho, p->L, p->raizes, 1);
+  for (int k = 0; k < p->M; k++)
+    a[k] = p->chirp[k] * trabalho[k] / p->L;
+}
+
+/*--------------------------------------------------------------------
+| Function: dst_par
+| Description: DST-I in-place de dois vectores de comprimento N com uma
+|              unica FFT: a extensao impar de x1 + i*x2 tem transformada
+|              -2i*X1 + 2*X2. 'x2' pode ser NULL.
+---------------------------------------------------------------------*/
+
+static void dst_par(PlanoDST const *p, double *x1, double *x2,
+                    double complex *a, double complex *trabalho) {
+  int N = p->N;
+
+  a[0]     = 0;
+  a[N + 1] = 0;
+  for (int n = 1; n <= N; n++) {
+    a[n]        = x1[n - 1] + I * (x2 != NULL ? x2[n - 1] : 0);
+    a[p->M - n] = -a[n];
+  }
+  fft_plano(p, a, trabalho);
+  for (int k = 1; k <= N; k++) {
+    x1[k - 1] = -cimag(a[k]) / 2;
+    if (x2 != NULL)
+      x2[k - 1] = creal(a[k]) / 2;
+  }
+}
+
+/*--------------------------------------------------------------------
+| Function: plano_criar
+---------------------------------------------------------------------*/
+
+static PlanoDST *plano_criar(int N) {
+  PlanoDST *p = (PlanoDST*) calloc(1, sizeof(PlanoDST));
+  if (p == NULL)
+    return NULL;
+
+  p->N = N;
+  p->M = 2 * (N + 1);
+  p->L = 1;
+  while (p->L < p->M)
+    p->L <<= 1;
+  if (p->L != p->M) {
+    p->L = 1;
+    while (p->L < 2 * p->M - 1)
+      p->L <<= 1;
+  }
+
+  p->raizes = (double complex*) malloc(p->L / 2 * sizeof(double complex));
+  p->lambda = (double*) malloc(N * sizeof(double));
+  if (p->raizes == NULL || p->lambda == NULL)
+    return p;
+  for (int k = 0; k < p->L / 2; k++)
+    p->raizes[k] = cexp(-2 * M_PI * I * k / p->L);
+  for (int k = 0; k < N; k++)
+    p->lambda[k] = 2 - 2 * cos(M_PI * (k + 1) / (N + 1));
+
+  if (p->L != p->M) {
+    p->chirp     = (double complex*) malloc(p->M * sizeof(double complex));
+    p->chirp_fft = (double complex*) calloc(p->L, sizeof(double complex));
+    if (p->chirp == NULL || p->chirp_fft == NULL)
+      return p;
+    for (long n = 0; n < p->M; n++) {
+      // n^2 mod 2M mantem o argumento pequeno e exacto
+      long r = n * n % (2L * p->M);
+      p->chirp[n] = cexp(-M_PI * I * r / p->M);
+    }
+    p->chirp_fft[0] = conj(p->chirp[0]);
+    for (int n = 1; n < p->M; n++)
+      p->chirp_fft[n] = p->chirp_fft[p->L - n] = conj(p->chirp[n]);
+    fft_radix2(p->chirp_fft, p->L, p->raizes, 0);
+  }
+  return p;
+}
+
+static void plano_libertar(PlanoDST *p) {
+  free(p->raizes);
+  free(p->chirp);
+  free(p->chirp_fft);
+  free(p->lambda);
+  free(p);
+}
+
+static int plano_completo(PlanoDST const *p) {
+  return p->raizes != NULL && p->lambda != NULL &&
+         (p->L == p->M || (p->chirp != NULL && p->chirp_fft != NULL));
+}
+
+/*--------------------------------------------------------------------
+| Function: dst_linhas
+| Description: DST das linhas [ini, fim[ de w, duas a duas
+---------------------------------------------------------------------*/
+
+static void dst_linhas(PlanoDST const *p, double *w, int ini, int fim,
+                       double complex *a, double complex *trabalho) {
+  int N = p->N;
+  for (int i = ini; i < fim; i += 2)
+    dst_par(p, &w[(long) i * N], i + 1 < fim ? &w[(long) (i + 1) * N] : NULL, a, trabalho);
+}
+
+/*--------------------------------------------------------------------
+| Function: tarefa_dst
+| Description: Cada tarefa fica com um bloco de linhas e um bloco de
+|              colunas. As quatro passagens (linhas, colunas, linhas,
+|              colunas) sao separadas por barreiras. As colunas sao
+|              copiadas para vectores contiguos antes de transformar.
+---------------------------------------------------------------------*/
+
+static void *tarefa_dst(void *args) {
+  TarefaDST      *t = (TarefaDST*) args;
+  PlanoDST const *p = t->p;
+  int             N = p->N;
+  double         *w = t->w;
+  int             ini = (long) N * t->id / t->trab;
+  int             fim = (long) N * (t->id + 1) / t->trab;
+  double          escala = (2.0 / (N + 1)) * (2.0 / (N + 1));
+
+  double complex *a        = (double complex*) malloc(p->M * sizeof(double complex));
+  double complex *trabalho = (double complex*) malloc(p->L * sizeof(double complex));
+  double         *col1     = (double*) malloc(N * sizeof(double));
+  double         *col2     = (double*) malloc(N * sizeof(double));
+  if (a == NULL || trabalho == NULL || col1 == NULL || col2 == NULL) {
+    fprintf(stderr, "\nErro ao alocar memoria para a DST\n");
+    exit(1);
+  }
+
+  // segundo membro: contribuicao das fronteiras vizinhas
+  for (int i = ini; i < fim; i++) {
+    double *linha = &w[(long) i * N];
+    for (int j = 0; j < N; j++)
+      linha[j] = 0;
+    linha[0]     += dm2dGetEntry(t->m, i + 1, 0);
+    linha[N - 1] += dm2dGetEntry(t->m, i + 1, N + 1);
+    if (i == 0)
+      for (int j = 0; j < N; j++)
+        linha[j] += dm2dGetEntry(t->m, 0, j + 1);
+    if (i == N - 1)
+      for (int j = 0; j < N; j++)
+        linha[j] += dm2dGetEntry(t->m, N + 1, j + 1);
+  }
+  dst_linhas(p, w, ini, fim, a, trabalho);
+  pthread_barrier_wait(t->barreira);
+
+  // colunas e divisao pelos valores proprios
+  for (int j = ini; j < fim; j += 2) {
+    int par = j + 1 < fim;
+    for (int i = 0; i < N; i++) {
+      col1[i] = w[(long) i * N + j];
+      if (par)
+        col2[i] = w[(long) i * N + j + 1];
+    }
+    dst_par(p, col1, par ? col2 : NULL, a, trabalho);
+    for (int i = 0; i < N; i++) {
+      w[(long) i * N + j] = col1[i] / (p->lambda[i] + p->lambda[j]);
+      if (par)
+        w[(long) i * N + j + 1] = col2[i] / (p->lambda[i] + p->lambda[j + 1]);
+    }
+  }
+  pthread_barrier_wait(t->barreira);
+
+  dst_linhas(p, w, ini, fim, a, trabalho);
+  pthread_barrier_wait(t->barreira);
+
+  // ultima passagem: escrever directamente no interior de m
+  for (int j = ini; j < fim; j += 2) {
+    int par = j + 1 < fim;
+    for (int i = 0; i < N; i++) {
+      col1[i] = w[(long) i * N + j];
+      if (par)
+        col2[i] = w[(long) i * N + j + 1];
+    }
+    dst_par(p, col1, par ? col2 : NULL, a, trabalho);
+    for (int i = 0; i < N; i++) {
+      dm2dSetEntry(t->m, i + 1, j + 1, col1[i] * escala);
+      if (par)
+        dm2dSetEntry(t->m, i + 1, j + 2, col2[i] * escala);
+    }
+  }
+
+  free(a);
+  free(trabalho);
+  free(col1);
+  free(col2);
+  return NULL;
+}
+
+/*--------------------------------------------------------------------
+| Function: dstResolver
+---------------------------------------------------------------------*/
+
+int dstResolver(DoubleMatrix2D *m, int trab) {
+  int               N = m->n_l - 2;
+  PlanoDST         *p;
+  double           *w;
+  pthread_t        *tarefas;
+  TarefaDST        *info;
+  pthread_barrier_t barreira;
+
+  if (N < 1 || m->n_c != m->n_l)
+    return -1;
+  if (trab < 1)
+    trab = 1;
+  if (trab > N)
+    trab = N;
+
+  p = plano_criar(N);
+  if (p == NULL)
+    return -1;
+  w       = (double*) malloc((size_t) N * N * sizeof(double));
+  tarefas = (pthread_t*) malloc(trab * sizeof(pthread_t));
+  info    = (TarefaDST*) malloc(trab * sizeof(TarefaDST));
+  if (!plano_completo(p) || w == NULL || tarefas == NULL || info == NULL) {
+    plano_libertar(p);
+    free(w);
+    free(tarefas);
+    free(info);
+    return -1;
+  }
+
+  if (pthread_barrier_init(&barreira, NULL, trab) != 0) {
+    fprintf(stderr, "\nErro ao inicializar barreira\n");
+    exit(1);
+  }
+  for (int i = 0; i < trab; i++) {
+    info[i].p        = p;
+    info[i].m        = m;
+    info[i].w        = w;
+    info[i].id       = i;
+    info[i].trab     = trab;
+    info[i].barreira = &barreira;
+    if (pthread_create(&tarefas[i], NULL, tarefa_dst, &info[i]) != 0) {
+      fprintf(stderr, "\nErro ao criar tarefa\n");
+      exit(1);
+    }
+  }
+  for (int i = 0; i < trab; i++)
+    pthread_join(tarefas[i], NULL);
+
+  pthread_barrier_destroy(&barreira);
+  plano_libertar(p);
+  free(w);
+  free(tarefas);
+  free(info);
+  return 0;
+}
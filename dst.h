@@ -0,0 +1,31 @@
+/*
+// Resolucao directa da equacao de Laplace por transformada de senos
+// Sistemas Operativos, DEI/IST/ULisboa 2017-18
+//
+// O sistema do estado estacionario, 4u(i,j) - vizinhos = fronteira, e'
+// diagonalizado pela DST-I em cada direccao: os valores proprios do
+// operador 1D sao lambda(k) = 2 - 2cos(pi k/(N+1)). A solucao obtem-se
+// com uma DST 2D do segundo membro, uma divisao por lambda(k)+lambda(l)
+// e outra DST 2D, em O(N^2 log N). Cada DST de comprimento N e' uma FFT
+// de comprimento 2(N+1) sobre a extensao impar dos dados, calculada em
+// radix-2 ou, se esse comprimento nao for potencia de 2, pelo algoritmo
+// de Bluestein.
+*/
+
+#ifndef DST_H
+#define DST_H
+
+#include "matrix2d.h"
+
+/*--------------------------------------------------------------------
+| Function: dstResolver
+| Description: Calcula o estado estacionario exacto (a menos do
+|              arredondamento) do interior de 'm', um (N+2)x(N+2) cujas
+|              linhas e colunas exteriores ja' tem as temperaturas de
+|              fronteira, que podem ser quaisquer. Usa 'trab' tarefas,
+|              que dividem entre si as transformadas de linhas e
+|              colunas. Devolve 0 em caso de sucesso.
+---------------------------------------------------------------------*/
+int dstResolver(DoubleMatrix2D *m, int trab);
+
+#endif
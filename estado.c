@@ -0,0 +1,90 @@
+/*
+// Estado retomavel de uma simulacao interrompida
+// Sistemas Operativos, DEI/IST/ULisboa 2017-18
+*/
+
+#include "estado.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+
+/*--------------------------------------------------------------------
+| Type: CabecalhoEstado
+---------------------------------------------------------------------*/
+
+typedef struct {
+  char    magico[4];
+  int32_t N;
+  int32_t iteracoes;
+  int32_t reservado;
+  double  delta;
+  double  t[4];
+} CabecalhoEstado;
+
+/*--------------------------------------------------------------------
+| Function: estadoGuardar
+---------------------------------------------------------------------*/
+
+int estadoGuardar(char const *nome, DoubleMatrix2D *m, EstadoGuardado const *e) {
+  char            tmp[520];
+  CabecalhoEstado cab;
+  size_t          pontos = (size_t) m->n_l * m->n_c;
+
+  snprintf(tmp, sizeof(tmp), "%s~", nome);
+
+  memcpy(cab.magico, "HSCK", 4);
+  cab.N         = e->N;
+  cab.iteracoes = e->iteracoes;
+  cab.reservado = 0;
+  cab.delta     = e->delta;
+  memcpy(cab.t, e->t, sizeof(cab.t));
+
+  FILE *f = fopen(tmp, "wb");
+  if (f == NULL)
+    return -1;
+  if (fwrite(&cab, sizeof(cab), 1, f) != 1 || fwrite(m->data, sizeof(double), pontos, f) != pontos) {
+    fclose(f);
+    unlink(tmp);
+    return -1;
+  }
+  if (fclose(f) != 0)
+    return -1;
+  return rename(tmp, nome);
+}
+
+/*--------------------------------------------------------------------
+| Function: estadoCarregar
+---------------------------------------------------------------------*/
+
+int estadoCarregar(char const *nome, DoubleMatrix2D *m, EstadoGuardado *e) {
+  CabecalhoEstado cab;
+  size_t          pontos = (size_t) m->n_l * m->n_c;
+  double         *dados;
+
+  FILE *f = fopen(nome, "rb");
+  if (f == NULL)
+    return -1;
+  if (fread(&cab, sizeof(cab), 1, f) != 1 || memcmp(cab.magico, "HSCK", 4) != 0 ||
+      cab.N != e->N || memcmp(cab.t, e->t, sizeof(cab.t)) != 0 ||
+      (size_t) (cab.N + 2) * (cab.N + 2) != pontos) {
+    fclose(f);
+    return -1;
+  }
+  // ler para um buffer, para nao deixar m a meio se o ficheiro for curto
+  dados = (double*) malloc(pontos * sizeof(double));
+  if (dados == NULL || fread(dados, sizeof(double), pontos, f) != pontos) {
+    free(dados);
+    fclose(f);
+    return -1;
+  }
+  fclose(f);
+
+  memcpy(m->data, dados, pontos * sizeof(double));
+  free(dados);
+  e->iteracoes = cab.iteracoes;
+  e->delta     = cab.delta;
+  return 0;
+}
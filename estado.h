@@ -0,0 +1,44 @@
+/*
+// Estado retomavel de uma simulacao interrompida
+// Sistemas Operativos, DEI/IST/ULisboa 2017-18
+//
+// Guardado ao lado de fichS, em fichS.estado, com o cabecalho "HSCK",
+// int32 N, int32 iteracoes, double delta, double tEsq, tSup, tDir,
+// tInf, seguido de (N+2)*(N+2) doubles. Ao contrario do fichS (texto
+// com 4 casas decimais), a matriz e' exacta: a retoma continua a mesma
+// sequencia de iteracoes.
+*/
+
+#ifndef ESTADO_H
+#define ESTADO_H
+
+#include "matrix2d.h"
+
+/*--------------------------------------------------------------------
+| Type: EstadoGuardado
+---------------------------------------------------------------------*/
+
+typedef struct {
+  int    N;
+  int    iteracoes;   // concluidas
+  double delta;       // da ultima iteracao
+  double t[4];        // tEsq, tSup, tDir, tInf
+} EstadoGuardado;
+
+/*--------------------------------------------------------------------
+| Function: estadoGuardar
+| Description: Escreve m e *e em 'nome', por um ficheiro temporario,
+|              pelo que o anterior so' e' substituido por um completo.
+|              Devolve 0 em caso de sucesso.
+---------------------------------------------------------------------*/
+int estadoGuardar(char const *nome, DoubleMatrix2D *m, EstadoGuardado const *e);
+
+/*--------------------------------------------------------------------
+| Function: estadoCarregar
+| Description: Le 'nome' para m se tiver o N e as temperaturas de *e,
+|              e completa *e com as iteracoes e o delta. Devolve 0 se
+|              o leu; m so' e' alterado nesse caso.
+---------------------------------------------------------------------*/
+int estadoCarregar(char const *nome, DoubleMatrix2D *m, EstadoGuardado *e);
+
+#endif
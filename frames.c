@@ -0,0 +1,228 @@
+/*
+// Captura de frames intermedios para visualizacao
+// Sistemas Operativos, DEI/IST/ULisboa 2017-18
+*/
+
+#include "frames.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+
+/*--------------------------------------------------------------------
+| Types
+---------------------------------------------------------------------*/
+
+typedef enum {
+  SLOT_LIVRE,
+  SLOT_RESERVADO,
+  SLOT_PRONTO
+} EstadoSlot;
+
+typedef struct {
+  EstadoSlot  estado;
+  int         iteracao;
+  double      delta;
+  int         faltam;     // trabalhadoras que ainda nao copiaram
+  double     *dados;
+} Slot;
+
+/*--------------------------------------------------------------------
+| Global variables
+---------------------------------------------------------------------*/
+
+static int             ativo = 0;
+static FILE           *ficheiro;
+static Slot           *slots;
+static int             nslots;
+static int             proximo_reservar;
+static int             proximo_escrever;
+static int             pedido[2] = { -1, -1 };  // buffer de cada paridade
+static int             periodo_frames;
+static int             reducao_frames;
+static int             linhas_frame;
+static int             colunas_frame;
+static int             trabalhadoras;
+static PoliticaFrames  politica_frames;
+static int             terminar;
+
+static int             escritos, descartados, bloqueios;
+
+static pthread_mutex_t mutex     = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  livre     = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t  pronto    = PTHREAD_COND_INITIALIZER;
+static pthread_t       escritora;
+
+/*--------------------------------------------------------------------
+| Function: escrever_frames
+| Description: Tarefa escritora: escreve os frames prontos pela ordem
+|              em que foram reservados e liberta os buffers
+---------------------------------------------------------------------*/
+
+static void *escrever_frames(void *arg) {
+  pthread_mutex_lock(&mutex);
+  for (;;) {
+    Slot *s = &slots[proximo_escrever];
+
+    while (s->estado != SLOT_PRONTO && !terminar)
+      pthread_cond_wait(&pronto, &mutex);
+    if (s->estado != SLOT_PRONTO)
+      break;
+    pthread_mutex_unlock(&mutex);
+
+    int32_t cab[3] = { s->iteracao, linhas_frame, colunas_frame };
+    if (fwrite(cab, sizeof(cab), 1, ficheiro) != 1 ||
+        fwrite(&s->delta, sizeof(double), 1, ficheiro) != 1 ||
+        fwrite(s->dados, sizeof(double), (size_t) linhas_frame * colunas_frame, ficheiro)
+          != (size_t) linhas_frame * colunas_frame)
+      fprintf(stderr, "\nErro ao escrever frame da iteracao %d\n", s->iteracao);
+
+    pthread_mutex_lock(&mutex);
+    s->estado = SLOT_LIVRE;
+    escritos++;
+    proximo_escrever = (proximo_escrever + 1) % nslots;
+    pthread_cond_broadcast(&livre);
+  }
+  pthread_mutex_unlock(&mutex);
+  return NULL;
+}
+
+/*--------------------------------------------------------------------
+| Function: framesIniciar
+---------------------------------------------------------------------*/
+
+int framesIniciar(char const *fich, int linhas, int colunas, int periodo, int reducao,
+                  int nbuffers, PoliticaFrames politica, int trab) {
+  periodo_frames  = periodo;
+  reducao_frames  = reducao;
+  linhas_frame    = (linhas + reducao - 1) / reducao;
+  colunas_frame   = (colunas + reducao - 1) / reducao;
+  nslots          = nbuffers;
+  politica_frames = politica;
+  trabalhadoras   = trab;
+
+  slots = (Slot*) calloc(nslots, sizeof(Slot));
+  if (slots == NULL)
+    return -1;
+  for (int i = 0; i < nslots; i++) {
+    slots[i].estado = SLOT_LIVRE;
+    slots[i].dados  = (double*) malloc(sizeof(double) * linhas_frame * colunas_frame);
+    if (slots[i].dados == NULL)
+      return -1;
+  }
+
+  ficheiro = fopen(fich, "wb");
+  if (ficheiro == NULL)
+    return -1;
+  int32_t cab[4] = { 1, linhas, colunas, reducao };
+  if (fwrite("HSFR", 4, 1, ficheiro) != 1 || fwrite(cab, sizeof(cab), 1, ficheiro) != 1)
+    return -1;
+
+  if (pthread_create(&escritora, NULL, escrever_frames, NULL) != 0)
+    return -1;
+  ativo = 1;
+  return 0;
+}
+
+/*--------------------------------------------------------------------
+| Function: framesReservar
+---------------------------------------------------------------------*/
+
+void framesReservar(int iteracoes, double delta) {
+  if (!ativo)
+    return;
+  pedido[iteracoes % 2] = -1;
+  if (iteracoes % periodo_frames != 0)
+    return;
+
+  pthread_mutex_lock(&mutex);
+  Slot *s = &slots[proximo_reservar];
+  if (s->estado != SLOT_LIVRE) {
+    if (politica_frames == FRAMES_DESCARTAR) {
+      descartados++;
+      pthread_mutex_unlock(&mutex);
+      return;
+    }
+    bloqueios++;
+    while (s->estado != SLOT_LIVRE)
+      pthread_cond_wait(&livre, &mutex);
+  }
+  s->estado   = SLOT_RESERVADO;
+  s->iteracao = iteracoes;
+  s->delta    = delta;
+  s->faltam   = trabalhadoras;
+  pedido[iteracoes % 2] = proximo_reservar;
+  proximo_reservar = (proximo_reservar + 1) % nslots;
+  pthread_mutex_unlock(&mutex);
+}
+
+/*--------------------------------------------------------------------
+| Function: framesCopiar
+---------------------------------------------------------------------*/
+
+void framesCopiar(int iteracoes, DoubleMatrix2D *m, int lo, int hi) {
+  if (!ativo || pedido[iteracoes % 2] < 0)
+    return;
+
+  Slot *s   = &slots[pedido[iteracoes % 2]];
+  int   red = reducao_frames;
+
+  // primeira linha amostrada dentro de [lo, hi[
+  for (int l = (lo + red - 1) / red * red; l < hi; l += red) {
+    double *orig  = dm2dGetLine(m, l);
+    double *dest  = &s->dados[(long) (l / red) * colunas_frame];
+    if (red == 1) {
+      memcpy(dest, orig, sizeof(double) * colunas_frame);
+    } else {
+      for (int c = 0; c < colunas_frame; c++)
+        dest[c] = orig[c * red];
+    }
+  }
+
+  if (__atomic_sub_fetch(&s->faltam, 1, __ATOMIC_ACQ_REL) == 0) {
+    pthread_mutex_lock(&mutex);
+    s->estado = SLOT_PRONTO;
+    pthread_cond_signal(&pronto);
+    pthread_mutex_unlock(&mutex);
+  }
+}
+
+/*--------------------------------------------------------------------
+| Function: framesParar
+---------------------------------------------------------------------*/
+
+void framesParar(void) {
+  if (!ativo)
+    return;
+
+  pthread_mutex_lock(&mutex);
+  terminar = 1;
+  pthread_cond_signal(&pronto);
+  pthread_mutex_unlock(&mutex);
+  pthread_join(escritora, NULL);
+
+  fclose(ficheiro);
+  for (int i = 0; i < nslots; i++)
+    free(slots[i].dados);
+  free(slots);
+  ativo = 0;
+
+  fprintf(stderr, "Frames: %d escritos (%dx%d), %d descartados, %d esperas por buffer\n",
+          escritos, linhas_frame, colunas_frame, descartados, bloqueios);
+}
+
+/*--------------------------------------------------------------------
+| Function: framesPoliticaPorNome
+---------------------------------------------------------------------*/
+
+int framesPoliticaPorNome(char const *nome, PoliticaFrames *p) {
+  if (strcmp(nome, "descartar") == 0)
+    *p = FRAMES_DESCARTAR;
+  else if (strcmp(nome, "bloquear") == 0)
+    *p = FRAMES_BLOQUEAR;
+  else
+    return -1;
+  return 0;
+}
@@ -0,0 +1,67 @@
+/*
+// Captura de frames intermedios para visualizacao
+// Sistemas Operativos, DEI/IST/ULisboa 2017-18
+//
+// Formato do ficheiro (binario, ordem de bytes da maquina):
+//   cabecalho: "HSFR", int32 versao, int32 linhas e colunas da matriz
+//              completa, int32 reducao
+//   frames:    int32 iteracao, int32 linhas, int32 colunas,
+//              double delta, seguido de linhas*colunas doubles
+*/
+
+#ifndef FRAMES_H
+#define FRAMES_H
+
+#include "matrix2d.h"
+
+/*--------------------------------------------------------------------
+| Type: PoliticaFrames
+| Description: O que fazer quando todos os buffers estao ocupados
+|              porque o disco nao acompanha: descartar o frame, ou
+|              bloquear as trabalhadoras ate' haver buffer livre
+---------------------------------------------------------------------*/
+
+typedef enum {
+  FRAMES_DESCARTAR,
+  FRAMES_BLOQUEAR
+} PoliticaFrames;
+
+/*--------------------------------------------------------------------
+| Function: framesIniciar
+| Description: Abre o ficheiro de frames e lanca a tarefa escritora.
+|              Captura a matriz de 'periodo' em 'periodo' iteracoes,
+|              guardando uma em cada 'reducao' linhas e colunas, com
+|              'nbuffers' buffers em anel. 'trab' e' o numero de
+|              trabalhadoras que copiam cada frame. Devolve 0 em caso
+|              de sucesso.
+---------------------------------------------------------------------*/
+int  framesIniciar(char const *fich, int linhas, int colunas, int periodo, int reducao,
+                   int nbuffers, PoliticaFrames politica, int trab);
+
+/*--------------------------------------------------------------------
+| Function: framesReservar
+| Description: Chamada na barreira no fim de cada iteracao. Se houver
+|              frame a capturar reserva-lhe um buffer, segundo a
+|              politica escolhida.
+---------------------------------------------------------------------*/
+void framesReservar(int iteracoes, double delta);
+
+/*--------------------------------------------------------------------
+| Function: framesCopiar
+| Description: Chamada por cada trabalhadora logo depois da barreira
+|              da iteracao 'iteracoes': copia as linhas [lo, hi[ de
+|              'm' que pertencem ao frame, se foi reservado. A ultima
+|              trabalhadora a copiar entrega o frame a escritora.
+---------------------------------------------------------------------*/
+void framesCopiar(int iteracoes, DoubleMatrix2D *m, int lo, int hi);
+
+/*--------------------------------------------------------------------
+| Function: framesParar
+| Description: Escreve os frames pendentes, termina a escritora,
+|              fecha o ficheiro e mostra estatisticas em stderr
+---------------------------------------------------------------------*/
+void framesParar(void);
+
+int  framesPoliticaPorNome(char const *nome, PoliticaFrames *p);
+
+#endif
@@ -0,0 +1,801 @@
+/*
+// libheatsim: o resolvedor de Jacobi paralelo, sem estado global
+// Sistemas Operativos, DEI/IST/ULisboa 2017-18
+*/
+
+#define _GNU_SOURCE
+#include "heatsim.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+#include "kernels.h"
+#include "adi.h"
+#include "mplib3.h"
+#include "medicao.h"
+
+// desequilibrio (tempo da fatia mais lenta sobre a media) abaixo do
+// qual a reparticao adaptativa nao mexe nas fatias
+#define REPARTIR_LIMIAR  0.10
+
+/*--------------------------------------------------------------------
+| Types
+---------------------------------------------------------------------*/
+
+// medidas de uma trabalhadora, cada uma na sua linha de cache
+typedef struct {
+  HeatSimFatia f;
+  double       calculo;       // desde a ultima reparticao
+} __attribute__((aligned(64))) Medida;
+
+struct heatsim_t {
+  HeatSimOpcoes       op;
+  DoubleMatrix2D      vistas[2];    // sobre os buffers, sem copia
+  DoubleMatrix2D     *m[2];         // iguais quando no proprio sitio
+  double             *proprios[2];  // buffers reservados pela biblioteca
+  int                 iteracoes;    // concluidas desde o inicio
+  double              delta;
+  int                 base;         // iteracoes antes da corrida actual
+  HeatSimFim          fim;
+  HeatSimCopiar       copiar;
+  void               *arg;
+  double              prazo;        // 0: sem prazo
+  int                 pedido;       // heatsimParar
+  int                 parar;        // decidido na barreira
+  int                 motivo;
+
+  // so' durante uma corrida, escritos pela ultima a chegar 'a barreira
+  int                 iter_max;
+  double              maxD;
+  double              t_ultima;     // fim da iteracao anterior
+  double              t_iter;       // estimativa da duracao de uma iteracao
+  pthread_mutex_t     partida;      // fechado ate' todas estarem criadas
+  int                 cancelada;    // nem todas foram criadas
+
+  // reparticao adaptativa (op.reparticao > 0); as fronteiras e as
+  // velocidades passam de uma corrida para a seguinte
+  int                *limites;      // fatia t: linhas [limites[t], limites[t+1][
+  double             *velocidades;  // linhas por segundo, media
+  Medida             *medidas;
+  int                 mudancas;
+
+  DualBarrierWithMax *barreira;
+  DoubleMatrix2D     *anderson;     // g(k-1)
+  pthread_barrier_t   barreira_produtos;
+  pthread_barrier_t   barreira_adi;
+  pthread_barrier_t   barreira_estat;
+};
+
+/*--------------------------------------------------------------------
+| Type: thread_info
+| Description: Estrutura com Informacao para Trabalhadoras
+---------------------------------------------------------------------*/
+
+typedef struct {
+  HeatSim  *sim;
+  int       id;
+  int       iter;
+  int       trab;
+  int       tam_fatia;
+  double    maxD;
+  KernelFn  kernel;
+  Estatisticas *estat;
+  double   *produtos;
+  PlanoADI *adi;
+  double   *halos;       // so' no proprio sitio
+  double   *linhas[2];
+  double   *vizinhas;    // com mensagens: linhas ini-1 e fim recebidas
+} thread_info;
+
+/*--------------------------------------------------------------------
+| Function: estatisticas_fatia
+| Description: Calcula, para as linhas [ini, fim[ da matriz final, o
+|              minimo, maximo, soma e histograma. O intervalo do
+|              histograma e' o global, pelo que as trabalhadoras se
+|              sincronizam entre as duas passagens.
+---------------------------------------------------------------------*/
+
+static void estatisticas_fatia(thread_info *tinfo, DoubleMatrix2D *m, int ini, int fim) {
+  Estatisticas *todas = tinfo->estat - tinfo->id;
+  int           N     = tinfo->sim->op.N;
+  double        min, max;
+
+  estatParcial(m, ini, fim, 1, N+1, tinfo->estat);
+  pthread_barrier_wait(&tinfo->sim->barreira_estat);
+
+  min = todas[0].min;
+  max = todas[0].max;
+  for (int t = 1; t < tinfo->trab; t++) {
+    min = todas[t].min < min ? todas[t].min : min;
+    max = todas[t].max > max ? todas[t].max : max;
+  }
+  estatHistograma(m, ini, fim, 1, N+1, min, max, tinfo->estat);
+}
+
+/*--------------------------------------------------------------------
+| Function: passo_anderson
+| Description: Uma iteracao de Anderson sobre as linhas [ini, fim[:
+|              produtos internos parciais, reducao entre trabalhadoras
+|              (somada por todas na mesma ordem) e actualizacao. A
+|              primeira iteracao e' de Jacobi.
+---------------------------------------------------------------------*/
+
+static double passo_anderson(thread_info *tinfo, int iter, DoubleMatrix2D *x,
+                             DoubleMatrix2D *ant, int ini, int fim) {
+  HeatSim *s = tinfo->sim;
+  double p[2] = { 0, 0 };
+  double theta = 0;
+  double max_delta = andersonProdutos(x, ant, s->anderson, ini, fim, s->op.N, p);
+
+  if (iter > 0) {
+    double fdf = 0, dfdf = 0;
+    tinfo->produtos[2*tinfo->id]   = p[0];
+    tinfo->produtos[2*tinfo->id+1] = p[1];
+    pthread_barrier_wait(&s->barreira_produtos);
+    for (int t = 0; t < tinfo->trab; t++) {
+      fdf  += tinfo->produtos[2*t];
+      dfdf += tinfo->produtos[2*t+1];
+    }
+    if (dfdf > 0)
+      theta = fdf / dfdf;
+  }
+  andersonAtualizar(x, ant, s->anderson, ini, fim, s->op.N, theta);
+  return max_delta;
+}
+
+/*--------------------------------------------------------------------
+| Function: passo_adi
+| Description: Um passo ADI: linhas [ini, fim[ no primeiro meio passo e
+|              colunas [ini, fim[ no segundo. O delta e' o do primeiro
+|              meio passo.
+---------------------------------------------------------------------*/
+
+static double passo_adi(thread_info *tinfo, DoubleMatrix2D *de, DoubleMatrix2D *para,
+                        int ini, int fim) {
+  double max_delta = adiLinhas(tinfo->adi, de, para, ini, fim);
+  pthread_barrier_wait(&tinfo->sim->barreira_adi);
+  adiSegundoMembro(tinfo->adi, de, para, ini, fim);
+  pthread_barrier_wait(&tinfo->sim->barreira_adi);
+  adiColunas(tinfo->adi, para, ini, fim);
+  return max_delta;
+}
+
+/*--------------------------------------------------------------------
+| Function: linha_halo
+| Description: Copia guardada da primeira (lado 0) ou ultima (lado 1)
+|              linha da trabalhadora 't', na paridade 'p'
+---------------------------------------------------------------------*/
+
+static double *linha_halo(thread_info *tinfo, int p, int t, int lado) {
+  return tinfo->halos + ((long) (p * tinfo->trab + t) * 2 + lado) * (tinfo->sim->op.N + 2);
+}
+
+/*--------------------------------------------------------------------
+| Function: passo_no_lugar
+| Description: Uma iteracao de Jacobi na matriz unica. As linhas das
+|              vizinhas vem das copias da paridade 'atual', e as
+|              primeira e ultima linhas novas ficam na outra paridade,
+|              que ninguem le ate' a barreira.
+---------------------------------------------------------------------*/
+
+static double passo_no_lugar(thread_info *tinfo, int atual, int ini, int fim) {
+  DoubleMatrix2D *m = tinfo->sim->m[0];
+  int N = tinfo->sim->op.N;
+  int t = tinfo->id;
+  double const *cima  = t == 0 ? dm2dGetLine(m, 0) : linha_halo(tinfo, atual, t-1, 1);
+  double const *baixo = t == tinfo->trab - 1 ? dm2dGetLine(m, N+1)
+                                             : linha_halo(tinfo, atual, t+1, 0);
+  double max_delta = kernelNoLugar(m, ini, fim, N, cima, baixo, tinfo->linhas);
+
+  memcpy(linha_halo(tinfo, 1-atual, t, 0), dm2dGetLine(m, ini),   (N+2) * sizeof(double));
+  memcpy(linha_halo(tinfo, 1-atual, t, 1), dm2dGetLine(m, fim-1), (N+2) * sizeof(double));
+  return max_delta;
+}
+
+/*--------------------------------------------------------------------
+| Function: enviar_pontas
+| Description: Envia as linhas ini e fim-1 de 'm', da iteracao 'k', as
+|              vizinhas de cima e de baixo, sem esperar, com a
+|              etiqueta k. Os pedidos ficam em env[0..1].
+---------------------------------------------------------------------*/
+
+static void enviar_pontas(thread_info *tinfo, DoubleMatrix2D *m, int ini, int fim, int k,
+                          PedidoMP env[2]) {
+  long tam = (tinfo->sim->op.N + 2) * sizeof(double);
+  int  t   = tinfo->id;
+
+  env[0] = t > 0 ? enviarMensagemEtiqAssinc(t, t-1, k, dm2dGetLine(m, ini), tam) : NULL;
+  env[1] = t < tinfo->trab - 1 ?
+           enviarMensagemEtiqAssinc(t, t+1, k, dm2dGetLine(m, fim-1), tam) : NULL;
+}
+
+/*--------------------------------------------------------------------
+| Function: receber_vizinhas
+| Description: Pede as linhas da iteracao 'k' das vizinhas de cima e de
+|              baixo para viz[0] e viz[1]
+---------------------------------------------------------------------*/
+
+static void receber_vizinhas(thread_info *tinfo, int k, double *viz[2], PedidoMP rec[2]) {
+  long tam = (tinfo->sim->op.N + 2) * sizeof(double);
+  int  t   = tinfo->id;
+
+  rec[0] = t > 0 ? receberMensagemEtiqAssinc(t-1, t, k, viz[0], tam, NULL) : NULL;
+  rec[1] = t < tinfo->trab - 1 ? receberMensagemEtiqAssinc(t+1, t, k, viz[1], tam, NULL) : NULL;
+}
+
+/*--------------------------------------------------------------------
+| Function: passo_mensagens
+| Description: Uma iteracao com as linhas das vizinhas recebidas por
+|              mensagem: pede as duas linhas, calcula o interior da
+|              fatia enquanto chegam, e calcula cada ponta quando
+|              chega a linha de que precisa. No fim envia as pontas
+|              novas, que as vizinhas recebem na iteracao seguinte.
+|              Os envios anteriores, em env, concluem-se aqui.
+---------------------------------------------------------------------*/
+
+static double passo_mensagens(thread_info *tinfo, int iter, DoubleMatrix2D *de,
+                              DoubleMatrix2D *para, int ini, int fim, PedidoMP env[2]) {
+  int     N   = tinfo->sim->op.N;
+  int     t   = tinfo->id;
+  double *viz[2] = { tinfo->vizinhas, tinfo->vizinhas + N + 2 };
+  PedidoMP rec[2];
+  double  max_delta = 0, d;
+
+  receber_vizinhas(tinfo, iter, viz, rec);
+  // nas fatias das pontas, a fronteira fixa faz de vizinha
+  if (t == 0)
+    viz[0] = dm2dGetLine(de, 0);
+  if (t == tinfo->trab - 1)
+    viz[1] = dm2dGetLine(de, N+1);
+
+  if (fim - ini > 2)
+    max_delta = tinfo->kernel(de, para, ini + 1, fim - 1, N, tinfo->sim->op.bloco);
+
+  if (fim - ini == 1) {
+    esperarTodos(rec, 2, NULL);
+    max_delta = kernelLinha(viz[0], dm2dGetLine(de, ini), viz[1], dm2dGetLine(para, ini), N);
+  } else {
+    // cada ponta logo que a sua vizinha chegar; as fixas primeiro
+    int ordem[2], n = 0, k;
+    for (k = 0; k < 2; k++)
+      if (rec[k] == NULL)
+        ordem[n++] = k;
+    while (n > 0 || (k = esperarQualquer(rec, 2, NULL)) >= 0) {
+      if (n > 0)
+        k = ordem[--n];
+      int i = k == 0 ? ini : fim - 1;
+      d = kernelLinha(k == 0 ? viz[0] : dm2dGetLine(de, i-1), dm2dGetLine(de, i),
+                      k == 1 ? viz[1] : dm2dGetLine(de, i+1), dm2dGetLine(para, i), N);
+      max_delta = d > max_delta ? d : max_delta;
+    }
+  }
+
+  // as vizinhas ja' receberam as pontas da iteracao anterior
+  esperarTodos(env, 2, NULL);
+  enviar_pontas(tinfo, para, ini, fim, iter + 1, env);
+  return max_delta;
+}
+
+/*--------------------------------------------------------------------
+| Function: tarefa_trabalhadora
+| Description: Funcao executada por cada tarefa trabalhadora.
+|              Recebe como argumento uma estrutura do tipo thread_info
+---------------------------------------------------------------------*/
+
+static void *tarefa_trabalhadora(void *args) {
+  thread_info *tinfo = (thread_info *) args;
+  HeatSim *s = tinfo->sim;
+  DoubleMatrix2D **m = s->m;
+  int N = s->op.N;
+  int ini = tinfo->id * tinfo->tam_fatia + 1;
+  int fim = ini + tinfo->tam_fatia;
+  // linhas de que esta trabalhadora e' responsavel ao copiar frames,
+  // incluindo as fronteiras de cima e de baixo
+  int lo = tinfo->id == 0 ? 0 : ini;
+  int hi = tinfo->id == tinfo->trab - 1 ? N + 2 : fim;
+  double global_delta = INFINITY;
+  double rho = cos(M_PI / (N + 1)), omega = 1;
+  int iter = 0;
+  PedidoMP env[2] = { NULL, NULL };
+  Medida *med = s->medidas != NULL ? &s->medidas[tinfo->id] : NULL;
+  double t0 = 0, t1 = 0;
+
+  if (med != NULL) {
+    ini = s->limites[tinfo->id];
+    fim = s->limites[tinfo->id + 1];
+    lo  = tinfo->id == 0 ? 0 : ini;
+    hi  = tinfo->id == tinfo->trab - 1 ? N + 2 : fim;
+  }
+
+  if (s->op.afinidade) {
+    // fixar a trabalhadora num CPU, repartindo-as de forma circular
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(tinfo->id % sysconf(_SC_NPROCESSORS_ONLN), &cpus);
+    pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpus);
+  }
+  // sem todas as trabalhadoras a barreira nunca abriria
+  pthread_mutex_lock(&s->partida);
+  pthread_mutex_unlock(&s->partida);
+  if (s->cancelada)
+    return NULL;
+  if (tinfo->vizinhas != NULL)
+    enviar_pontas(tinfo, m[s->base % 2], ini, fim, 0, env);
+
+  do {
+    int atual = (s->base + iter) % 2;
+    int prox = 1 - atual;
+
+    // Calcular Pontos Internos
+    double max_delta;
+    if (med != NULL)
+      t0 = tempoAgora();
+    if (s->op.acel == ACEL_CHEBYSHEV) {
+      omega = chebyshevOmega(iter, omega, rho);
+      max_delta = kernelChebyshev(m[atual], m[prox], ini, fim, N, omega);
+    } else if (tinfo->adi != NULL) {
+      max_delta = passo_adi(tinfo, m[atual], m[prox], ini, fim);
+    } else if (s->op.acel == ACEL_ANDERSON) {
+      max_delta = passo_anderson(tinfo, iter, m[atual], m[prox], ini, fim);
+    } else if (tinfo->vizinhas != NULL) {
+      max_delta = passo_mensagens(tinfo, iter, m[atual], m[prox], ini, fim, env);
+    } else if (tinfo->halos != NULL) {
+      max_delta = passo_no_lugar(tinfo, atual, ini, fim);
+    } else {
+      max_delta = tinfo->kernel(m[atual], m[prox], ini, fim, N, s->op.bloco);
+    }
+    if (med != NULL) {
+      t1 = tempoAgora();
+      med->calculo += t1 - t0;
+    }
+    // barreira de sincronizacao; calcular delta global
+    global_delta = dualBarrierWait(s->barreira, atual, max_delta);
+    if (med != NULL) {
+      // as fronteiras so' mudam na barreira, antes de ela abrir
+      med->f.espera += tempoAgora() - t1;
+      ini = s->limites[tinfo->id];
+      fim = s->limites[tinfo->id + 1];
+      lo  = tinfo->id == 0 ? 0 : ini;
+      hi  = tinfo->id == tinfo->trab - 1 ? N + 2 : fim;
+    }
+    // a matriz acabada de calcular so' volta a ser escrita na iteracao
+    // seguinte, pelo que pode ser copiada sem mais sincronizacao
+    if (s->copiar != NULL)
+      s->copiar(s->arg, s->base + iter + 1, m[prox], lo, hi);
+  } while (++iter < tinfo->iter && global_delta >= tinfo->maxD &&
+           !__atomic_load_n(&s->parar, __ATOMIC_RELAXED));
+
+  if (tinfo->vizinhas != NULL) {
+    // as ultimas pontas enviadas nunca sao recebidas: recebe-las aqui
+    // para os envios sem buffer concluirem
+    double  *viz[2] = { tinfo->vizinhas, tinfo->vizinhas + N + 2 };
+    PedidoMP rec[2];
+    receber_vizinhas(tinfo, iter, viz, rec);
+    esperarTodos(rec, 2, NULL);
+    esperarTodos(env, 2, NULL);
+  }
+
+  if (tinfo->estat != NULL)
+    estatisticas_fatia(tinfo, m[(s->base + iter) % 2], ini, fim);
+
+  return 0;
+}
+
+/*--------------------------------------------------------------------
+| Function: repartir
+| Description: Chamada na barreira a cada op.reparticao iteracoes.
+|              Estima a velocidade de cada trabalhadora (linhas por
+|              segundo de calculo, em media com as anteriores) e, se a
+|              mais lenta demorou mais do que a media em mais de
+|              REPARTIR_LIMIAR, move as fronteiras para que as linhas
+|              de cada uma sejam proporcionais 'a sua velocidade.
+---------------------------------------------------------------------*/
+
+static void repartir(HeatSim *s) {
+  int     trab = s->op.trab, N = s->op.N;
+  int    *lim  = s->limites;
+  double  soma_t = 0, max_t = 0, soma_v = 0, acum = 0;
+
+  for (int t = 0; t < trab; t++)
+    soma_t += s->medidas[t].calculo;
+  if (soma_t <= 0)
+    return;
+  for (int t = 0; t < trab; t++) {
+    double c = s->medidas[t].calculo;
+    double v = (lim[t+1] - lim[t]) / (c > 0 ? c : soma_t / trab);
+    s->velocidades[t] = s->velocidades[t] > 0 ? 0.5 * (s->velocidades[t] + v) : v;
+    s->medidas[t].calculo = 0;
+    soma_v += s->velocidades[t];
+  }
+  // histerese: o desequilibrio e' o das velocidades medias, para que o
+  // ruido de uma medicao nao chegue para mexer nas fatias
+  soma_t = 0;
+  for (int t = 0; t < trab; t++) {
+    double c = (lim[t+1] - lim[t]) / s->velocidades[t];
+    soma_t += c;
+    max_t   = c > max_t ? c : max_t;
+  }
+  if (max_t * trab <= soma_t * (1 + REPARTIR_LIMIAR))
+    return;
+
+  int mudou = 0;
+  for (int t = 0; t < trab - 1; t++) {
+    acum += s->velocidades[t];
+    int f = 1 + (int) lround(N * acum / soma_v);
+    // pelo menos uma linha para cada trabalhadora
+    if (f < lim[t] + 1)
+      f = lim[t] + 1;
+    if (f > N + 1 - (trab - 1 - t))
+      f = N + 1 - (trab - 1 - t);
+    mudou |= f != lim[t+1];
+    lim[t+1] = f;
+  }
+  if (!mudou)
+    return;
+  s->mudancas++;
+  for (int t = 0; t < trab; t++) {
+    HeatSimFatia *f = &s->medidas[t].f;
+    f->linhas = lim[t+1] - lim[t];
+    f->min    = f->linhas < f->min ? f->linhas : f->min;
+    f->max    = f->linhas > f->max ? f->linhas : f->max;
+  }
+}
+
+/*--------------------------------------------------------------------
+| Function: fim_de_iteracao
+| Description: Gancho da barreira: conta a iteracao e passa-a ao
+|              gancho do chamador
+---------------------------------------------------------------------*/
+
+static void fim_de_iteracao(void *arg, int iteracoes, double delta) {
+  HeatSim *s = (HeatSim*) arg;
+  int motivo = 0;
+
+  if (__atomic_load_n(&s->pedido, __ATOMIC_RELAXED)) {
+    motivo = HEATSIM_PARADA;
+  } else if (s->prazo > 0) {
+    // a estimativa segue de imediato uma iteracao mais lenta e esquece-a
+    // devagar
+    double agora = tempoAgora();
+    double dt    = agora - s->t_ultima;
+    s->t_iter   = dt > 0.9 * s->t_iter ? dt : 0.9 * s->t_iter;
+    s->t_ultima = agora;
+    if (agora + s->t_iter > s->prazo)
+      motivo = HEATSIM_PRAZO;
+  }
+  // as trabalhadoras so' leem 'parar' depois de a barreira abrir, pelo
+  // que todas param na mesma iteracao
+  if (motivo != 0 && s->base + iteracoes < s->iter_max && delta >= s->maxD) {
+    s->motivo = motivo;
+    __atomic_store_n(&s->parar, 1, __ATOMIC_RELAXED);
+  }
+
+  if (s->medidas != NULL && iteracoes % s->op.reparticao == 0)
+    repartir(s);
+
+  __atomic_store(&s->delta, &delta, __ATOMIC_RELAXED);
+  __atomic_store_n(&s->iteracoes, s->base + iteracoes, __ATOMIC_RELEASE);
+  if (s->fim != NULL)
+    s->fim(s->arg, s->base + iteracoes, delta);
+}
+
+/*--------------------------------------------------------------------
+| Function: heatsimCriar
+---------------------------------------------------------------------*/
+
+HeatSim *heatsimCriar(HeatSimOpcoes const *op, double *campos[2]) {
+  HeatSim *s;
+  size_t   bytes;
+
+  if (op->N < 1 || op->trab < 1 || op->N % op->trab != 0 ||
+      kernelPorNome(op->kernel) == NULL)
+    return NULL;
+  if ((campos[0] == campos[1] && campos[0] != NULL) &&
+      (op->acel != ACEL_NENHUMA || op->adi_dt > 0 || op->mensagens_cap >= 0 ||
+       op->reparticao > 0))
+    return NULL;
+  if (op->mensagens_cap >= 0 && op->reparticao > 0)
+    return NULL;
+
+  s = (HeatSim*) calloc(1, sizeof(HeatSim));
+  if (s == NULL)
+    return NULL;
+  s->op = *op;
+  bytes = sizeof(double) * (size_t) (op->N + 2) * (op->N + 2);
+
+  for (int i = 0; i < 2; i++) {
+    double *dados = campos[i];
+    if (dados == NULL) {
+      if (posix_memalign((void**) &s->proprios[i], 64, bytes) != 0) {
+        heatsimLibertar(s);
+        return NULL;
+      }
+      memset(s->proprios[i], 0, bytes);
+      dados = s->proprios[i];
+    }
+    s->vistas[i].n_l  = op->N + 2;
+    s->vistas[i].n_c  = op->N + 2;
+    s->vistas[i].data = dados;
+    s->m[i] = &s->vistas[i];
+  }
+  if (campos[0] == campos[1] && campos[0] != NULL)
+    s->m[1] = s->m[0];
+  else if (campos[0] != NULL && campos[1] == NULL)
+    dm2dCopy(s->m[1], s->m[0]);
+  s->delta = INFINITY;
+  return s;
+}
+
+/*--------------------------------------------------------------------
+| Function: heatsimIniciar
+---------------------------------------------------------------------*/
+
+void heatsimIniciar(HeatSim *s, double tEsq, double tSup, double tDir, double tInf) {
+  int N = s->op.N;
+
+  for (int i = 1; i <= N; i++)
+    dm2dSetLineTo (s->m[0], i, 0);
+  dm2dSetLineTo (s->m[0], 0, tSup);
+  dm2dSetLineTo (s->m[0], N+1, tInf);
+  dm2dSetColumnTo (s->m[0], 0, tEsq);
+  dm2dSetColumnTo (s->m[0], N+1, tDir);
+  dm2dCopy (s->m[1], s->m[0]);
+  s->iteracoes = 0;
+  s->delta     = INFINITY;
+}
+
+/*--------------------------------------------------------------------
+| Function: heatsimRetomar
+---------------------------------------------------------------------*/
+
+void heatsimRetomar(HeatSim *s, int iteracoes, double delta) {
+  s->iteracoes = iteracoes;
+  s->delta     = delta;
+}
+
+/*--------------------------------------------------------------------
+| Function: heatsimDefinirPrazo / heatsimParar
+---------------------------------------------------------------------*/
+
+void heatsimDefinirPrazo(HeatSim *s, double instante) {
+  s->prazo = instante;
+}
+
+void heatsimParar(HeatSim *s) {
+  __atomic_store_n(&s->pedido, 1, __ATOMIC_RELAXED);
+}
+
+/*--------------------------------------------------------------------
+| Function: heatsimDefinirGanchos
+---------------------------------------------------------------------*/
+
+void heatsimDefinirGanchos(HeatSim *s, HeatSimFim fim, HeatSimCopiar copiar, void *arg) {
+  s->fim    = fim;
+  s->copiar = copiar;
+  s->arg    = arg;
+}
+
+/*--------------------------------------------------------------------
+| Function: heatsimCorrerAte
+| Description: Cria as trabalhadoras e o que o modo escolhido precisa
+|              para esta corrida, espera que terminem e liberta-o. Se
+|              algo falhar, liberta so' o que chegou a ser criado.
+---------------------------------------------------------------------*/
+
+int heatsimCorrerAte(HeatSim *s, int iter_max, double maxD) {
+  HeatSimOpcoes const *op = &s->op;
+  int trab = op->trab, N = op->N;
+  int ok = 1;
+  // o que chegou a ser iniciado, para libertar so' isso
+  int b_produtos = 0, b_adi = 0, b_estat = 0, mplib = 0, partida = 0;
+
+  s->motivo = 0;
+  if (s->iteracoes >= iter_max)
+    return 0;
+  s->base     = s->iteracoes;
+  s->parar    = 0;
+  s->iter_max = iter_max;
+  s->maxD     = maxD;
+  s->t_ultima = tempoAgora();
+  s->t_iter   = 0;
+
+  s->barreira = dualBarrierInit(trab, op->barreira);
+  if (s->barreira == NULL)
+    return -1;
+  dualBarrierSetHook(s->barreira, fim_de_iteracao, s);
+
+  // Reservar memoria para trabalhadoras e para o modo escolhido
+  thread_info *tinfo = (thread_info*) calloc(trab, sizeof(thread_info));
+  pthread_t *trabalhadoras = (pthread_t*) malloc(trab * sizeof(pthread_t));
+  double *produtos = NULL, *halos = NULL, *linhas = NULL, *vizinhas = NULL;
+  PlanoADI *adi = NULL;
+
+  if (op->acel == ACEL_ANDERSON) {
+    // g(k-1) e produtos internos parciais de cada trabalhadora
+    s->anderson = dm2dNew(N+2, N+2);
+    produtos = (double*) malloc(2 * trab * sizeof(double));
+    ok = s->anderson != NULL && produtos != NULL;
+    if (ok)
+      ok = b_produtos = pthread_barrier_init(&s->barreira_produtos, NULL, trab) == 0;
+  }
+  if (ok && op->adi_dt > 0) {
+    adi = adiPlano(N, op->adi_dt);
+    ok = adi != NULL;
+    if (ok)
+      ok = b_adi = pthread_barrier_init(&s->barreira_adi, NULL, trab) == 0;
+  }
+  if (ok && s->m[0] == s->m[1]) {
+    // copias das linhas das pontas de cada fatia, em duas paridades, e
+    // dois buffers de linha por trabalhadora
+    halos  = (double*) malloc(sizeof(double) * 4 * trab * (N+2));
+    linhas = (double*) malloc(sizeof(double) * 2 * trab * (N+2));
+    ok = halos != NULL && linhas != NULL;
+  }
+  if (ok && op->mensagens_cap >= 0) {
+    vizinhas = (double*) malloc(sizeof(double) * 2 * trab * (N+2));
+    ok = vizinhas != NULL;
+    if (ok)
+      ok = mplib = inicializarMPlib(op->mensagens_cap, trab) == 0;
+  }
+  if (ok && op->estat != NULL)
+    ok = b_estat = pthread_barrier_init(&s->barreira_estat, NULL, trab) == 0;
+  if (ok && op->reparticao > 0 && s->limites == NULL) {
+    // fatias iguais ate' 'a primeira medicao
+    s->limites     = (int*) malloc((trab + 1) * sizeof(int));
+    s->velocidades = (double*) calloc(trab, sizeof(double));
+    ok = s->limites != NULL && s->velocidades != NULL &&
+         posix_memalign((void**) &s->medidas, 64, trab * sizeof(Medida)) == 0;
+    for (int t = 0; ok && t <= trab; t++)
+      s->limites[t] = 1 + t * (N / trab);
+  }
+  if (ok && s->medidas != NULL) {
+    s->mudancas = 0;
+    for (int t = 0; t < trab; t++) {
+      Medida *med = &s->medidas[t];
+      med->f.linhas = med->f.min = med->f.max = s->limites[t+1] - s->limites[t];
+      med->f.espera = 0;
+      med->calculo  = 0;
+    }
+  }
+  ok = ok && tinfo != NULL && trabalhadoras != NULL;
+
+  // Preencher tinfo; as copias das pontas ficam todas feitas antes de
+  // qualquer trabalhadora as ler
+  for (int i = 0; ok && i < trab; i++) {
+    tinfo[i].sim = s;
+    tinfo[i].id = i;
+    tinfo[i].iter = iter_max - s->base;
+    tinfo[i].trab = trab;
+    tinfo[i].tam_fatia = N / trab;
+    tinfo[i].maxD = maxD;
+    tinfo[i].kernel = kernelPorNome(op->kernel);
+    tinfo[i].estat = op->estat != NULL ? &op->estat[i] : NULL;
+    tinfo[i].produtos = produtos;
+    tinfo[i].adi = adi;
+    tinfo[i].halos = halos;
+    tinfo[i].vizinhas = vizinhas != NULL ? vizinhas + (long) 2 * i * (N+2) : NULL;
+    if (halos != NULL) {
+      int ini = i * tinfo[i].tam_fatia + 1;
+      int p   = s->base % 2;
+      memcpy(linha_halo(&tinfo[i], p, i, 0), dm2dGetLine(s->m[0], ini),
+             (N+2) * sizeof(double));
+      memcpy(linha_halo(&tinfo[i], p, i, 1),
+             dm2dGetLine(s->m[0], ini + tinfo[i].tam_fatia - 1), (N+2) * sizeof(double));
+      tinfo[i].linhas[0] = linhas + (long) 2 * i * (N+2);
+      tinfo[i].linhas[1] = tinfo[i].linhas[0] + N + 2;
+    }
+  }
+
+  // Criar trabalhadoras; so' arrancam quando 'partida' abrir e, se
+  // faltar alguma, saem logo
+  int criadas = 0;
+  s->cancelada = 0;
+  if (ok)
+    ok = partida = pthread_mutex_init(&s->partida, NULL) == 0;
+  if (ok) {
+    pthread_mutex_lock(&s->partida);
+    for (int i = 0; i < trab; i++) {
+      if (pthread_create(&trabalhadoras[i], NULL, tarefa_trabalhadora, &tinfo[i]) != 0)
+        break;
+      criadas++;
+    }
+    s->cancelada = criadas < trab;
+    ok = !s->cancelada;
+    pthread_mutex_unlock(&s->partida);
+  }
+
+  // Esperar que as trabalhadoras terminem
+  for (int i = 0; i < criadas; i++)
+    pthread_join(trabalhadoras[i], NULL);
+  if (partida)
+    pthread_mutex_destroy(&s->partida);
+
+  if (b_estat)
+    pthread_barrier_destroy(&s->barreira_estat);
+  if (b_adi)
+    pthread_barrier_destroy(&s->barreira_adi);
+  if (adi != NULL)
+    adiLibertar(adi);
+  if (b_produtos)
+    pthread_barrier_destroy(&s->barreira_produtos);
+  if (s->anderson != NULL) {
+    dm2dFree(s->anderson);
+    s->anderson = NULL;
+  }
+  if (mplib)
+    libertarMPlib();
+  free(produtos);
+  free(vizinhas);
+  free(halos);
+  free(linhas);
+  free(tinfo);
+  free(trabalhadoras);
+  dualBarrierFree(s->barreira);
+  s->barreira = NULL;
+  return ok ? s->iteracoes - s->base : -1;
+}
+
+/*--------------------------------------------------------------------
+| Function: heatsimPasso
+---------------------------------------------------------------------*/
+
+int heatsimPasso(HeatSim *s, int n) {
+  return heatsimCorrerAte(s, s->iteracoes + n, 0);
+}
+
+/*--------------------------------------------------------------------
+| Function: heatsimCampo / heatsimIteracoes / heatsimDelta
+---------------------------------------------------------------------*/
+
+double const *heatsimCampo(HeatSim const *s) {
+  return s->m[s->iteracoes % 2]->data;
+}
+
+int heatsimIteracoes(HeatSim const *s) {
+  return __atomic_load_n(&s->iteracoes, __ATOMIC_ACQUIRE);
+}
+
+double heatsimDelta(HeatSim const *s) {
+  double d;
+  __atomic_load(&s->delta, &d, __ATOMIC_RELAXED);
+  return d;
+}
+
+/*--------------------------------------------------------------------
+| Function: heatsimInterrompida
+---------------------------------------------------------------------*/
+
+int heatsimInterrompida(HeatSim const *s) {
+  return s->motivo;
+}
+
+/*--------------------------------------------------------------------
+| Function: heatsimFatias
+---------------------------------------------------------------------*/
+
+int heatsimFatias(HeatSim const *s, HeatSimFatia *f) {
+  if (s->medidas == NULL)
+    return -1;
+  for (int t = 0; t < s->op.trab; t++)
+    f[t] = s->medidas[t].f;
+  return s->mudancas;
+}
+
+/*--------------------------------------------------------------------
+| Function: heatsimLibertar
+---------------------------------------------------------------------*/
+
+void heatsimLibertar(HeatSim *s) {
+  if (s == NULL)
+    return;
+  free(s->limites);
+  free(s->velocidades);
+  free(s->medidas);
+  free(s->proprios[0]);
+  free(s->proprios[1]);
+  free(s);
+}
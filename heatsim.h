@@ -0,0 +1,182 @@
+/*
+// libheatsim: o resolvedor de Jacobi paralelo, sem estado global
+// Sistemas Operativos, DEI/IST/ULisboa 2017-18
+//
+// Todo o estado de uma simulacao esta' num contexto HeatSim, pelo que
+// um processo pode ter varias ao mesmo tempo, em tarefas diferentes.
+// As matrizes sao do chamador (ou reservadas pela biblioteca, se nao
+// as der) e nunca sao copiadas: cada iteracao le uma e escreve a
+// outra, e heatsimCampo devolve a que tem a iteracao mais recente.
+//
+// Uma simulacao com mensagens (mensagens_cap >= 0) usa a mplib3, que
+// e' unica no processo: so' uma dessas pode correr de cada vez.
+*/
+
+#ifndef HEATSIM_H
+#define HEATSIM_H
+
+#include "matrix2d.h"
+#include "barreira.h"
+#include "acelerar.h"
+#include "saida.h"
+
+typedef struct heatsim_t HeatSim;
+
+// porque parou uma corrida antes do fim (heatsimInterrompida)
+#define HEATSIM_PARADA  1    // heatsimParar
+#define HEATSIM_PRAZO   2    // a iteracao seguinte passaria o prazo
+
+/*--------------------------------------------------------------------
+| Type: HeatSimOpcoes
+---------------------------------------------------------------------*/
+
+typedef struct {
+  int             N;             // pontos interiores por lado
+  int             trab;          // trabalhadoras; divisor de N
+  char const     *kernel;        // simples, linhas, blocos
+  int             bloco;
+  TipoBarreira    barreira;
+  int             afinidade;
+  TipoAceleracao  acel;
+  double          adi_dt;        // > 0: passos ADI em vez de Jacobi
+  int             mensagens_cap; // >= 0: vizinhas trocadas pela mplib3
+  Estatisticas   *estat;         // se nao for NULL, estatisticas no fim
+                                 // de cada corrida, uma por trabalhadora
+  int             reparticao;    // > 0: fatias ajustadas 'a velocidade de
+                                 // cada trabalhadora, de tantas em tantas
+                                 // iteracoes; so' com duas matrizes e
+                                 // sem mensagens
+} HeatSimOpcoes;
+
+/*--------------------------------------------------------------------
+| Type: HeatSimFatia
+| Description: Fatia de uma trabalhadora na reparticao adaptativa
+---------------------------------------------------------------------*/
+
+typedef struct {
+  int    linhas;                 // no fim da corrida
+  int    min, max;               // ao longo da corrida
+  double espera;                 // segundos parada na barreira
+} HeatSimFatia;
+
+/*--------------------------------------------------------------------
+| Type: HeatSimFim / HeatSimCopiar
+| Description: Ganchos de cada iteracao. HeatSimFim e' chamado na
+|              barreira pela ultima trabalhadora, com as iteracoes
+|              concluidas e o delta global, e deve ser curto. Se a
+|              corrida para nessa iteracao (heatsimParar ou prazo),
+|              heatsimInterrompida ja' o indica dentro dele.
+|              HeatSimCopiar e' chamado por cada trabalhadora logo a
+|              seguir, com a matriz acabada de calcular e as suas
+|              linhas [lo, hi[, fronteiras incluidas; a matriz nao
+|              muda ate' a trabalhadora voltar.
+---------------------------------------------------------------------*/
+
+typedef void (*HeatSimFim)(void *arg, int iteracoes, double delta);
+typedef void (*HeatSimCopiar)(void *arg, int iteracoes, DoubleMatrix2D *m, int lo, int hi);
+
+/*--------------------------------------------------------------------
+| Function: heatsimCriar
+| Description: Cria uma simulacao sobre campos[0] e campos[1], de
+|              (N+2) x (N+2) doubles por linhas (de preferencia
+|              alinhados a 64 bytes), que sao do chamador e tem de
+|              viver tanto como ela. Os dois iguais calculam no
+|              proprio sitio; NULL pede a biblioteca que os reserve.
+|              O estado inicial e' o que estiver em campos[0]; se
+|              der os dois, campos[1] tem de ter as mesmas fronteiras.
+|              Devolve NULL se as opcoes forem invalidas ou faltar
+|              memoria.
+---------------------------------------------------------------------*/
+HeatSim *heatsimCriar(HeatSimOpcoes const *op, double *campos[2]);
+
+/*--------------------------------------------------------------------
+| Function: heatsimIniciar
+| Description: Poe o estado inicial: interior a zero e as fronteiras
+|              com estas temperaturas. Repoe as iteracoes a zero.
+---------------------------------------------------------------------*/
+void     heatsimIniciar(HeatSim *s, double tEsq, double tSup, double tDir, double tInf);
+
+/*--------------------------------------------------------------------
+| Function: heatsimRetomar
+| Description: Continua uma simulacao guardada com 'iteracoes'
+|              concluidas, cuja matriz esta' em campos[iteracoes%2]
+|              (ou nos dois)
+---------------------------------------------------------------------*/
+void     heatsimRetomar(HeatSim *s, int iteracoes, double delta);
+
+/*--------------------------------------------------------------------
+| Function: heatsimDefinirGanchos
+---------------------------------------------------------------------*/
+void     heatsimDefinirGanchos(HeatSim *s, HeatSimFim fim, HeatSimCopiar copiar, void *arg);
+
+/*--------------------------------------------------------------------
+| Function: heatsimDefinirPrazo
+| Description: Instante (de tempoAgora) ate' ao qual as corridas podem
+|              ir. Na barreira, a ultima trabalhadora estima a duracao
+|              da iteracao seguinte e, se esta passar o prazo, todas
+|              param ali. 0 tira o prazo.
+---------------------------------------------------------------------*/
+void     heatsimDefinirPrazo(HeatSim *s, double instante);
+
+/*--------------------------------------------------------------------
+| Function: heatsimParar
+| Description: Pede que a corrida pare no fim da iteracao em curso, ou
+|              da primeira da proxima corrida. Pode ser chamada de um
+|              handler de sinais.
+---------------------------------------------------------------------*/
+void     heatsimParar(HeatSim *s);
+
+/*--------------------------------------------------------------------
+| Function: heatsimCorrerAte
+| Description: Itera ate' haver 'iter_max' iteracoes concluidas desde
+|              o inicio ou o delta de uma iteracao ser menor do que
+|              maxD. Devolve as iteracoes feitas nesta chamada, ou -1
+|              se nao conseguir criar as trabalhadoras. A historia das
+|              aceleracoes recomeca em cada chamada.
+---------------------------------------------------------------------*/
+int      heatsimCorrerAte(HeatSim *s, int iter_max, double maxD);
+
+/*--------------------------------------------------------------------
+| Function: heatsimPasso
+| Description: Faz mais 'n' iteracoes, qualquer que seja o delta
+---------------------------------------------------------------------*/
+int      heatsimPasso(HeatSim *s, int n);
+
+/*--------------------------------------------------------------------
+| Function: heatsimCampo
+| Description: Matriz com a iteracao mais recente: um dos buffers de
+|              heatsimCriar, sem copia. So' pode ser lida enquanto a
+|              simulacao nao estiver a correr.
+---------------------------------------------------------------------*/
+double const *heatsimCampo(HeatSim const *s);
+
+/*--------------------------------------------------------------------
+| Function: heatsimIteracoes / heatsimDelta
+| Description: Iteracoes concluidas e delta da ultima; actualizados na
+|              barreira, pelo que podem ser lidos durante a corrida
+---------------------------------------------------------------------*/
+int      heatsimIteracoes(HeatSim const *s);
+double   heatsimDelta(HeatSim const *s);
+
+/*--------------------------------------------------------------------
+| Function: heatsimInterrompida
+| Description: HEATSIM_PARADA ou HEATSIM_PRAZO se a ultima corrida parou
+|              antes de chegar a iter_max ou a maxD, senao 0
+---------------------------------------------------------------------*/
+int      heatsimInterrompida(HeatSim const *s);
+
+/*--------------------------------------------------------------------
+| Function: heatsimFatias
+| Description: Copia para f[0..trab-1] as fatias da ultima corrida e
+|              devolve quantas vezes foram repartidas, ou -1 sem
+|              reparticao adaptativa
+---------------------------------------------------------------------*/
+int      heatsimFatias(HeatSim const *s, HeatSimFatia *f);
+
+/*--------------------------------------------------------------------
+| Function: heatsimLibertar
+| Description: Liberta a simulacao e os buffers que ela reservou
+---------------------------------------------------------------------*/
+void     heatsimLibertar(HeatSim *s);
+
+#endif
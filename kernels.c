@@ -0,0 +1,157 @@
+/*
+// Kernels do estencil de 5 pontos
+// Sistemas Operativos, DEI/IST/ULisboa 2017-18
+*/
+
+#include "kernels.h"
+
+#include <math.h>
+#include <string.h>
+
+/*--------------------------------------------------------------------
+| Function: kernelSimples
+| Description: Versao original, com acesso por dm2dGetEntry
+---------------------------------------------------------------------*/
+
+double kernelSimples (DoubleMatrix2D *de, DoubleMatrix2D *para,
+                      int ini, int fim, int N, int bloco) {
+  double max_delta = 0;
+
+  for (int i = ini; i < fim; i++) {
+    for (int j = 1; j <= N; j++) {
+      double val = (dm2dGetEntry(de, i-1, j) +
+                    dm2dGetEntry(de, i+1, j) +
+                    dm2dGetEntry(de, i,   j-1) +
+                    dm2dGetEntry(de, i,   j+1))/4;
+      // calcular delta
+      double delta = fabs(val - dm2dGetEntry(de, i, j));
+      if (delta > max_delta) {
+        max_delta = delta;
+      }
+      dm2dSetEntry(para, i, j, val);
+    }
+  }
+  return max_delta;
+}
+
+/*--------------------------------------------------------------------
+| Function: kernelLinhas
+| Description: Calcula os ponteiros das linhas uma vez por linha, para
+|              que o ciclo interior seja apenas aritmetica sobre
+|              vectores contiguos
+---------------------------------------------------------------------*/
+
+double kernelLinhas (DoubleMatrix2D *de, DoubleMatrix2D *para,
+                     int ini, int fim, int N, int bloco) {
+  double max_delta = 0;
+
+  for (int i = ini; i < fim; i++) {
+    double const *restrict cima  = dm2dGetLine(de, i-1);
+    double const *restrict meio  = dm2dGetLine(de, i);
+    double const *restrict baixo = dm2dGetLine(de, i+1);
+    double       *restrict saida = dm2dGetLine(para, i);
+
+    for (int j = 1; j <= N; j++) {
+      double val   = (cima[j] + baixo[j] + meio[j-1] + meio[j+1])/4;
+      double delta = fabs(val - meio[j]);
+      max_delta = delta > max_delta ? delta : max_delta;
+      saida[j] = val;
+    }
+  }
+  return max_delta;
+}
+
+/*--------------------------------------------------------------------
+| Function: kernelBlocos
+| Description: Percorre a fatia em blocos de 'bloco' colunas, para que
+|              as tres linhas de entrada de cada bloco fiquem em cache
+|              quando N e' demasiado grande para isso
+---------------------------------------------------------------------*/
+
+double kernelBlocos (DoubleMatrix2D *de, DoubleMatrix2D *para,
+                     int ini, int fim, int N, int bloco) {
+  double max_delta = 0;
+
+  if (bloco < 1 || bloco > N)
+    bloco = N;
+
+  for (int jb = 1; jb <= N; jb += bloco) {
+    int jf = jb + bloco <= N + 1 ? jb + bloco : N + 1;
+
+    for (int i = ini; i < fim; i++) {
+      double const *restrict cima  = dm2dGetLine(de, i-1);
+      double const *restrict meio  = dm2dGetLine(de, i);
+      double const *restrict baixo = dm2dGetLine(de, i+1);
+      double       *restrict saida = dm2dGetLine(para, i);
+
+      for (int j = jb; j < jf; j++) {
+        double val   = (cima[j] + baixo[j] + meio[j-1] + meio[j+1])/4;
+        double delta = fabs(val - meio[j]);
+        max_delta = delta > max_delta ? delta : max_delta;
+        saida[j] = val;
+      }
+    }
+  }
+  return max_delta;
+}
+
+/*--------------------------------------------------------------------
+| Function: kernelPorNome
+| Description: Devolve o kernel com o nome dado, ou NULL
+---------------------------------------------------------------------*/
+
+KernelFn kernelPorNome (char const *nome) {
+  if (strcmp(nome, "simples") == 0)
+    return kernelSimples;
+  if (strcmp(nome, "linhas") == 0)
+    return kernelLinhas;
+  if (strcmp(nome, "blocos") == 0)
+    return kernelBlocos;
+  return NULL;
+}
+
+/*--------------------------------------------------------------------
+| Function: kernelLinha
+---------------------------------------------------------------------*/
+
+double kernelLinha (double const *restrict cima, double const *restrict meio,
+                    double const *restrict baixo, double *restrict saida, int N) {
+  double max_delta = 0;
+
+  for (int j = 1; j <= N; j++) {
+    double val   = (cima[j] + baixo[j] + meio[j-1] + meio[j+1])/4;
+    double delta = fabs(val - meio[j]);
+    max_delta = delta > max_delta ? delta : max_delta;
+    saida[j] = val;
+  }
+  return max_delta;
+}
+
+/*--------------------------------------------------------------------
+| Function: kernelNoLugar
+---------------------------------------------------------------------*/
+
+double kernelNoLugar (DoubleMatrix2D *m, int ini, int fim, int N,
+                      double const *cima_ant, double const *baixo_ant, double *linhas[2]) {
+  double max_delta = 0;
+
+  for (int i = ini; i < fim; i++) {
+    double const *restrict cima  = i == ini     ? cima_ant  : dm2dGetLine(m, i-1);
+    double const *restrict meio  = dm2dGetLine(m, i);
+    double const *restrict baixo = i == fim - 1 ? baixo_ant : dm2dGetLine(m, i+1);
+    double       *restrict saida = linhas[i % 2];
+
+    for (int j = 1; j <= N; j++) {
+      double val   = (cima[j] + baixo[j] + meio[j-1] + meio[j+1])/4;
+      double delta = fabs(val - meio[j]);
+      max_delta = delta > max_delta ? delta : max_delta;
+      saida[j] = val;
+    }
+    // a linha i-1 antiga ja' nao e' precisa
+    if (i > ini)
+      memcpy(dm2dGetLine(m, i-1) + 1, linhas[(i-1) % 2] + 1, N * sizeof(double));
+  }
+  if (fim > ini)
+    memcpy(dm2dGetLine(m, fim-1) + 1, linhas[(fim-1) % 2] + 1, N * sizeof(double));
+  return max_delta;
+}
@@ -0,0 +1,51 @@
+/*
+// Kernels do estencil de 5 pontos
+// Sistemas Operativos, DEI/IST/ULisboa 2017-18
+*/
+
+#ifndef KERNELS_H
+#define KERNELS_H
+
+#include "matrix2d.h"
+
+/*--------------------------------------------------------------------
+| Type: KernelFn
+| Description: Calcula uma iteracao de Jacobi sobre as linhas
+|              [ini, fim[ da matriz 'de', escrevendo em 'para', com
+|              N colunas interiores. 'bloco' e' a largura dos blocos
+|              de colunas (ignorada por kernels sem blocos).
+|              Devolve o delta maximo das linhas calculadas.
+---------------------------------------------------------------------*/
+
+typedef double (*KernelFn)(DoubleMatrix2D *de, DoubleMatrix2D *para,
+                           int ini, int fim, int N, int bloco);
+
+double   kernelSimples (DoubleMatrix2D *de, DoubleMatrix2D *para, int ini, int fim, int N, int bloco);
+double   kernelLinhas  (DoubleMatrix2D *de, DoubleMatrix2D *para, int ini, int fim, int N, int bloco);
+double   kernelBlocos  (DoubleMatrix2D *de, DoubleMatrix2D *para, int ini, int fim, int N, int bloco);
+
+KernelFn kernelPorNome (char const *nome);
+
+/*--------------------------------------------------------------------
+| Function: kernelLinha
+| Description: Calcula uma linha a partir das tres linhas de entrada,
+|              que podem nao estar na matriz (p.ex. linhas recebidas
+|              por mensagem). Devolve o delta maximo da linha.
+---------------------------------------------------------------------*/
+double   kernelLinha   (double const *cima, double const *meio, double const *baixo,
+                        double *saida, int N);
+
+/*--------------------------------------------------------------------
+| Function: kernelNoLugar
+| Description: Iteracao de Jacobi sobre as linhas [ini, fim[ de 'm',
+|              escrita na propria matriz. 'cima' e 'baixo' sao os
+|              valores antigos das linhas ini-1 e fim; 'linhas' sao
+|              dois buffers de N+2 posicoes. Cada linha nova fica num
+|              buffer ate' a seguinte ser calculada, pelo que a
+|              linha de cima lida da matriz e' sempre a antiga. O
+|              resultado e' igual, bit a bit, ao dos outros kernels.
+---------------------------------------------------------------------*/
+double   kernelNoLugar (DoubleMatrix2D *m, int ini, int fim, int N,
+                        double const *cima, double const *baixo, double *linhas[2]);
+
+#endif
@@ -0,0 +1,90 @@
+/*
+// Kernels do estencil de 7 pontos
+// Sistemas Operativos, DEI/IST/ULisboa 2017-18
+*/
+
+#include "kernels3d.h"
+
+#include <math.h>
+#include <string.h>
+
+/*--------------------------------------------------------------------
+| Function: linha3d
+| Description: Calcula os pontos [jb, jf[ da linha (z, i)
+---------------------------------------------------------------------*/
+
+static inline double linha3d(DoubleMatrix3D *de, DoubleMatrix3D *para,
+                             int z, int i, int jb, int jf, double max_delta) {
+  double const *restrict frente = dm3dGetLine(de, z-1, i);
+  double const *restrict tras   = dm3dGetLine(de, z+1, i);
+  double const *restrict cima   = dm3dGetLine(de, z, i-1);
+  double const *restrict meio   = dm3dGetLine(de, z, i);
+  double const *restrict baixo  = dm3dGetLine(de, z, i+1);
+  double       *restrict saida  = dm3dGetLine(para, z, i);
+
+  for (int j = jb; j < jf; j++) {
+    double val   = (frente[j] + tras[j] + cima[j] + baixo[j] + meio[j-1] + meio[j+1])/6;
+    double delta = fabs(val - meio[j]);
+    max_delta = delta > max_delta ? delta : max_delta;
+    saida[j] = val;
+  }
+  return max_delta;
+}
+
+/*--------------------------------------------------------------------
+| Function: kernel3dLinhas
+| Description: Percorre os planos da fatia linha a linha
+---------------------------------------------------------------------*/
+
+double kernel3dLinhas (DoubleMatrix3D *de, DoubleMatrix3D *para, int zini, int zfim,
+                       int N, int by, int bx) {
+  double max_delta = 0;
+
+  for (int z = zini; z < zfim; z++)
+    for (int i = 1; i <= N; i++)
+      max_delta = linha3d(de, para, z, i, 1, N + 1, max_delta);
+  return max_delta;
+}
+
+/*--------------------------------------------------------------------
+| Function: kernel3dBlocos
+| Description: Blocos 2.5D: divide cada plano em blocos de by x bx
+|              pontos e, para cada bloco, percorre todos os planos da
+|              fatia. Os tres planos do bloco usados pelo estencil
+|              (z-1, z, z+1) ficam em cache, e cada ponto e' lido da
+|              memoria uma so' vez por iteracao em vez de tres.
+---------------------------------------------------------------------*/
+
+double kernel3dBlocos (DoubleMatrix3D *de, DoubleMatrix3D *para, int zini, int zfim,
+                       int N, int by, int bx) {
+  double max_delta = 0;
+
+  if (by < 1 || by > N)
+    by = N;
+  if (bx < 1 || bx > N)
+    bx = N;
+
+  for (int ib = 1; ib <= N; ib += by) {
+    int if_ = ib + by <= N + 1 ? ib + by : N + 1;
+    for (int jb = 1; jb <= N; jb += bx) {
+      int jf = jb + bx <= N + 1 ? jb + bx : N + 1;
+      for (int z = zini; z < zfim; z++)
+        for (int i = ib; i < if_; i++)
+          max_delta = linha3d(de, para, z, i, jb, jf, max_delta);
+    }
+  }
+  return max_delta;
+}
+
+/*--------------------------------------------------------------------
+| Function: kernel3dPorNome
+| Description: Devolve o kernel com o nome dado, ou NULL
+---------------------------------------------------------------------*/
+
+Kernel3DFn kernel3dPorNome (char const *nome) {
+  if (strcmp(nome, "linhas") == 0)
+    return kernel3dLinhas;
+  if (strcmp(nome, "blocos") == 0)
+    return kernel3dBlocos;
+  return NULL;
+}
@@ -0,0 +1,30 @@
+/*
+// Kernels do estencil de 7 pontos
+// Sistemas Operativos, DEI/IST/ULisboa 2017-18
+*/
+
+#ifndef KERNELS3D_H
+#define KERNELS3D_H
+
+#include "matrix3d.h"
+
+/*--------------------------------------------------------------------
+| Type: Kernel3DFn
+| Description: Calcula uma iteracao de Jacobi sobre os planos
+|              [zini, zfim[ de 'de', escrevendo em 'para', com N x N
+|              pontos interiores por plano. 'by' e 'bx' sao as
+|              dimensoes dos blocos (ignoradas por kernels sem blocos).
+|              Devolve o delta maximo dos pontos calculados.
+---------------------------------------------------------------------*/
+
+typedef double (*Kernel3DFn)(DoubleMatrix3D *de, DoubleMatrix3D *para,
+                             int zini, int zfim, int N, int by, int bx);
+
+double     kernel3dLinhas (DoubleMatrix3D *de, DoubleMatrix3D *para, int zini, int zfim,
+                           int N, int by, int bx);
+double     kernel3dBlocos (DoubleMatrix3D *de, DoubleMatrix3D *para, int zini, int zfim,
+                           int N, int by, int bx);
+
+Kernel3DFn kernel3dPorNome (char const *nome);
+
+#endif
@@ -167,7 +167,7 @@ void      leQueRemAllKey (QueHead* h, int k){
 
   while ((q_e=leQueFindKey(h, k))) {
     leQueRemElem (h, q_e);
-    free (q_e);
+    leQueFreeElem (q_e);
   }
 }
 
@@ -185,7 +185,7 @@ void      leQuePush           (QueHead* q_h, int k) {
   leQueInsLast(q_h, q_e);
   while(leQueNbElem(q_h)>leQueMaxElem(q_h)){
     q_e = leQueRemFirst(q_h);
-    free (q_e);
+    leQueFreeElem (q_e);
   }
   /* lePrintQueue (q_h); */
 }
@@ -199,7 +199,7 @@ void      leQueFreeAll (QueHead* q_h) {
   QueElem* q_e;
 
   while ((q_e = leQueRemFirst(q_h)))
-    free (q_e);
+    leQueFreeElem (q_e);
 }
 
 /*------------------------------------------------------------------+
@@ -215,3 +215,102 @@ void      leQueDup (QueHead* to, QueHead* from) {
   }
 }
 
+/*------------------------------------------------------------------+
+|  Keyed table: each element goes to the bucket of its key, so a
+|  lookup only scans the elements whose keys share the bucket
+--------------------------------------------------------------------*/
+
+static QueHead* leQueTabBucket (QueTab* t, int k) {
+  unsigned h = (unsigned) k;
+
+  h ^= h >> 16;
+  h *= 0x45d9f3bu;
+  h ^= h >> 16;
+  return &t->buckets[h & (t->nbuckets - 1)];
+}
+
+/*------------------------------------------------------------------+
+|  Function: leQueTabInit
+--------------------------------------------------------------------*/
+
+int       leQueTabInit (QueTab* t, int nbuckets) {
+  int n = 1;
+
+  while (n < nbuckets)
+    n <<= 1;
+  t->buckets = (QueHead*) malloc (n * SzQueHead);
+  if (t->buckets == NULL)
+    return -1;
+  for (int i = 0; i < n; i++) {
+    QueHead* q_h = &t->buckets[i];
+    leQueHeadInit (q_h, 0);
+  }
+  t->nbuckets = n;
+  t->nel      = 0;
+  return 0;
+}
+
+/*------------------------------------------------------------------+
+|  Function: leQueTabFree (the elements are not freed)
+--------------------------------------------------------------------*/
+
+void      leQueTabFree (QueTab* t) {
+  free (t->buckets);
+  t->buckets = NULL;
+}
+
+/*------------------------------------------------------------------+
+|  Function: leQueTabFind
+--------------------------------------------------------------------*/
+
+QueElem*  leQueTabFind (QueTab* t, int k) {
+  return leQueFindKey (leQueTabBucket (t, k), k);
+}
+
+/*------------------------------------------------------------------+
+|  Function: leQueTabGrow
+|  Doubles the buckets, keeping the order of equal keys. On failure
+|  the table stays as it was.
+--------------------------------------------------------------------*/
+
+static void leQueTabGrow (QueTab* t) {
+  QueTab   n;
+  QueElem* q_e;
+
+  if (leQueTabInit (&n, 2 * t->nbuckets) != 0)
+    return;
+  for (int i = 0; i < t->nbuckets; i++) {
+    QueHead* q_h = &t->buckets[i];
+    while ((q_e = leQueRemFirst (q_h))) {
+      QueHead* q_n = leQueTabBucket (&n, leQueGetKey (q_e));
+      leQueInsLast (q_n, q_e);
+    }
+  }
+  free (t->buckets);
+  t->buckets  = n.buckets;
+  t->nbuckets = n.nbuckets;
+}
+
+/*------------------------------------------------------------------+
+|  Function: leQueTabIns
+|  Grows the table when it has more than two elements per bucket
+--------------------------------------------------------------------*/
+
+void      leQueTabIns (QueTab* t, QueElem* q_e) {
+  QueHead* q_h;
+
+  if (t->nel >= 2 * t->nbuckets)
+    leQueTabGrow (t);
+  q_h = leQueTabBucket (t, leQueGetKey (q_e));
+  leQueInsLast (q_h, q_e);
+  t->nel++;
+}
+
+/*------------------------------------------------------------------+
+|  Function: leQueTabRem
+--------------------------------------------------------------------*/
+
+QueElem*  leQueTabRem (QueTab* t, QueElem* q_e) {
+  t->nel--;
+  return leQueRemElem (leQueTabBucket (t, leQueGetKey (q_e)), q_e);
+}
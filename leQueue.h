@@ -66,12 +66,22 @@
 |      int       leQueSize      ( QueHead* qh)
 |      int       leQueTestIsIn  ( QueHead* qh, QueElem* qe )
 |
+| - Keyed table (hashed buckets of queues, O(1) expected lookup)
+|
+|      int       leQueTabInit   ( QueTab* qt, int nbuckets )
+|      void      leQueTabFree   ( QueTab* qt )
+|      QueElem*  leQueTabFind   ( QueTab* qt, int key )
+|      void      leQueTabIns    ( QueTab* qt, QueElem* qe )
+|      QueElem*  leQueTabRem    ( QueTab* qt, QueElem* qe )
+|
 +----------------------------------------------------------------------*/
 
 
 #ifndef LEQUEUE
 #define LEQUEUE
 
+#include "pool.h"     /* elements and heads come from the pool allocator */
+
 
 /*---------------------------------------------------------------------+
 |   Global Definitions
@@ -95,15 +105,22 @@ typedef struct QueHead
 
 #define  SzQueHead  sizeof (struct QueHead)
 
+typedef struct QueTab
+{
+  QueHead *buckets;
+  int      nbuckets;    /* power of 2 */
+  int      nel;
+} QueTab;
+
 /*------------------------------------------------------------------+
 |   Macros
 --------------------------------------------------------------------*/
 
-#define  leQueNewHead()  ((QueHead*) malloc (SzQueHead))
-#define  leQueNewElem()  ((QueElem*) malloc (SzQueElem))
+#define  leQueNewHead()  ((QueHead*) poolAlocar (SzQueHead))
+#define  leQueNewElem()  ((QueElem*) poolAlocar (SzQueElem))
 
-#define  leQueFreeHead(qh_p)  free (qh_p)
-#define  leQueFreeElem(qe_p)  free (qe_p)
+#define  leQueFreeHead(qh_p)  poolLibertar (qh_p)
+#define  leQueFreeElem(qe_p)  poolLibertar (qe_p)
 
 #define  leQueHeadInit(qh_p, max)			\
 if (1) {\
@@ -163,5 +180,11 @@ void      leQuePush        (QueHead* h, int k);
 void      leQueFreeAll     (QueHead* h);
 void      leQueDup         (QueHead* to, QueHead* from);
 
+int       leQueTabInit     (QueTab* t, int nbuckets);
+void      leQueTabFree     (QueTab* t);
+QueElem*  leQueTabFind     (QueTab* t, int k);
+void      leQueTabIns      (QueTab* t, QueElem* e);
+QueElem*  leQueTabRem      (QueTab* t, QueElem* e);
+
 #endif /* LEQUEUE */
 
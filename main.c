@@ -3,6 +3,8 @@
 // Sistemas Operativos, DEI/IST/ULisboa 2017-18
 */
 
+#define _GNU_SOURCE
+
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
@@ -12,239 +14,184 @@
 #include <signal.h>
 #include <sys/wait.h>
 #include <sys/errno.h>
+#include <limits.h>
 
 #include "matrix2d.h"
 #include "util.h"
-
-/*--------------------------------------------------------------------
-| Type: thread_info
-| Description: Estrutura com Informacao para Trabalhadoras
----------------------------------------------------------------------*/
-
-typedef struct {
-  int    id;
-  int    iter;
-  int    trab;
-  int    tam_fatia;
-  double maxD;
-} thread_info;
-
-/*--------------------------------------------------------------------
-| Type: doubleBarrierWithMax
-| Description: Barreira dupla com variavel de max-reduction
----------------------------------------------------------------------*/
-
-typedef struct {
-  int             total_nodes;
-  int             pending[2];
-  double          maxdelta[2];
-  int             iteracoes_concluidas;
-  pthread_mutex_t mutex;
-  pthread_cond_t  wait[2];
-} DualBarrierWithMax;
+#include "barreira.h"
+#include "kernels.h"
+#include "medicao.h"
+#include "afinacao.h"
+#include "monitor.h"
+#include "frames.h"
+#include "partilha.h"
+#include "saida.h"
+#include "sobreposicao.h"
+#include "arranque.h"
+#include "dst.h"
+#include "acelerar.h"
+#include "disco.h"
+#include "heatsim.h"
+#include "estado.h"
 
 /*--------------------------------------------------------------------
 | Global variables
 ---------------------------------------------------------------------*/
 
 DoubleMatrix2D     *matrix_copies[2];
-DualBarrierWithMax *dual_barrier;
+HeatSim            *simulacao;
 double              maxD;
-FILE               *file;
 int                 salvaguarda = 1;
 char               *fichS;
 int                 periodoS;
-int                 atual_global;
-pid_t               main_pid;
 int                 N;
 int                 printing = 0;
 pid_t               printer_pid;
 
 /*--------------------------------------------------------------------
-| Function: dualBarrierInit
-| Description: Inicializa uma barreira dupla
+| Opcoes (argumentos opcionais depois de periodoS)
 ---------------------------------------------------------------------*/
 
-DualBarrierWithMax *dualBarrierInit(int ntasks) {
-  DualBarrierWithMax *b;
-  b = (DualBarrierWithMax*) malloc (sizeof(DualBarrierWithMax));
-  if (b == NULL) return NULL;
+Configuracao        config = { 0, "simples", 0, 0, BARREIRA_COND, 0 };
+int                 modo_bench         = 0;
+int                 autotune           = 0;
+int                 usar_afinacao      = 1;
+char const         *fich_afinacao      = AFINACAO_FICHEIRO;
+int                 kernel_definido    = 0;
+int                 bloco_definido     = 0;
+int                 barreira_definida  = 0;
+int                 afinidade_definida = 0;
+char const         *monitor_caminho    = NULL;
+int                 frames_periodo     = 0;
+char const         *frames_ficheiro    = "frames.bin";
+int                 frames_reducao     = 1;
+int                 frames_buffers     = 4;
+PoliticaFrames      frames_politica    = FRAMES_DESCARTAR;
+char const         *shm_nome           = NULL;
+int                 shm_periodo        = 10;
+int                 shm_slots          = 2;
+ModoSaida           modo_saida         = SAIDA_COMPLETA;
+int                 regiao[4];
+int                 amostra_tam        = 1024;
+int                 histograma_bins    = 10;
+char const         *cache_sobreposicao = NULL;
+char const         *arranque_dir       = NULL;
+int                 grosseiro          = 0;
+int                 comparar           = 0;
+int                 direto             = 0;
+int                 oraculo            = 0;
+TipoAceleracao      aceleracao         = ACEL_NENHUMA;
+double              adi_dt             = 0;
+double              adi_tempo          = 0;
+int                 memoria_reduzida   = 0;
+int                 mensagens_cap      = -1;   // < 0: sem mensagens
+char const         *fora_nucleo        = NULL;
+long                memoria_mb         = 256;
+int                 reparticao         = 0;    // 0: fatias fixas
+double              prazo              = 0;    // segundos; 0: sem prazo
+double              prazo_reserva      = -1;   // < 0: estimada por N
+double              prazo_instante     = 0;
+volatile sig_atomic_t interrompido     = 0;
+volatile sig_atomic_t salvaguarda_pedida = 0;  // --memoria-reduzida
+EstadoGuardado      retoma;                    // N e temperaturas desta execucao
+char                fich_estado[520];          // fichS.estado
+int                 retomado           = 0;
 
-  b->total_nodes = ntasks;
-  b->pending[0]  = ntasks;
-  b->pending[1]  = ntasks;
-  b->maxdelta[0] = 0;
-  b->maxdelta[1] = 0;
-  b->iteracoes_concluidas = 0;
+// grelha mais pequena usada no arranque por grelhas grosseiras
+#define GROSSEIRO_MIN 16
 
-  if (pthread_mutex_init(&(b->mutex), NULL) != 0) {
-    fprintf(stderr, "\nErro a inicializar mutex\n");
-    exit(1);
-  }
-  if (pthread_cond_init(&(b->wait[0]), NULL) != 0) {
-    fprintf(stderr, "\nErro a inicializar variável de condição\n");
-    exit(1);
-  }
-  if (pthread_cond_init(&(b->wait[1]), NULL) != 0) {
-    fprintf(stderr, "\nErro a inicializar variável de condição\n");
-    exit(1);
-  }
-  return b;
-}
+// estados de saida de uma execucao interrompida, com salvaguarda
+// retomavel: prazo esgotado (EX_TEMPFAIL, para o escalonador voltar a
+// submeter) e SIGINT (128 + SIGINT, como a shell)
+#define SAIDA_PRAZO        75
+#define SAIDA_INTERROMPIDA 130
 
 /*--------------------------------------------------------------------
-| Function: dualBarrierFree
-| Description: Liberta os recursos de uma barreira dupla
+| Function: preparar_matrizes
+| Description: Repoe as matrizes ja' alocadas no estado inicial: pontos
+|              interiores a zero e temperaturas nas fronteiras
 ---------------------------------------------------------------------*/
 
-void dualBarrierFree(DualBarrierWithMax* b) {
-  if (pthread_mutex_destroy(&(b->mutex)) != 0) {
-    fprintf(stderr, "\nErro a destruir mutex\n");
-    exit(1);
-  }
-  if (pthread_cond_destroy(&(b->wait[0])) != 0) {
-    fprintf(stderr, "\nErro a destruir variável de condição\n");
-    exit(1);
-  }
-  if (pthread_cond_destroy(&(b->wait[1])) != 0) {
-    fprintf(stderr, "\nErro a destruir variável de condição\n");
-    exit(1);
-  }
-  free(b);
-}
-
-/*--------------------------------------------------------------------
-| Function: dualBarrierWait
-| Description: Ao chamar esta funcao, a tarefa fica bloqueada ate que
-|              o numero 'ntasks' de tarefas necessario tenham chamado
-|              esta funcao, especificado ao ininializar a barreira em
-|              dualBarrierInit(ntasks). Esta funcao tambem calcula o
-|              delta maximo entre todas as threads e devolve o
-|              resultado no valor de retorno
----------------------------------------------------------------------*/
-
-double dualBarrierWait (DualBarrierWithMax* b, int current, double localmax) {
-  int next = 1 - current;
-  if (pthread_mutex_lock(&(b->mutex)) != 0) {
-    fprintf(stderr, "\nErro a bloquear mutex\n");
-    exit(1);
-  }
-  // decrementar contador de tarefas restantes
-  b->pending[current]--;
-  // actualizar valor maxDelta entre todas as threads
-  if (b->maxdelta[current]<localmax)
-    b->maxdelta[current]=localmax;
-  // verificar se sou a ultima tarefa
-  if (b->pending[current]==0) {
-    // sim -- inicializar proxima barreira e libertar threads
-    b->iteracoes_concluidas++;
-    b->pending[next]  = b->total_nodes;
-    b->maxdelta[next] = 0;
-    atual_global = 1 - current;
-    if (pthread_cond_broadcast(&(b->wait[current])) != 0) {
-      fprintf(stderr, "\nErro a assinalar todos em variável de condição\n");
-      exit(1);
-    }
-  }
-  else {
-    // nao -- esperar pelas outras tarefas
-    while (b->pending[current]>0) {
-      if (pthread_cond_wait(&(b->wait[current]), &(b->mutex)) != 0) {
-        fprintf(stderr, "\nErro a esperar em variável de condição\n");
-        exit(1);
-      }
-    }
-  }
-  double maxdelta = b->maxdelta[current];
-  if (pthread_mutex_unlock(&(b->mutex)) != 0) {
-    fprintf(stderr, "\nErro a desbloquear mutex\n");
-    exit(1);
-  }
-  return maxdelta;
+void preparar_matrizes(int N, double tSup, double tInf,
+                       double tEsq, double tDir) {
+  for (int i = 1; i <= N; i++)
+    dm2dSetLineTo (matrix_copies[0], i, 0);
+  dm2dSetLineTo (matrix_copies[0], 0, tSup);
+  dm2dSetLineTo (matrix_copies[0], N+1, tInf);
+  dm2dSetColumnTo (matrix_copies[0], 0, tEsq);
+  dm2dSetColumnTo (matrix_copies[0], N+1, tDir);
+  dm2dCopy (matrix_copies[1],matrix_copies[0]);
 }
 
 /*--------------------------------------------------------------------
 | Function: inicializar_matrizes
 | Description: Funcao executada pela tarefa mestre para inicializar as
 |              matrizes. As matrizes sao inicializadas dependendo se
-|              existir o ficheiro passado como argumento. Retorna o
-|              file descriptor aberto.
+|              existir o ficheiro passado como argumento. Se tambem
+|              existir fich_estado, desta grelha e temperaturas, a
+|              matriz exacta e as iteracoes vem dele e ficam em
+|              'retoma'.
 ---------------------------------------------------------------------*/
 
-void inicializar_matrizes(int N, int tSup, int tInf,
-                           int tEsq, int tDir) {
+void inicializar_matrizes(int N, double tSup, double tInf,
+                           double tEsq, double tDir) {
   FILE *fp;
   fp = fopen(fichS, "r");
   if (fp != NULL) {
     matrix_copies[0] = readMatrix2dFromFile(fp, N+2, N+2);
-    matrix_copies[1] = dm2dNew(N+2, N+2);
+    matrix_copies[1] = memoria_reduzida ? matrix_copies[0] : dm2dNew(N+2, N+2);
     dm2dCopy (matrix_copies[1],matrix_copies[0]);
     fclose(fp);
+    if (estadoCarregar(fich_estado, matrix_copies[0], &retoma) == 0) {
+      dm2dCopy (matrix_copies[1],matrix_copies[0]);
+      retomado = 1;
+      fprintf(stderr, "Retoma: %d iteracoes feitas, delta %.3e, de %s\n",
+              retoma.iteracoes, retoma.delta, fich_estado);
+    }
   } else {
     matrix_copies[0] = dm2dNew(N+2,N+2);
-    matrix_copies[1] = dm2dNew(N+2,N+2);
+    matrix_copies[1] = memoria_reduzida ? matrix_copies[0] : dm2dNew(N+2,N+2);
     if (matrix_copies[0] == NULL || matrix_copies[1] == NULL) {
       die("Erro ao criar matrizes");
     }
-
-    dm2dSetLineTo (matrix_copies[0], 0, tSup);
-    dm2dSetLineTo (matrix_copies[0], N+1, tInf);
-    dm2dSetColumnTo (matrix_copies[0], 0, tEsq);
-    dm2dSetColumnTo (matrix_copies[0], N+1, tDir);
-    dm2dCopy (matrix_copies[1],matrix_copies[0]);
+    preparar_matrizes(N, tSup, tInf, tEsq, tDir);
   }
 }
 
 /*--------------------------------------------------------------------
-| Function: tarefa_trabalhadora
-| Description: Funcao executada por cada tarefa trabalhadora.
-|              Recebe como argumento uma estrutura do tipo thread_info
+| Function: guardar_estado
+| Description: Salvaguarda a iteracao 'iteracoes': a matriz em texto em
+|              fichS, como ate' aqui, e o estado exacto retomavel em
+|              fich_estado. Devolve 0 em caso de sucesso.
 ---------------------------------------------------------------------*/
 
-void *tarefa_trabalhadora(void *args) {
-  thread_info *tinfo = (thread_info *) args;
-  int tam_fatia = tinfo->tam_fatia;
-  int my_base = tinfo->id * tam_fatia;
-  double global_delta = INFINITY;
-  int iter = 0;
+int guardar_estado(int iteracoes, double delta) {
+  char           tmp[520];
+  EstadoGuardado e = retoma;
+  FILE          *f;
 
-  do {
-    int atual = iter % 2;
-    int prox = 1 - iter % 2;
-    double max_delta = 0;
-
-    // Calcular Pontos Internos
-    for (int i = my_base; i < my_base + tinfo->tam_fatia; i++) {
-      for (int j = 0; j < N; j++) {
-        double val = (dm2dGetEntry(matrix_copies[atual], i,   j+1) +
-                      dm2dGetEntry(matrix_copies[atual], i+2, j+1) +
-                      dm2dGetEntry(matrix_copies[atual], i+1, j) +
-                      dm2dGetEntry(matrix_copies[atual], i+1, j+2))/4;
-        // calcular delta
-        double delta = fabs(val - dm2dGetEntry(matrix_copies[atual], i+1, j+1));
-        if (delta > max_delta) {
-          max_delta = delta;
-        }
-        dm2dSetEntry(matrix_copies[prox], i+1, j+1, val);
-      }
-    }
-    // barreira de sincronizacao; calcular delta global
-    global_delta = dualBarrierWait(dual_barrier, atual, max_delta);
-  } while (++iter < tinfo->iter && global_delta >= tinfo->maxD);
+  snprintf(tmp, sizeof(tmp), "%s~", fichS);
+  f = fopen(tmp, "w");
+  if (f == NULL)
+    return -1;
+  dm2dPrintToFile(matrix_copies[iteracoes%2], f, N+2, N+2);
+  if (fclose(f) != 0 || rename(tmp, fichS) != 0)
+    return -1;
 
-  return 0;
+  e.iteracoes = iteracoes;
+  e.delta     = delta;
+  return estadoGuardar(fich_estado, matrix_copies[iteracoes%2], &e);
 }
 
 /*--------------------------------------------------------------------
-| Function: timerHandler
-| Description: Handler for SIGALRM
+| Function: lancar_salvaguarda
+| Description: Escreve a salvaguarda da iteracao 'iteracoes' num
+|              processo filho, que tem uma copia das matrizes parada
+|              no fork, depois de esperar pela anterior
 ---------------------------------------------------------------------*/
-void timerHandler() {
+
+void lancar_salvaguarda(int iteracoes, double delta) {
   int status;
-  char buffer[256] = "";
-  strcat(buffer, fichS);
-  strcat(buffer, "~");
-  buffer[strlen(buffer)-1] = 0;
 
   if(printing) {
     waitpid(printer_pid, &status, 0);
@@ -252,38 +199,601 @@ void timerHandler() {
   }
   printer_pid = fork();
   if (printer_pid == 0) {
-    file = fopen(buffer, "w");
-    if (file == NULL)
-      die("Erro ao abrir ficheiro");
-    dm2dPrintToFile(matrix_copies[atual_global], file, N+2, N+2);
-    fclose(file);
-    rename(buffer, fichS);
+    if (guardar_estado(iteracoes, delta) != 0)
+      die("Erro ao escrever a salvaguarda");
     exit(1);
   } else if (printer_pid > 0) {
-    signal(SIGALRM, timerHandler);
-    alarm(periodoS);
+    monitorSalvaguarda();
     printing = 1;
   } else {
     fprintf(stderr, "Erro ao criar processo paralelo.\n");
     exit(-1);
   }
-  exit(0);
+}
+
+/*--------------------------------------------------------------------
+| Function: fim_de_iteracao
+| Description: Chamada pela barreira, pela ultima trabalhadora a
+|              terminar cada iteracao, antes de libertar as outras
+---------------------------------------------------------------------*/
+
+void fim_de_iteracao(void *arg, int iteracoes, double delta) {
+  if (monitor_caminho != NULL)
+    monitorPublicar(iteracoes, delta);
+  framesReservar(iteracoes, delta);
+  partilhaReservar(iteracoes, delta, heatsimInterrompida(simulacao) != 0);
+  // as outras trabalhadoras estao na barreira: a matriz e' toda desta
+  // iteracao
+  if (salvaguarda_pedida) {
+    salvaguarda_pedida = 0;
+    lancar_salvaguarda(iteracoes, delta);
+  }
+}
+
+/*--------------------------------------------------------------------
+| Function: copiar_iteracao
+| Description: Chamada por cada trabalhadora depois da barreira, com a
+|              matriz acabada de calcular e as suas linhas [lo, hi[
+---------------------------------------------------------------------*/
+
+void copiar_iteracao(void *arg, int iteracoes, DoubleMatrix2D *m, int lo, int hi) {
+  framesCopiar(iteracoes, m, lo, hi);
+  partilhaCopiar(iteracoes, m, lo, hi);
+}
+
+/*--------------------------------------------------------------------
+| Function: executar_trabalhadoras
+| Description: Corre 'cfg->trab' trabalhadoras sobre as matrizes
+|              globais, numa nova simulacao da libheatsim, e devolve o
+|              numero de iteracoes concluidas. A simulacao fica em
+|              'simulacao' ate' a proxima chamada. Se 'estat' nao for
+|              NULL, cada trabalhadora calcula no fim as estatisticas
+|              da sua fatia em estat[id]. Se 'desde' nao for NULL,
+|              continua o estado guardado com desde->iteracoes; o
+|              valor devolvido conta-as. As restantes opcoes
+|              (aceleracao, adi_dt, mensagens_cap, reparticao, prazo)
+|              sao as globais.
+---------------------------------------------------------------------*/
+
+int executar_trabalhadoras(Configuracao const *cfg, EstadoGuardado const *desde, int iter,
+                           double maxD, Estatisticas *estat) {
+  HeatSimOpcoes op = { N, cfg->trab, cfg->kernel, cfg->bloco, cfg->barreira,
+                       cfg->afinidade, aceleracao, adi_dt, mensagens_cap, estat,
+                       reparticao };
+  double  *campos[2] = { matrix_copies[0]->data, matrix_copies[1]->data };
+  HeatSim *anterior = simulacao;
+
+  // o handler de SIGINT nunca ve uma simulacao ja' libertada
+  simulacao = NULL;
+  heatsimLibertar(anterior);
+  anterior = heatsimCriar(&op, campos);
+  if (anterior == NULL)
+    die("Nao foi possivel criar a simulacao");
+  heatsimDefinirGanchos(anterior, fim_de_iteracao, copiar_iteracao, NULL);
+  if (desde != NULL)
+    heatsimRetomar(anterior, desde->iteracoes, desde->delta);
+  if (prazo_instante > 0)
+    heatsimDefinirPrazo(anterior, prazo_instante);
+  simulacao = anterior;
+  if (interrompido)
+    heatsimParar(simulacao);
+
+  if (heatsimCorrerAte(simulacao, iter, maxD) < 0)
+    die("Erro ao criar as tarefas trabalhadoras");
+  return heatsimIteracoes(simulacao);
+}
+
+/*--------------------------------------------------------------------
+| Function: iteracoes_feitas
+| Description: Iteracoes concluidas pela simulacao em curso, para os
+|              handlers de sinais; o resultado esta' em
+|              matrix_copies[iteracoes_feitas()%2]
+---------------------------------------------------------------------*/
+
+int iteracoes_feitas() {
+  return simulacao != NULL ? heatsimIteracoes(simulacao) : 0;
+}
+
+/*--------------------------------------------------------------------
+| Function: relatar_fatias
+| Description: Escreve em stderr as fatias da reparticao adaptativa e o
+|              tempo que cada trabalhadora passou 'a espera na barreira
+|              durante os 'tempo' segundos da corrida
+---------------------------------------------------------------------*/
+
+void relatar_fatias(double tempo) {
+  HeatSimFatia *f = (HeatSimFatia*) malloc(config.trab * sizeof(HeatSimFatia));
+  if (f == NULL)
+    die("Erro ao alocar memoria para o relatorio");
+
+  int mudancas = heatsimFatias(simulacao, f);
+  fprintf(stderr, "Reparticao a cada %d iteracoes: %d mudancas em %d iteracoes\n",
+          reparticao, mudancas, heatsimIteracoes(simulacao));
+  fprintf(stderr, "  trab  linhas (min-max)  espera na barreira\n");
+  for (int t = 0; t < config.trab; t++)
+    fprintf(stderr, "  %4d  %6d (%d-%d)  %.3f s (%.1f%%)\n", t, f[t].linhas,
+            f[t].min, f[t].max, f[t].espera, 100 * f[t].espera / tempo);
+  free(f);
+}
+
+/*--------------------------------------------------------------------
+| Function: afinar
+| Description: Mede a largura de banda e as caches da maquina, corre
+|              cada configuracao candidata durante poucas iteracoes e
+|              guarda a mais rapida no ficheiro de afinacao. Usa
+|              matrizes proprias, libertadas no fim.
+---------------------------------------------------------------------*/
+
+Configuracao afinar(int N, double tSup, double tInf, double tEsq, double tDir) {
+  static Configuracao cand[AFINACAO_MAX_CAND];
+  Maquina m;
+  int     melhor = 0;
+
+  maquinaDetectar(&m, 1);
+  int n = afinacaoCandidatas(&m, N, cand);
+
+  // limite inferior do tempo por iteracao dado pela largura de banda
+  double t_min = bytesPorIteracao(N) / (m.largura_banda * 1e9);
+  int    iters = (int) (0.02 / t_min);
+  if (iters < 5)   iters = 5;
+  if (iters > 500) iters = 500;
+
+  fprintf(stderr, "Afinacao: %s, %d CPUs, L1 %ldK L2 %ldK L3 %ldK, %.2f GB/s\n"
+                  "          limite por largura de banda: %.3e s/iter;"
+                  " %d candidatas x %d iteracoes\n",
+          m.modelo, m.ncpus, m.cache_l1 >> 10, m.cache_l2 >> 10, m.cache_l3 >> 10,
+          m.largura_banda, t_min, n, iters);
+
+  matrix_copies[0] = dm2dNew(N+2, N+2);
+  matrix_copies[1] = dm2dNew(N+2, N+2);
+  if (matrix_copies[0] == NULL || matrix_copies[1] == NULL)
+    die("Erro ao criar matrizes");
+
+  for (int c = 0; c < n; c++) {
+    preparar_matrizes(N, tSup, tInf, tEsq, tDir);
+    double t0 = tempoAgora();
+    int feitas = executar_trabalhadoras(&cand[c], NULL, iters, 0, NULL);
+    cand[c].tempo_iter = (tempoAgora() - t0) / feitas;
+    if (cand[c].tempo_iter < cand[melhor].tempo_iter)
+      melhor = c;
+    fprintf(stderr, "  trab=%-3d kernel=%-8s bloco=%-6d afinidade=%d barreira=%-4s"
+                    "  %.3e s/iter (%3.0f%% do limite)\n",
+            cand[c].trab, cand[c].kernel, cand[c].bloco, cand[c].afinidade,
+            barreiraNome(cand[c].barreira), cand[c].tempo_iter,
+            100 * t_min / cand[c].tempo_iter);
+  }
+
+  dm2dFree(matrix_copies[0]);
+  dm2dFree(matrix_copies[1]);
+
+  if (afinacaoGuardar(fich_afinacao, m.modelo, afinacaoFaixa(N), &cand[melhor]) != 0)
+    fprintf(stderr, "Aviso: nao foi possivel escrever %s\n", fich_afinacao);
+  fprintf(stderr, "Escolhida: trab=%d kernel=%s bloco=%d afinidade=%d barreira=%s\n",
+          cand[melhor].trab, cand[melhor].kernel, cand[melhor].bloco,
+          cand[melhor].afinidade, barreiraNome(cand[melhor].barreira));
+  return cand[melhor];
+}
+
+/*--------------------------------------------------------------------
+| Function: aplicar_afinacao
+| Description: Completa 'config' com a afinacao guardada para esta
+|              maquina e faixa de N. As opcoes dadas explicitamente e
+|              um trab diferente de 0 tem prioridade.
+---------------------------------------------------------------------*/
+
+void aplicar_afinacao(Configuracao const *afinada) {
+  if (config.trab == 0 && N % afinada->trab == 0)
+    config.trab = afinada->trab;
+  if (!kernel_definido && kernelPorNome(afinada->kernel) != NULL)
+    snprintf(config.kernel, sizeof(config.kernel), "%s", afinada->kernel);
+  if (!bloco_definido)
+    config.bloco = afinada->bloco;
+  if (!afinidade_definida)
+    config.afinidade = afinada->afinidade;
+  if (!barreira_definida)
+    config.barreira = afinada->barreira;
+}
+
+/*--------------------------------------------------------------------
+| Function: resolver_por_sobreposicao
+| Description: Tenta obter o estado estacionario como combinacao
+|              linear das solucoes base guardadas na cache, calculando
+|              e guardando as que faltarem. O resultado fica em
+|              matrix_copies[0]. Devolve 1 se resolveu, 0 se o caso
+|              tem de ser iterado (ficheiro inicial ou maxD nulo), ou
+|              -1 se o calculo de uma base foi parado pelo prazo ou
+|              por SIGINT; essa base nao e' guardada e as matrizes
+|              voltam ao estado inicial.
+---------------------------------------------------------------------*/
+
+int resolver_por_sobreposicao(double tEsq, double tSup, double tDir, double tInf) {
+  double  coef[4] = { 0 }, tol_base[4], erro = 0, soma = 0;
+  double *bases[4] = { NULL, NULL, NULL, NULL };
+
+  coef[BORDA_ESQ] = tEsq;
+  coef[BORDA_SUP] = tSup;
+  coef[BORDA_DIR] = tDir;
+  coef[BORDA_INF] = tInf;
+
+  if (access(fichS, F_OK) == 0) {
+    fprintf(stderr, "Sobreposicao: estado inicial lido de %s, a iterar\n", fichS);
+    return 0;
+  }
+  if (maxD <= 0) {
+    fprintf(stderr, "Sobreposicao: maxD = 0 nao define tolerancia, a iterar\n");
+    return 0;
+  }
+
+  // o erro da combinacao escala com a soma dos coeficientes; com
+  // bases a tol <= maxD / soma o resultado nao e' pior do que iterar
+  for (int b = 0; b < 4; b++)
+    soma += fabs(coef[b]);
+  double tol = soma > 0 ? maxD / soma : maxD;
+
+  for (int b = 0; b < 4; b++) {
+    bases[b] = sobreposicaoCarregar(cache_sobreposicao, N, b, tol, &tol_base[b]);
+    if (bases[b] != NULL)
+      continue;
+
+    // calcular a base com margem, para servir pedidos futuros
+    double unit[4] = { 0, 0, 0, 0 };
+    double tb = tol / 4;
+    unit[b] = 1;
+    preparar_matrizes(N, unit[BORDA_SUP], unit[BORDA_INF], unit[BORDA_ESQ], unit[BORDA_DIR]);
+    double t0 = tempoAgora();
+    int it = executar_trabalhadoras(&config, NULL, INT_MAX, tb, NULL);
+    if (heatsimInterrompida(simulacao)) {
+      fprintf(stderr, "Sobreposicao: base %d parada apos %d iteracoes, nao guardada\n", b, it);
+      for (int c = 0; c < b; c++)
+        sobreposicaoLibertar(bases[c], N);
+      preparar_matrizes(N, tSup, tInf, tEsq, tDir);
+      return -1;
+    }
+    fprintf(stderr, "Sobreposicao: base %d calculada em %d iteracoes (%.2f s)\n",
+            b, it, tempoAgora() - t0);
+    if (sobreposicaoGuardar(cache_sobreposicao, N, b, tb, it, matrix_copies[it%2]) == 0)
+      bases[b] = sobreposicaoCarregar(cache_sobreposicao, N, b, tol, &tol_base[b]);
+
+    if (bases[b] == NULL) {
+      fprintf(stderr, "Sobreposicao: nao foi possivel guardar em %s, a iterar\n",
+              cache_sobreposicao);
+      for (int c = 0; c < b; c++)
+        sobreposicaoLibertar(bases[c], N);
+      preparar_matrizes(N, tSup, tInf, tEsq, tDir);
+      return 0;
+    }
+  }
+
+  double t0 = tempoAgora();
+  sobreposicaoCombinar(matrix_copies[0], bases, coef, config.trab);
+  for (int b = 0; b < 4; b++) {
+    erro += fabs(coef[b]) * sobreposicaoLimiteErro(N, tol_base[b]);
+    sobreposicaoLibertar(bases[b], N);
+  }
+  fprintf(stderr, "Sobreposicao: combinacao em %.3f s; limite de erro garantido %.3e"
+                  " (iterar ate' maxD garante %.3e)\n",
+          tempoAgora() - t0, erro, sobreposicaoLimiteErro(N, maxD));
+  return 1;
+}
+
+/*--------------------------------------------------------------------
+| Function: resolver_grosseiro
+| Description: Resolve o mesmo problema numa grelha de Nc x Nc pontos,
+|              partindo por sua vez de uma grelha com metade dos
+|              pontos enquanto Nc/2 >= GROSSEIRO_MIN. Acumula em
+|              *trabalho as iteracoes feitas, em unidades de iteracoes
+|              da grelha fina. N e matrix_copies sao repostos no fim.
+|              Devolve NULL, sem nada alocado, se uma das execucoes
+|              for parada pelo prazo ou por SIGINT.
+---------------------------------------------------------------------*/
+
+DoubleMatrix2D *resolver_grosseiro(int Nc, double const t[4], double tol, double *trabalho) {
+  int             N_fino = N;
+  DoubleMatrix2D *fino[2] = { matrix_copies[0], matrix_copies[1] };
+  Configuracao    cfg = config;
+  int             it = 0, parada = 0;
+
+  while (Nc % cfg.trab != 0)
+    cfg.trab--;
+
+  N = Nc;
+  matrix_copies[0] = dm2dNew(N+2, N+2);
+  matrix_copies[1] = dm2dNew(N+2, N+2);
+  if (matrix_copies[0] == NULL || matrix_copies[1] == NULL)
+    die("Erro ao criar matrizes");
+  preparar_matrizes(N, t[1], t[3], t[0], t[2]);
+
+  if (Nc / 2 >= GROSSEIRO_MIN) {
+    DoubleMatrix2D *g = resolver_grosseiro(Nc / 2, t, tol, trabalho);
+    parada = g == NULL;
+    if (!parada) {
+      arranqueInterpolar(g, matrix_copies[0]);
+      dm2dCopy(matrix_copies[1], matrix_copies[0]);
+      dm2dFree(g);
+    }
+  }
+
+  if (!parada) {
+    it = executar_trabalhadoras(&cfg, NULL, INT_MAX, tol, NULL);
+    *trabalho += it * ((double) Nc / N_fino) * ((double) Nc / N_fino);
+    parada = heatsimInterrompida(simulacao) != 0;
+    fprintf(stderr, "Arranque: grelha %dx%d %s %d iteracoes\n", Nc, Nc,
+            parada ? "parada apos" : "em", it);
+  }
+
+  DoubleMatrix2D *res = parada ? NULL : matrix_copies[it % 2];
+  dm2dFree(matrix_copies[1 - it % 2]);
+  if (parada)
+    dm2dFree(matrix_copies[it % 2]);
+  N = N_fino;
+  matrix_copies[0] = fino[0];
+  matrix_copies[1] = fino[1];
+  return res;
+}
+
+/*--------------------------------------------------------------------
+| Function: arranque_quente
+| Description: Substitui o interior a zero de matrix_copies por uma
+|              estimativa: a solucao guardada mais proxima ou, na sua
+|              falta, a solucao de grelhas mais grosseiras,
+|              interpolada. Devolve as iteracoes gastas nas grelhas
+|              grosseiras, em unidades da grelha fina, ou -1 se o
+|              calculo nelas foi parado; matrix_copies fica intacta.
+---------------------------------------------------------------------*/
+
+double arranque_quente(double const t[4]) {
+  DoubleMatrix2D *inicial = NULL;
+  double          trabalho = 0;
+  SolucaoGuardada s;
+
+  if (arranque_dir != NULL) {
+    inicial = arranqueProcurar(arranque_dir, N, t, &s);
+    if (inicial != NULL)
+      fprintf(stderr, "Arranque: solucao guardada N=%d t=(%g, %g, %g, %g)\n",
+              s.N, s.t[0], s.t[1], s.t[2], s.t[3]);
+  }
+  if (inicial == NULL && grosseiro && maxD > 0 && N / 2 >= GROSSEIRO_MIN) {
+    inicial = resolver_grosseiro(N / 2, t, maxD, &trabalho);
+    if (inicial == NULL)
+      return -1;
+  }
+  if (inicial == NULL)
+    return 0;
+
+  arranqueInterpolar(inicial, matrix_copies[0]);
+  dm2dCopy(matrix_copies[1], matrix_copies[0]);
+  dm2dFree(inicial);
+  return trabalho;
+}
+
+/*--------------------------------------------------------------------
+| Function: medir_em_memoria
+| Description: Pontos por segundo da libheatsim, com a configuracao e as
+|              trabalhadoras de config, como referencia para a
+|              resolucao fora do nucleo. A grelha e' a mesma se as duas
+|              matrizes couberem em 'memoria' bytes; senao, a maior que
+|              cabe, multiplo de config.trab. Devolve o lado usado em *n.
+---------------------------------------------------------------------*/
+
+double medir_em_memoria(double tEsq, double tSup, double tDir, double tInf, size_t memoria,
+                        int *n) {
+  long lado = (long) sqrt((double) memoria / (2 * sizeof(double))) - 2;
+  lado = lado > N ? N : lado;
+  lado -= lado % config.trab;
+  *n = lado < config.trab ? config.trab : (int) lado;
+
+  HeatSimOpcoes op = { *n, config.trab, config.kernel, config.bloco, config.barreira,
+                       config.afinidade, ACEL_NENHUMA, 0, -1, NULL, 0 };
+  double  *campos[2] = { NULL, NULL };
+  HeatSim *s = heatsimCriar(&op, campos);
+  if (s == NULL)
+    return 0;
+  heatsimIniciar(s, tEsq, tSup, tDir, tInf);
+
+  double t0 = tempoAgora(), t;
+  int    passo = 1;
+  do {
+    if (heatsimPasso(s, passo) < 0)
+      die("Erro ao criar as tarefas trabalhadoras");
+    passo *= 2;
+    t = tempoAgora() - t0;
+  } while (t < 0.2);
+  double celulas_s = (double) *n * *n * heatsimIteracoes(s) / t;
+  heatsimLibertar(s);
+  return celulas_s;
+}
+
+/*--------------------------------------------------------------------
+| Function: resolver_fora_do_nucleo
+| Description: Resolve com a grelha no ficheiro 'fora_nucleo' e mapeia
+|              o resultado em matrix_copies[0] e [1] para a saida.
+|              Devolve o numero de iteracoes.
+---------------------------------------------------------------------*/
+
+int resolver_fora_do_nucleo(double tEsq, double tSup, double tDir, double tInf, int iter) {
+  ResultadoDisco r;
+  size_t         bytes = (size_t) memoria_mb << 20;
+  int            n_ram;
+
+  if (discoIniciar(fora_nucleo, N, tEsq, tSup, tDir, tInf) != 0)
+    die("Nao foi possivel criar o ficheiro da grelha");
+  if (discoResolver(fora_nucleo, N, iter, maxD, bytes, config.trab, &r) != 0)
+    die("Memoria insuficiente ou erro de E/S fora do nucleo");
+
+  fprintf(stderr, "Fora do nucleo: %d iteracoes em %.3f s, fatias de %d linhas, "
+                  "%d iteracoes por passagem\n", r.iteracoes, r.tempo, r.fatia, r.niveis);
+  if (r.abaixo > 0)
+    fprintf(stderr, "Fora do nucleo: delta < maxD na iteracao %d; o criterio e' avaliado "
+                    "por passagem, %d iteracoes a mais do que em memoria\n",
+            r.abaixo, r.iteracoes - r.abaixo);
+  double ram = medir_em_memoria(tEsq, tSup, tDir, tInf, bytes, &n_ram);
+  fprintf(stderr, "Fora do nucleo: %.3e celulas/s com %d trab (%.3e por trab); "
+                  "em memoria, N=%d: %.3e celulas/s com %d trab (%.3e por trab)\n",
+          r.celulas_s, r.trab, r.celulas_s / r.trab,
+          n_ram, ram, config.trab, ram / config.trab);
+
+  matrix_copies[0] = matrix_copies[1] = discoMapear(fora_nucleo, N);
+  if (matrix_copies[0] == NULL)
+    die("Nao foi possivel mapear o ficheiro da grelha");
+  return r.iteracoes;
+}
+
+/*--------------------------------------------------------------------
+| Function: timerHandler
+| Description: Handler for SIGALRM. Com --memoria-reduzida a matriz
+|              unica e' actualizada no lugar, pelo que a salvaguarda
+|              fica pedida para a barreira seguinte.
+---------------------------------------------------------------------*/
+void timerHandler() {
+  if (memoria_reduzida)
+    salvaguarda_pedida = 1;
+  else
+    lancar_salvaguarda(iteracoes_feitas(), simulacao != NULL ? heatsimDelta(simulacao) : INFINITY);
+  signal(SIGALRM, timerHandler);
+  alarm(periodoS);
 }
 
 /*--------------------------------------------------------------------
 | Function: handleThis
-| Description: Handler for SIGINT
+| Description: Handler for SIGINT: pede 'as trabalhadoras que parem na
+|              barreira seguinte; a salvaguarda e' escrita depois,
+|              fora do handler
 ---------------------------------------------------------------------*/
 
 void handleThis() {
-  printf("SIGINT caught\n");
-  file = fopen(fichS, "w");
-  if (file == NULL)
-    die("Erro ao abrir ficheiro");
-  dm2dPrintToFile(matrix_copies[atual_global], file, N+2, N+2);
-  fclose(file);
-  kill(main_pid, SIGKILL);
-  exit(0);
+  interrompido = 1;
+  if (simulacao != NULL)
+    heatsimParar(simulacao);
+}
+
+/*--------------------------------------------------------------------
+| Function: ler_opcoes
+| Description: Processa os argumentos opcionais, a partir de argv[ini].
+|              Cada opcao tem a forma --nome [valor].
+---------------------------------------------------------------------*/
+
+void ler_opcoes(int argc, char **argv, int ini) {
+  for (int a = ini; a < argc; a++) {
+    char const *op = argv[a];
+    char const *valor = (a + 1 < argc) ? argv[a + 1] : NULL;
+
+    if (strcmp(op, "--bench") == 0) {
+      modo_bench = 1;
+      continue;
+    }
+    if (strcmp(op, "--autotune") == 0) {
+      autotune = 1;
+      continue;
+    }
+    if (strcmp(op, "--sem-afinacao") == 0) {
+      usar_afinacao = 0;
+      continue;
+    }
+    if (strcmp(op, "--grosseiro") == 0) {
+      grosseiro = 1;
+      continue;
+    }
+    if (strcmp(op, "--direto") == 0) {
+      direto = 1;
+      continue;
+    }
+    if (strcmp(op, "--oraculo") == 0) {
+      oraculo = 1;
+      continue;
+    }
+    if (strcmp(op, "--memoria-reduzida") == 0) {
+      memoria_reduzida = 1;
+      continue;
+    }
+    if (strcmp(op, "--comparar") == 0) {
+      comparar = 1;
+      continue;
+    }
+    if (strcmp(op, "--afinidade") == 0) {
+      config.afinidade = 1;
+      afinidade_definida = 1;
+      continue;
+    }
+    if (valor == NULL) {
+      fprintf(stderr, "\nErro: Opcao %s invalida ou sem valor.\n", op);
+      exit(-1);
+    }
+    if (strcmp(op, "--kernel") == 0) {
+      if (kernelPorNome(valor) == NULL)
+        die("Kernel desconhecido (simples, linhas, blocos)");
+      snprintf(config.kernel, sizeof(config.kernel), "%s", valor);
+      kernel_definido = 1;
+    } else if (strcmp(op, "--barreira") == 0) {
+      if (barreiraPorNome(valor, &config.barreira) != 0)
+        die("Barreira desconhecida (cond, spin)");
+      barreira_definida = 1;
+    } else if (strcmp(op, "--bloco") == 0) {
+      config.bloco = parse_integer_or_exit(valor, "bloco", 1);
+      bloco_definido = 1;
+    } else if (strcmp(op, "--afinacao") == 0) {
+      fich_afinacao = valor;
+    } else if (strcmp(op, "--monitor") == 0) {
+      monitor_caminho = valor;
+    } else if (strcmp(op, "--saida") == 0) {
+      if (saidaModoPorNome(valor, &modo_saida) != 0)
+        die("Modo de saida desconhecido (completa, regiao, amostra, estatisticas)");
+    } else if (strcmp(op, "--regiao") == 0) {
+      if (sscanf(valor, "%d,%d,%d,%d", &regiao[0], &regiao[1], &regiao[2], &regiao[3]) != 4)
+        die("Regiao invalida (l0,c0,l1,c1)");
+      modo_saida = SAIDA_REGIAO;
+    } else if (strcmp(op, "--amostra") == 0) {
+      amostra_tam = parse_integer_or_exit(valor, "amostra", 1);
+      modo_saida = SAIDA_AMOSTRA;
+    } else if (strcmp(op, "--histograma") == 0) {
+      histograma_bins = parse_integer_or_exit(valor, "histograma", 1);
+    } else if (strcmp(op, "--cache-sobreposicao") == 0) {
+      cache_sobreposicao = valor;
+    } else if (strcmp(op, "--acelerar") == 0) {
+      if (aceleracaoPorNome(valor, &aceleracao) != 0)
+        die("Aceleracao desconhecida");
+    } else if (strcmp(op, "--adi") == 0) {
+      adi_dt = parse_double_or_exit(valor, "adi", 0);
+      if (adi_dt <= 0)
+        die("--adi espera um passo de tempo positivo");
+    } else if (strcmp(op, "--tempo") == 0) {
+      adi_tempo = parse_double_or_exit(valor, "tempo", 0);
+    } else if (strcmp(op, "--mensagens") == 0) {
+      mensagens_cap = parse_integer_or_exit(valor, "mensagens", 0);
+    } else if (strcmp(op, "--fora-nucleo") == 0) {
+      fora_nucleo = valor;
+    } else if (strcmp(op, "--memoria") == 0) {
+      memoria_mb = parse_integer_or_exit(valor, "memoria", 1);
+    } else if (strcmp(op, "--arranque-quente") == 0) {
+      arranque_dir = valor;
+    } else if (strcmp(op, "--frames") == 0) {
+      frames_periodo = parse_integer_or_exit(valor, "frames", 1);
+    } else if (strcmp(op, "--frames-ficheiro") == 0) {
+      frames_ficheiro = valor;
+    } else if (strcmp(op, "--frames-reducao") == 0) {
+      frames_reducao = parse_integer_or_exit(valor, "frames-reducao", 1);
+    } else if (strcmp(op, "--frames-buffers") == 0) {
+      frames_buffers = parse_integer_or_exit(valor, "frames-buffers", 1);
+    } else if (strcmp(op, "--shm") == 0) {
+      shm_nome = valor;
+    } else if (strcmp(op, "--shm-periodo") == 0) {
+      shm_periodo = parse_integer_or_exit(valor, "shm-periodo", 1);
+    } else if (strcmp(op, "--shm-slots") == 0) {
+      shm_slots = parse_integer_or_exit(valor, "shm-slots", 2);
+    } else if (strcmp(op, "--reparticao") == 0) {
+      reparticao = parse_integer_or_exit(valor, "reparticao", 1);
+    } else if (strcmp(op, "--prazo") == 0) {
+      prazo = parse_double_or_exit(valor, "prazo", 0);
+    } else if (strcmp(op, "--prazo-reserva") == 0) {
+      prazo_reserva = parse_double_or_exit(valor, "prazo-reserva", 0);
+    } else if (strcmp(op, "--frames-politica") == 0) {
+      if (framesPoliticaPorNome(valor, &frames_politica) != 0)
+        die("Politica de frames desconhecida (descartar, bloquear)");
+    } else {
+      fprintf(stderr, "\nErro: Opcao %s desconhecida.\n", op);
+      exit(-1);
+    }
+    a++;
+  }
 }
 
 /*--------------------------------------------------------------------
@@ -294,14 +804,29 @@ void handleThis() {
 int main (int argc, char** argv) {
 
   double tEsq, tSup, tDir, tInf;
-  int iter, trab;
-  int tam_fatia;
-  int res;
-  int periodoS;
-  main_pid = getpid();
-
-  if (argc != 11) {
-    fprintf(stderr, "Utilizacao: ./heatSim N tEsq tSup tDir tInf iter trab maxD fichS periodoS\n\n");
+  int iter;
+  double t_arranque = tempoAgora();
+
+  if (argc < 11) {
+    fprintf(stderr, "Utilizacao: ./heatSim N tEsq tSup tDir tInf iter trab maxD fichS periodoS [opcoes]\n"
+                    "  trab = 0 usa a afinacao guardada (ou o numero de CPUs)\n"
+                    "  --kernel simples|linhas|blocos  --bloco B  --barreira cond|spin  --afinidade\n"
+                    "  --autotune  --afinacao FICH  --sem-afinacao  --bench\n"
+                    "  --monitor SOCKET\n"
+                    "  --frames M  --frames-ficheiro F  --frames-reducao S  --frames-buffers K\n"
+                    "  --frames-politica descartar|bloquear\n"
+                    "  --shm NOME  --shm-periodo M  --shm-slots K\n"
+                    "  --saida completa|regiao|amostra|estatisticas  --regiao l0,c0,l1,c1\n"
+                    "  --amostra T  --histograma B\n"
+                    "  --cache-sobreposicao DIR\n"
+                    "  --arranque-quente DIR  --grosseiro  --comparar\n"
+                    "  --direto  --oraculo  --acelerar nenhuma|chebyshev|anderson\n"
+                    "  --adi DT  --tempo T\n"
+                    "  --fora-nucleo FICH  --memoria MB  --memoria-reduzida\n"
+                    "      (fora do nucleo, maxD so' e' avaliado no fim de cada passagem:\n"
+                    "       ate' T-1 iteracoes a mais do que em memoria)\n"
+                    "  --mensagens CAP  --reparticao P\n"
+                    "  --prazo SEGUNDOS  --prazo-reserva SEGUNDOS\n\n");
     die("Numero de argumentos invalido");
   }
 
@@ -312,16 +837,65 @@ int main (int argc, char** argv) {
   tDir = parse_double_or_exit (argv[4], "tDir", 0);
   tInf = parse_double_or_exit (argv[5], "tInf", 0);
   iter = parse_integer_or_exit(argv[6], "iter", 1);
-  trab = parse_integer_or_exit(argv[7], "trab", 1);
+  config.trab = parse_integer_or_exit(argv[7], "trab", 0);
   maxD = parse_double_or_exit (argv[8], "maxD", 0);
   fichS = argv[9];
   periodoS = parse_integer_or_exit (argv[10], "periodoS", 0);
+  ler_opcoes(argc, argv, 11);
+
+  if (adi_tempo > 0) {
+    if (adi_dt <= 0)
+      die("--tempo precisa de --adi");
+    iter = (int) ceil(adi_tempo / adi_dt - 1e-9);
+  }
+  if (adi_dt > 0 && aceleracao != ACEL_NENHUMA)
+    die("--adi e --acelerar sao incompativeis");
+  if (memoria_reduzida && (adi_dt > 0 || aceleracao != ACEL_NENHUMA))
+    die("--memoria-reduzida so' se aplica a Jacobi sem aceleracao");
+  if (mensagens_cap >= 0 && (adi_dt > 0 || aceleracao != ACEL_NENHUMA || memoria_reduzida))
+    die("--mensagens so' se aplica a Jacobi sem aceleracao, com duas matrizes");
+  if (reparticao > 0 && (memoria_reduzida || mensagens_cap >= 0))
+    die("--reparticao nao se aplica a --memoria-reduzida nem a --mensagens");
+  if (prazo > 0) {
+    // tempo para escrever a salvaguarda e o resultado, em texto, a
+    // cerca de 5 milhoes de valores por segundo
+    if (prazo_reserva < 0)
+      prazo_reserva = 1 + 2 * (double) (N+2) * (N+2) / 5e6;
+    prazo_instante = t_arranque + prazo - prazo_reserva;
+  }
+
+  retoma.N = N;
+  retoma.t[0] = tEsq;
+  retoma.t[1] = tSup;
+  retoma.t[2] = tDir;
+  retoma.t[3] = tInf;
+  snprintf(fich_estado, sizeof(fich_estado), "%s.estado", fichS);
 
   //fprintf(stderr, "\nArgumentos:\n"
   // " N=d tEsq=%.1f tSup=%.1f tDir=%.1f tInf=%.1f iter=%d trab=%d csz=%d",
   // N, tEsq, tSup, tDir, tInf, iter, trab, csz);
 
-  if (N % trab != 0) {
+  // Escolher parametros: afinacao nova, guardada, ou por omissao
+  if (autotune) {
+    Configuracao afinada = afinar(N, tSup, tInf, tEsq, tDir);
+    aplicar_afinacao(&afinada);
+  } else if (usar_afinacao) {
+    Maquina m;
+    Configuracao afinada;
+    maquinaDetectar(&m, 0);
+    if (afinacaoCarregar(fich_afinacao, m.modelo, afinacaoFaixa(N), &afinada) == 0)
+      aplicar_afinacao(&afinada);
+  }
+  if (config.trab == 0) {
+    // maior divisor de N que nao excede o numero de CPUs
+    config.trab = (int) sysconf(_SC_NPROCESSORS_ONLN);
+    while (config.trab > 1 && N % config.trab != 0)
+      config.trab--;
+    if (config.trab < 1)
+      config.trab = 1;
+  }
+
+  if (N % config.trab != 0) {
     fprintf(stderr, "\nErro: Argumento %s e %s invalidos.\n"
                     "%s deve ser multiplo de %s.", "N", "trab", "N", "trab");
     return -1;
@@ -335,59 +909,226 @@ int main (int argc, char** argv) {
     salvaguarda = 0;
 }
 
-  signal(SIGINT, handleThis);
+  if (fora_nucleo == NULL)
+    inicializar_matrizes(N, tSup, tInf, tEsq, tDir);
+
+  // estatisticas parciais de cada trabalhadora
+  Estatisticas *estat = NULL;
+  if (modo_saida == SAIDA_ESTATISTICAS && !modo_bench) {
+    estat = (Estatisticas*) calloc(config.trab, sizeof(Estatisticas));
+    if (estat == NULL)
+      die("Erro ao alocar memoria para estatisticas");
+    for (int i = 0; i < config.trab; i++) {
+      estat[i].nbins = histograma_bins;
+      estat[i].hist  = (long*) calloc(histograma_bins, sizeof(long));
+      if (estat[i].hist == NULL)
+        die("Erro ao alocar memoria para estatisticas");
+    }
+  }
 
-  // Inicializar Barreira
-  dual_barrier = dualBarrierInit(trab);
-  if (dual_barrier == NULL)
-    die("Nao foi possivel inicializar barreira");
+  double t_inicio = tempoAgora();
+  int iteracoes = 0;
+  int interrompida = 0;
+  int auxiliar = 0;     // parada numa execucao auxiliar, antes da principal
+  double delta_final = INFINITY;
+  EstadoGuardado const *desde = retomado ? &retoma : NULL;
+  double t[4] = { tEsq, tSup, tDir, tInf };
+  int    quente = 0;
+  int    iter_frio = -1;
+  double trabalho = 0, t_frio = 0;
 
-  // Calcular tamanho de cada fatia
-  tam_fatia = N / trab;
+  // o prazo e o SIGINT param tambem as execucoes auxiliares
+  if (fora_nucleo == NULL && !direto)
+    signal(SIGINT, handleThis);
 
-  inicializar_matrizes(N, tSup, tInf, tEsq, tDir);
+  int resolvido = 0;
+  if (fora_nucleo != NULL) {
+    iteracoes = resolver_fora_do_nucleo(tEsq, tSup, tDir, tInf, iter);
+    resolvido = 1;
+  } else if (direto) {
+    if (dstResolver(matrix_copies[0], config.trab) != 0)
+      die("Erro na resolucao directa");
+    resolvido = 1;
+  } else if (cache_sobreposicao != NULL) {
+    resolvido = resolver_por_sobreposicao(tEsq, tSup, tDir, tInf);
+    auxiliar = resolvido < 0;
+  }
 
-  // Reservar memoria para trabalhadoras
-  thread_info *tinfo = (thread_info*) malloc(trab * sizeof(thread_info));
-  pthread_t *trabalhadoras = (pthread_t*) malloc(trab * sizeof(pthread_t));
+  if (resolvido > 0) {
+    // resultado em matrix_copies[iteracoes%2]; as estatisticas fazem-se aqui
+    if (estat != NULL) {
+      estatParcial(matrix_copies[0], 1, N+1, 1, N+1, &estat[0]);
+      estatHistograma(matrix_copies[0], 1, N+1, 1, N+1, estat[0].min, estat[0].max, &estat[0]);
+    }
+  } else if (resolvido == 0) {
+    quente = (arranque_dir != NULL || grosseiro) && access(fichS, F_OK) != 0;
 
-  if (tinfo == NULL || trabalhadoras == NULL) {
-    die("Erro ao alocar memoria para trabalhadoras");
+    if ((quente || aceleracao != ACEL_NENHUMA) && comparar) {
+      // referencia: Jacobi simples a partir do estado inicial
+      TipoAceleracao acel = aceleracao;
+      DoubleMatrix2D *inicial = dm2dNew(N+2, N+2);
+      if (inicial == NULL)
+        die("Erro ao criar matrizes");
+      dm2dCopy(inicial, matrix_copies[0]);
+      aceleracao = ACEL_NENHUMA;
+      double t0 = tempoAgora();
+      iter_frio = executar_trabalhadoras(&config, desde, iter, maxD, NULL);
+      t_frio = tempoAgora() - t0;
+      auxiliar = heatsimInterrompida(simulacao) != 0;
+      aceleracao = acel;
+      dm2dCopy(matrix_copies[0], inicial);
+      dm2dCopy(matrix_copies[1], inicial);
+      dm2dFree(inicial);
+      t_inicio = tempoAgora();
+    }
+    if (quente && !auxiliar) {
+      trabalho = arranque_quente(t);
+      auxiliar = trabalho < 0;
+    }
   }
 
-  // Criar trabalhadoras
-  for (int i=0; i < trab; i++) {
-    tinfo[i].id = i;
-    tinfo[i].iter = iter;
-    tinfo[i].trab = trab;
-    tinfo[i].tam_fatia = tam_fatia;
-    tinfo[i].maxD = maxD;
-    res = pthread_create(&trabalhadoras[i], NULL, tarefa_trabalhadora, &tinfo[i]);
-    if (res != 0) {
-      die("Erro ao criar uma tarefa trabalhadora");
+  if (auxiliar) {
+    // as matrizes estao no estado de partida da execucao principal
+    interrompida = heatsimInterrompida(simulacao);
+    iteracoes    = desde != NULL ? desde->iteracoes : 0;
+    delta_final  = desde != NULL ? desde->delta : INFINITY;
+    if (estat != NULL) {
+      estatParcial(matrix_copies[0], 1, N+1, 1, N+1, &estat[0]);
+      estatHistograma(matrix_copies[0], 1, N+1, 1, N+1, estat[0].min, estat[0].max, &estat[0]);
+    }
+  } else if (resolvido == 0) {
+    if (monitor_caminho != NULL &&
+        monitorIniciar(monitor_caminho, desde != NULL ? desde->iteracoes : 0, iter, maxD,
+                       periodoS) != 0)
+      die("Nao foi possivel criar o socket do monitor");
+    if (frames_periodo > 0 &&
+        framesIniciar(frames_ficheiro, N+2, N+2, frames_periodo, frames_reducao,
+                      frames_buffers, frames_politica, config.trab) != 0)
+      die("Nao foi possivel iniciar a escrita de frames");
+    if (shm_nome != NULL &&
+        partilhaIniciar(shm_nome, matrix_copies[0], shm_periodo, shm_slots, iter, maxD,
+                        config.trab) != 0)
+      die("Nao foi possivel criar o segmento de memoria partilhada");
+
+    signal(SIGALRM, timerHandler);
+    alarm(periodoS);
+
+    iteracoes = executar_trabalhadoras(&config, desde, iter, maxD, estat);
+    interrompida = heatsimInterrompida(simulacao);
+    delta_final = heatsimDelta(simulacao);
+    alarm(0);
+
+    if (adi_dt > 0)
+      fprintf(stderr, "ADI: t=%g apos %d passos de %g\n", iteracoes * adi_dt, iteracoes, adi_dt);
+    if (reparticao > 0)
+      relatar_fatias(tempoAgora() - t_inicio);
+    if (aceleracao != ACEL_NENHUMA && !quente) {
+      if (iter_frio >= 0)
+        fprintf(stderr, "Aceleracao %s: %d iteracoes em %.3f s; Jacobi: %d iteracoes em %.3f s\n",
+                aceleracaoNome(aceleracao), iteracoes, tempoAgora() - t_inicio, iter_frio, t_frio);
+      else
+        fprintf(stderr, "Aceleracao %s: %d iteracoes em %.3f s; Jacobi: cerca de %.0f iteracoes\n",
+                aceleracaoNome(aceleracao), iteracoes, tempoAgora() - t_inicio,
+                arranqueIteracoesFrio(N, t, maxD));
+    }
+
+    if (quente) {
+      double frio = iter_frio >= 0 ? iter_frio : arranqueIteracoesFrio(N, t, maxD);
+      fprintf(stderr, "Arranque: %d iteracoes + %.1f equivalentes nas grelhas grosseiras;"
+                      " a frio %s %.0f iteracoes; poupadas %.0f\n",
+              iteracoes, trabalho, iter_frio >= 0 ? "foram" : "seriam cerca de",
+              frio, frio - iteracoes - trabalho);
+      if (iter_frio >= 0)
+        fprintf(stderr, "Arranque: tempo %.3f s contra %.3f s a frio\n",
+                tempoAgora() - t_inicio, t_frio);
+    }
+    if (arranque_dir != NULL && iteracoes < iter && !interrompida) {
+      SolucaoGuardada s = { N, iteracoes, { tEsq, tSup, tDir, tInf }, maxD };
+      if (arranqueGuardar(arranque_dir, matrix_copies[iteracoes%2], &s) != 0)
+        fprintf(stderr, "Aviso: nao foi possivel guardar a solucao em %s\n", arranque_dir);
     }
   }
+  signal(SIGINT, SIG_DFL);
+  double t_calculo = tempoAgora() - t_inicio;
 
-  signal(SIGALRM, timerHandler);
-  alarm(periodoS);
+  if (interrompida && auxiliar) {
+    // nada avancou na grelha final: a salvaguarda anterior, se existir,
+    // continua valida, e sem ela a proxima execucao repete o arranque
+    fprintf(stderr, "%s: parado numa execucao auxiliar, antes da iteracao %d;"
+                    " nada a salvaguardar\n",
+            interrompida == HEATSIM_PRAZO ? "Prazo" : "Interrompido", iteracoes);
+  } else if (interrompida) {
+    // a salvaguarda periodica em curso escreve os mesmos ficheiros
+    if (printing)
+      waitpid(printer_pid, NULL, 0);
+    if (guardar_estado(iteracoes, delta_final) != 0)
+      die("Erro ao escrever a salvaguarda");
+    fprintf(stderr, "%s: parado na iteracao %d, delta %.3e; retomavel de %s\n",
+            interrompida == HEATSIM_PRAZO ? "Prazo" : "Interrompido", iteracoes,
+            delta_final, fich_estado);
+  }
 
-  // Esperar que as trabalhadoras terminem
-  for (int i=0; i<trab; i++) {
-    res = pthread_join(trabalhadoras[i], NULL);
-    if (res != 0)
-      die("Erro ao esperar por uma tarefa trabalhadora");
+  if (oraculo) {
+    // comparar com a solucao exacta do sistema discreto
+    DoubleMatrix2D *exacta = dm2dNew(N+2, N+2);
+    if (exacta == NULL)
+      die("Erro ao criar matrizes");
+    dm2dCopy(exacta, matrix_copies[iteracoes%2]);
+    if (dstResolver(exacta, config.trab) != 0)
+      die("Erro na resolucao directa");
+    double erro = 0;
+    for (int i = 1; i <= N; i++)
+      for (int j = 1; j <= N; j++) {
+        double d = fabs(dm2dGetEntry(exacta, i, j) - dm2dGetEntry(matrix_copies[iteracoes%2], i, j));
+        erro = d > erro ? d : erro;
+      }
+    fprintf(stderr, "Oraculo: erro maximo %.3e apos %d iteracoes\n", erro, iteracoes);
+    dm2dFree(exacta);
   }
 
-  dm2dPrint (matrix_copies[dual_barrier->iteracoes_concluidas%2]);
+  monitorParar();
+  framesParar();
+  partilhaParar();
+
+  if (modo_bench) {
+    // uma linha por execucao, lida pelo heatBench
+    printf("heatSim: N=%d trab=%d kernel=%s barreira=%s bloco=%d iteracoes=%d tempo=%.9f\n",
+           N, config.trab, config.kernel, barreiraNome(config.barreira), config.bloco,
+           iteracoes, t_calculo);
+  } else if (modo_saida == SAIDA_REGIAO) {
+    saidaRegiao(stdout, matrix_copies[iteracoes%2], regiao[0], regiao[1], regiao[2], regiao[3]);
+  } else if (modo_saida == SAIDA_AMOSTRA) {
+    saidaAmostra(stdout, matrix_copies[iteracoes%2], amostra_tam);
+  } else if (modo_saida == SAIDA_ESTATISTICAS) {
+    Estatisticas total = { 0, 0, 0, 0, histograma_bins, NULL };
+    total.hist = (long*) calloc(histograma_bins, sizeof(long));
+    if (total.hist == NULL)
+      die("Erro ao alocar memoria para estatisticas");
+    for (int i = 0; i < config.trab; i++)
+      estatJuntar(&total, &estat[i]);
+    saidaEstatisticas(stdout, &total);
+    free(total.hist);
+    for (int i = 0; i < config.trab; i++)
+      free(estat[i].hist);
+    free(estat);
+  } else {
+    dm2dPrint (matrix_copies[iteracoes%2]);
+  }
 
   // Libertar memoria
-  dm2dFree(matrix_copies[0]);
-  dm2dFree(matrix_copies[1]);
-  free(tinfo);
-  free(trabalhadoras);
-  dualBarrierFree(dual_barrier);
+  if (fora_nucleo != NULL) {
+    discoDesmapear(matrix_copies[0]);
+  } else {
+    if (matrix_copies[1] != matrix_copies[0])
+      dm2dFree(matrix_copies[1]);
+    dm2dFree(matrix_copies[0]);
+  }
+  heatsimLibertar(simulacao);
 
+  if (interrompida)
+    return interrompida == HEATSIM_PRAZO ? SAIDA_PRAZO : SAIDA_INTERROMPIDA;
   unlink(fichS);
+  unlink(fich_estado);
 
   return 0;
 }
@@ -0,0 +1,309 @@
+/*
+// Projeto SO - exercicio 4, versao 3D
+// Sistemas Operativos, DEI/IST/ULisboa 2017-18
+//
+// Difusao de calor num volume N x N x N com estencil de 7 pontos. As
+// trabalhadoras dividem o volume em fatias de planos z e sincronizam-se
+// com a mesma barreira dupla com max-reduction da versao 2D.
+*/
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+
+#include "matrix3d.h"
+#include "util.h"
+#include "barreira.h"
+#include "kernels3d.h"
+#include "medicao.h"
+#include "afinacao.h"
+#include "saida.h"
+
+/*--------------------------------------------------------------------
+| Type: thread_info
+| Description: Estrutura com Informacao para Trabalhadoras
+---------------------------------------------------------------------*/
+
+typedef struct {
+  int        id;
+  int        iter;
+  int        tam_fatia;
+  double     maxD;
+  Kernel3DFn kernel;
+  int        by;
+  int        bx;
+} thread_info;
+
+/*--------------------------------------------------------------------
+| Global variables
+---------------------------------------------------------------------*/
+
+DoubleMatrix3D     *matrix_copies[2];
+DualBarrierWithMax *dual_barrier;
+int                 N;
+char               *fichS;
+int                 periodoS;
+double              proxima_salvaguarda;
+pid_t               salvaguarda_pid = 0;
+
+/*--------------------------------------------------------------------
+| Opcoes (argumentos opcionais depois de periodoS)
+---------------------------------------------------------------------*/
+
+char const         *nome_kernel = "blocos";
+int                 bloco_y     = 0;
+int                 bloco_x     = 0;
+TipoBarreira        barreira    = BARREIRA_COND;
+int                 modo_bench  = 0;
+ModoSaida           modo_saida  = SAIDA_COMPLETA;
+int                 histograma_bins = 10;
+
+/*--------------------------------------------------------------------
+| Function: tarefa_trabalhadora
+| Description: Funcao executada por cada tarefa trabalhadora, sobre a
+|              sua fatia de planos z
+---------------------------------------------------------------------*/
+
+void *tarefa_trabalhadora(void *args) {
+  thread_info *tinfo = (thread_info *) args;
+  int zini = tinfo->id * tinfo->tam_fatia + 1;
+  int zfim = zini + tinfo->tam_fatia;
+  double global_delta = INFINITY;
+  int iter = 0;
+
+  do {
+    int atual = iter % 2;
+    int prox = 1 - iter % 2;
+    double max_delta = tinfo->kernel(matrix_copies[atual], matrix_copies[prox],
+                                     zini, zfim, N, tinfo->by, tinfo->bx);
+    global_delta = dualBarrierWait(dual_barrier, atual, max_delta);
+  } while (++iter < tinfo->iter && global_delta >= tinfo->maxD);
+
+  return 0;
+}
+
+/*--------------------------------------------------------------------
+| Function: salvaguardar
+| Description: Chamada pela barreira no fim de cada iteracao. Passado
+|              periodoS segundos desde a ultima, cria um processo que
+|              escreve a matriz acabada de calcular: o fork e' feito
+|              com as outras trabalhadoras paradas na barreira, pelo
+|              que o filho ve um estado consistente sem copias.
+---------------------------------------------------------------------*/
+
+void salvaguardar(void *arg, int iteracoes, double delta) {
+  if (periodoS <= 0 || tempoAgora() < proxima_salvaguarda)
+    return;
+  if (salvaguarda_pid > 0) {
+    // a anterior ainda esta' a escrever: tentar na proxima iteracao
+    if (waitpid(salvaguarda_pid, NULL, WNOHANG) == 0)
+      return;
+    salvaguarda_pid = 0;
+  }
+  proxima_salvaguarda = tempoAgora() + periodoS;
+
+  salvaguarda_pid = fork();
+  if (salvaguarda_pid == 0) {
+    char temp[512];
+    snprintf(temp, sizeof(temp), "%s~", fichS);
+    int fd = open(temp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0 || dm3dGuardar(matrix_copies[iteracoes % 2], fd) != 0 || close(fd) != 0)
+      _exit(1);
+    rename(temp, fichS);
+    _exit(0);
+  } else if (salvaguarda_pid < 0) {
+    fprintf(stderr, "Erro ao criar processo paralelo.\n");
+    salvaguarda_pid = 0;
+  }
+}
+
+/*--------------------------------------------------------------------
+| Function: estatisticas_volume
+| Description: Estatisticas dos pontos interiores, plano a plano
+---------------------------------------------------------------------*/
+
+void estatisticas_volume(DoubleMatrix3D *m, Estatisticas *total) {
+  for (int z = 1; z <= N; z++) {
+    DoubleMatrix2D plano = dm3dPlano(m, z);
+    Estatisticas   e = { 0, 0, 0, 0, 0, NULL };
+    estatParcial(&plano, 1, N+1, 1, N+1, &e);
+    estatJuntar(total, &e);
+  }
+  for (int z = 1; z <= N; z++) {
+    DoubleMatrix2D plano = dm3dPlano(m, z);
+    estatHistograma(&plano, 1, N+1, 1, N+1, total->min, total->max, total);
+  }
+}
+
+/*--------------------------------------------------------------------
+| Function: ler_opcoes
+| Description: Processa os argumentos opcionais, a partir de argv[ini]
+---------------------------------------------------------------------*/
+
+void ler_opcoes(int argc, char **argv, int ini) {
+  for (int a = ini; a < argc; a++) {
+    char const *op = argv[a];
+    char const *valor = (a + 1 < argc) ? argv[a + 1] : NULL;
+
+    if (strcmp(op, "--bench") == 0) {
+      modo_bench = 1;
+      continue;
+    }
+    if (valor == NULL) {
+      fprintf(stderr, "\nErro: opcao %s desconhecida ou sem valor.\n", op);
+      exit(-1);
+    }
+    if (strcmp(op, "--kernel") == 0) {
+      if (kernel3dPorNome(valor) == NULL)
+        die("Kernel desconhecido");
+      nome_kernel = valor;
+    } else if (strcmp(op, "--bloco") == 0) {
+      if (sscanf(valor, "%d,%d", &bloco_y, &bloco_x) != 2 || bloco_y < 1 || bloco_x < 1)
+        die("--bloco espera BY,BX");
+    } else if (strcmp(op, "--barreira") == 0) {
+      if (barreiraPorNome(valor, &barreira) != 0)
+        die("Barreira desconhecida");
+    } else if (strcmp(op, "--saida") == 0) {
+      if (saidaModoPorNome(valor, &modo_saida) != 0 ||
+          (modo_saida != SAIDA_COMPLETA && modo_saida != SAIDA_ESTATISTICAS))
+        die("Modo de saida invalido (completa|estatisticas)");
+    } else if (strcmp(op, "--histograma") == 0) {
+      histograma_bins = parse_integer_or_exit(valor, "histograma", 1);
+    } else {
+      fprintf(stderr, "\nErro: opcao %s desconhecida.\n", op);
+      exit(-1);
+    }
+    a++;
+  }
+}
+
+/*--------------------------------------------------------------------
+| Function: main
+---------------------------------------------------------------------*/
+
+int main (int argc, char** argv) {
+  double tEsq, tSup, tDir, tInf, tFrente, tTras;
+  int iter, trab;
+  double maxD;
+
+  if (argc < 13) {
+    fprintf(stderr, "Utilizacao: ./heatSim3d N tEsq tSup tDir tInf tFrente tTras iter trab maxD "
+                    "fichS periodoS [opcoes]\n"
+                    "  --kernel linhas|blocos  --bloco BY,BX  --barreira cond|spin  --bench\n"
+                    "  --saida completa|estatisticas  --histograma B\n\n");
+    die("Numero de argumentos invalido");
+  }
+
+  // as quatro primeiras pela ordem do heatSim
+  N       = parse_integer_or_exit(argv[1], "N", 1);
+  tEsq    = parse_double_or_exit (argv[2], "tEsq", 0);
+  tSup    = parse_double_or_exit (argv[3], "tSup", 0);
+  tDir    = parse_double_or_exit (argv[4], "tDir", 0);
+  tInf    = parse_double_or_exit (argv[5], "tInf", 0);
+  tFrente = parse_double_or_exit (argv[6], "tFrente", 0);
+  tTras   = parse_double_or_exit (argv[7], "tTras", 0);
+  iter     = parse_integer_or_exit(argv[8], "iter", 1);
+  trab     = parse_integer_or_exit(argv[9], "trab", 1);
+  maxD     = parse_double_or_exit (argv[10], "maxD", 0);
+  fichS    = argv[11];
+  periodoS = parse_integer_or_exit(argv[12], "periodoS", 0);
+  ler_opcoes(argc, argv, 13);
+
+  if (N % trab != 0) {
+    fprintf(stderr, "\nErro: Argumento %s e %s invalidos.\n"
+                    "%s deve ser multiplo de %s.", "N", "trab", "N", "trab");
+    return -1;
+  }
+
+  if (bloco_y == 0) {
+    // quatro planos de blocos de linhas inteiras (tres de entrada e o
+    // de saida) devem caber em metade da cache L2
+    Maquina m;
+    maquinaDetectar(&m, 0);
+    bloco_x = N;
+    bloco_y = (int) (m.cache_l2 / 2 / (4 * (long) (N + 2) * sizeof(double)));
+    bloco_y = bloco_y < 1 ? 1 : bloco_y > N ? N : bloco_y;
+  }
+
+  // Inicializar: da salvaguarda, se existir, ou com as faces
+  matrix_copies[0] = dm3dCarregar(fichS, N+2, N+2, N+2);
+  if (matrix_copies[0] == NULL) {
+    matrix_copies[0] = dm3dNew(N+2, N+2, N+2);
+    if (matrix_copies[0] == NULL)
+      die("Erro ao criar matrizes");
+    dm3dSetFaceTo(matrix_copies[0], DM3D_EIXO_C, 0,   tEsq);
+    dm3dSetFaceTo(matrix_copies[0], DM3D_EIXO_C, N+1, tDir);
+    dm3dSetFaceTo(matrix_copies[0], DM3D_EIXO_L, 0,   tSup);
+    dm3dSetFaceTo(matrix_copies[0], DM3D_EIXO_L, N+1, tInf);
+    dm3dSetFaceTo(matrix_copies[0], DM3D_EIXO_Z, 0,   tFrente);
+    dm3dSetFaceTo(matrix_copies[0], DM3D_EIXO_Z, N+1, tTras);
+  }
+  matrix_copies[1] = dm3dNew(N+2, N+2, N+2);
+  if (matrix_copies[1] == NULL)
+    die("Erro ao criar matrizes");
+  dm3dCopy(matrix_copies[1], matrix_copies[0]);
+
+  dual_barrier = dualBarrierInit(trab, barreira);
+  if (dual_barrier == NULL)
+    die("Nao foi possivel inicializar barreira");
+  dualBarrierSetHook(dual_barrier, salvaguardar, NULL);
+  proxima_salvaguarda = tempoAgora() + periodoS;
+
+  thread_info *tinfo = (thread_info*) malloc(trab * sizeof(thread_info));
+  pthread_t *trabalhadoras = (pthread_t*) malloc(trab * sizeof(pthread_t));
+  if (tinfo == NULL || trabalhadoras == NULL)
+    die("Erro ao alocar memoria para trabalhadoras");
+
+  double t_inicio = tempoAgora();
+  for (int i = 0; i < trab; i++) {
+    tinfo[i].id        = i;
+    tinfo[i].iter      = iter;
+    tinfo[i].tam_fatia = N / trab;
+    tinfo[i].maxD      = maxD;
+    tinfo[i].kernel    = kernel3dPorNome(nome_kernel);
+    tinfo[i].by        = bloco_y;
+    tinfo[i].bx        = bloco_x;
+    if (pthread_create(&trabalhadoras[i], NULL, tarefa_trabalhadora, &tinfo[i]) != 0)
+      die("Erro ao criar uma tarefa trabalhadora");
+  }
+  for (int i = 0; i < trab; i++)
+    if (pthread_join(trabalhadoras[i], NULL) != 0)
+      die("Erro ao esperar por uma tarefa trabalhadora");
+  double t_calculo = tempoAgora() - t_inicio;
+
+  int iteracoes = dual_barrier->iteracoes_concluidas;
+  if (salvaguarda_pid > 0)
+    waitpid(salvaguarda_pid, NULL, 0);
+
+  if (modo_bench) {
+    printf("heatSim3d: N=%d trab=%d kernel=%s barreira=%s bloco=%d,%d iteracoes=%d tempo=%.9f "
+           "gbs=%.3f\n", N, trab, nome_kernel, barreiraNome(barreira), bloco_y, bloco_x,
+           iteracoes, t_calculo, bytesPorIteracao3D(N) * iteracoes / t_calculo / 1e9);
+  } else if (modo_saida == SAIDA_ESTATISTICAS) {
+    Estatisticas total = { 0, 0, 0, 0, histograma_bins, NULL };
+    total.hist = (long*) calloc(histograma_bins, sizeof(long));
+    if (total.hist == NULL)
+      die("Erro ao alocar memoria para estatisticas");
+    estatisticas_volume(matrix_copies[iteracoes % 2], &total);
+    saidaEstatisticas(stdout, &total);
+    free(total.hist);
+  } else {
+    dm3dPrint(matrix_copies[iteracoes % 2]);
+  }
+
+  dm3dFree(matrix_copies[0]);
+  dm3dFree(matrix_copies[1]);
+  dualBarrierFree(dual_barrier);
+  free(tinfo);
+  free(trabalhadoras);
+
+  unlink(fichS);
+  return 0;
+}
@@ -13,8 +13,7 @@
 | Function: dm2dNew
 ---------------------------------------------------------------------*/
 
-DoubleMatrix2D* dm2dNew(int lines, int columns) {
-  int i, j;
+DoubleMatrix2D* dm2dNew(long lines, long columns) {
   DoubleMatrix2D* matrix = malloc(sizeof(DoubleMatrix2D));
 
   if (matrix == NULL)
@@ -22,16 +21,13 @@ DoubleMatrix2D* dm2dNew(int lines, int columns) {
 
   matrix->n_l = lines;
   matrix->n_c = columns;
-  matrix->data = (double*) malloc(sizeof(double)*lines*columns);
+  // calloc verifica o produto e devolve memoria ja' a zero
+  matrix->data = (double*) calloc((size_t) lines * columns, sizeof(double));
   if (matrix->data == NULL) {
     free (matrix);
     return NULL;
   }
 
-  for (i=0; i<lines; i++)
-    for (j=0; j<columns; j++)
-      dm2dSetEntry(matrix, i, j, 0);
-
   return matrix;
 }
 
@@ -48,7 +44,7 @@ void dm2dFree (DoubleMatrix2D *matrix) {
 | Function: dm2dGetLine
 ---------------------------------------------------------------------*/
 
-double* dm2dGetLine (DoubleMatrix2D *matrix, int line_nb) {
+double* dm2dGetLine (DoubleMatrix2D *matrix, long line_nb) {
   return &(matrix->data[line_nb*matrix->n_c]);
 }
 
@@ -56,7 +52,7 @@ double* dm2dGetLine (DoubleMatrix2D *matrix, int line_nb) {
 | Function: dm2dSetLine
 ---------------------------------------------------------------------*/
 
-void dm2dSetLine (DoubleMatrix2D *matrix, int line_nb, double* line_values) {
+void dm2dSetLine (DoubleMatrix2D *matrix, long line_nb, double* line_values) {
     memcpy ((char*) &(matrix->data[line_nb*matrix->n_c]), line_values, matrix->n_c*sizeof(double));
 }
 
@@ -64,8 +60,8 @@ void dm2dSetLine (DoubleMatrix2D *matrix, int line_nb, double* line_values) {
 | Function: dm2dSetLineTo
 ---------------------------------------------------------------------*/
 
-void dm2dSetLineTo (DoubleMatrix2D *matrix, int line, double value) {
-  int i;
+void dm2dSetLineTo (DoubleMatrix2D *matrix, long line, double value) {
+  long i;
 
   for (i=0; i<matrix->n_c; i++)
     dm2dSetEntry(matrix, line, i, value);
@@ -76,8 +72,8 @@ void dm2dSetLineTo (DoubleMatrix2D *matrix, int line, double value) {
 | Function: dm2dSetColumnTo
 ---------------------------------------------------------------------*/
 
-void dm2dSetColumnTo (DoubleMatrix2D *matrix, int column, double value) {
-  int i;
+void dm2dSetColumnTo (DoubleMatrix2D *matrix, long column, double value) {
+  long i;
 
   for (i=0; i<matrix->n_l; i++)
     dm2dSetEntry(matrix, i, column, value);
@@ -88,7 +84,9 @@ void dm2dSetColumnTo (DoubleMatrix2D *matrix, int column, double value) {
 ---------------------------------------------------------------------*/
 
 void dm2dCopy (DoubleMatrix2D *to, DoubleMatrix2D *from) {
-  memcpy (to->data, from->data, sizeof(double)*to->n_l*to->n_c);
+  if (to == from)
+    return;
+  memcpy (to->data, from->data, sizeof(double)*(size_t)to->n_l*to->n_c);
 }
 
 
@@ -97,7 +95,7 @@ void dm2dCopy (DoubleMatrix2D *to, DoubleMatrix2D *from) {
 ---------------------------------------------------------------------*/
 
 void dm2dPrint (DoubleMatrix2D *matrix) {
-  int i, j;
+  long i, j;
 
   printf ("\n");
   for (i=0; i<matrix->n_l; i++) {
@@ -111,8 +109,8 @@ void dm2dPrint (DoubleMatrix2D *matrix) {
 /*--------------------------------------------------------------------
 | Function: readMatrix2dFromFile
 ---------------------------------------------------------------------*/
-DoubleMatrix2D *readMatrix2dFromFile(FILE *f, int l, int c) {
-  int i, j;
+DoubleMatrix2D *readMatrix2dFromFile(FILE *f, long l, long c) {
+  long i, j;
   double v;
   DoubleMatrix2D *m;
 
@@ -142,8 +140,8 @@ DoubleMatrix2D *readMatrix2dFromFile(FILE *f, int l, int c) {
 /*--------------------------------------------------------------------
 | Function: dm2dPrintToFile
 ---------------------------------------------------------------------*/
-void dm2dPrintToFile(DoubleMatrix2D *m, FILE *fp, int l, int c) {
-  int i, j;
+void dm2dPrintToFile(DoubleMatrix2D *m, FILE *fp, long l, long c) {
+  long i, j;
 
   if (m == NULL || fp == NULL || l<1 || c<1)
     return;
@@ -8,24 +8,26 @@
 
 #include <stdio.h>
 
+// Dimensoes e indices sao de 64 bits: com N > 46340 o numero de
+// pontos, (N+2)^2, ja' nao cabe num int.
 typedef struct int_matrix_2d {
-  int     n_l;
-  int     n_c;
+  long    n_l;
+  long    n_c;
   double *data;
 } DoubleMatrix2D;
 
-DoubleMatrix2D* dm2dNew(int lines, int columns);
+DoubleMatrix2D* dm2dNew(long lines, long columns);
 void            dm2dFree (DoubleMatrix2D *matrix);
-double*         dm2dGetLine (DoubleMatrix2D *matrix, int line_nb);
-void            dm2dSetLine (DoubleMatrix2D *matrix, int line_nb, double* line_values);
-void            dm2dSetLineTo (DoubleMatrix2D *matrix, int line, double value);
-void            dm2dSetColumnTo (DoubleMatrix2D *matrix, int column, double value);
+double*         dm2dGetLine (DoubleMatrix2D *matrix, long line_nb);
+void            dm2dSetLine (DoubleMatrix2D *matrix, long line_nb, double* line_values);
+void            dm2dSetLineTo (DoubleMatrix2D *matrix, long line, double value);
+void            dm2dSetColumnTo (DoubleMatrix2D *matrix, long column, double value);
 void            dm2dPrint (DoubleMatrix2D *matrix);
 void            dm2dCopy (DoubleMatrix2D *to, DoubleMatrix2D *from);
-DoubleMatrix2D *readMatrix2dFromFile(FILE *f, int l, int c);
-void            dm2dPrintToFile(DoubleMatrix2D *m, FILE *fp, int l, int c);
+DoubleMatrix2D *readMatrix2dFromFile(FILE *f, long l, long c);
+void            dm2dPrintToFile(DoubleMatrix2D *m, FILE *fp, long l, long c);
 
-#define         dm2dGetEntry(m,l,c)    m->data[((l)*m->n_c)+(c)]
-#define         dm2dSetEntry(m,l,c,v)  m->data[((l)*m->n_c)+(c)]=v
+#define         dm2dGetEntry(m,l,c)    m->data[((long)(l)*m->n_c)+(c)]
+#define         dm2dSetEntry(m,l,c,v)  m->data[((long)(l)*m->n_c)+(c)]=v
 
 #endif
@@ -0,0 +1,146 @@
+/*
+// Biblioteca de matrizes 3D alocadas dinamicamente
+// Sistemas Operativos, DEI/IST/ULisboa 2017-18
+*/
+
+#include "matrix3d.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+/*--------------------------------------------------------------------
+| Function: dm3dNew
+---------------------------------------------------------------------*/
+
+DoubleMatrix3D *dm3dNew(int planes, int lines, int columns) {
+  DoubleMatrix3D *matrix = malloc(sizeof(DoubleMatrix3D));
+
+  if (matrix == NULL)
+    return NULL;
+
+  matrix->n_z = planes;
+  matrix->n_l = lines;
+  matrix->n_c = columns;
+  matrix->data = (double*) calloc((size_t) planes * lines * columns, sizeof(double));
+  if (matrix->data == NULL) {
+    free (matrix);
+    return NULL;
+  }
+  return matrix;
+}
+
+/*--------------------------------------------------------------------
+| Function: dm3dFree
+---------------------------------------------------------------------*/
+
+void dm3dFree (DoubleMatrix3D *matrix) {
+  free (matrix->data);
+  free (matrix);
+}
+
+/*--------------------------------------------------------------------
+| Function: dm3dGetLine
+---------------------------------------------------------------------*/
+
+double *dm3dGetLine (DoubleMatrix3D *matrix, int plane, int line) {
+  return &(matrix->data[dm3dIndice(matrix, plane, line, 0)]);
+}
+
+/*--------------------------------------------------------------------
+| Function: dm3dPlano
+| Description: Vista 2D (sem copia) do plano 'plane'
+---------------------------------------------------------------------*/
+
+DoubleMatrix2D dm3dPlano (DoubleMatrix3D *matrix, int plane) {
+  DoubleMatrix2D p = { matrix->n_l, matrix->n_c, dm3dGetLine(matrix, plane, 0) };
+  return p;
+}
+
+/*--------------------------------------------------------------------
+| Function: dm3dSetFaceTo
+| Description: Poe a 'value' todos os pontos com a coordenada do 'eixo'
+|              igual a 'indice'
+---------------------------------------------------------------------*/
+
+void dm3dSetFaceTo (DoubleMatrix3D *matrix, int eixo, int indice, double value) {
+  for (int z = 0; z < matrix->n_z; z++)
+    for (int l = 0; l < matrix->n_l; l++)
+      for (int c = 0; c < matrix->n_c; c++)
+        if ((eixo == DM3D_EIXO_Z && z == indice) ||
+            (eixo == DM3D_EIXO_L && l == indice) ||
+            (eixo == DM3D_EIXO_C && c == indice))
+          dm3dSetEntry(matrix, z, l, c, value);
+}
+
+/*--------------------------------------------------------------------
+| Function: dm3dCopy
+---------------------------------------------------------------------*/
+
+void dm3dCopy (DoubleMatrix3D *to, DoubleMatrix3D *from) {
+  memcpy (to->data, from->data, sizeof(double) * (size_t) to->n_z * to->n_l * to->n_c);
+}
+
+/*--------------------------------------------------------------------
+| Function: dm3dPrint
+| Description: Imprime os planos z, separados por uma linha em branco
+---------------------------------------------------------------------*/
+
+void dm3dPrint (DoubleMatrix3D *matrix) {
+  for (int z = 0; z < matrix->n_z; z++) {
+    DoubleMatrix2D plano = dm3dPlano(matrix, z);
+    dm2dPrint(&plano);
+  }
+}
+
+/*--------------------------------------------------------------------
+| Function: dm3dGuardar
+---------------------------------------------------------------------*/
+
+int dm3dGuardar (DoubleMatrix3D *matrix, int fd) {
+  int32_t cab[4] = { 0, matrix->n_z, matrix->n_l, matrix->n_c };
+  char   *p      = (char*) matrix->data;
+  size_t  falta  = sizeof(double) * (size_t) matrix->n_z * matrix->n_l * matrix->n_c;
+
+  memcpy(cab, "HS3D", 4);
+  if (write(fd, cab, sizeof(cab)) != sizeof(cab))
+    return -1;
+  while (falta > 0) {
+    ssize_t n = write(fd, p, falta);
+    if (n <= 0)
+      return -1;
+    p     += n;
+    falta -= n;
+  }
+  return 0;
+}
+
+/*--------------------------------------------------------------------
+| Function: dm3dCarregar
+---------------------------------------------------------------------*/
+
+DoubleMatrix3D *dm3dCarregar (char const *fich, int planes, int lines, int columns) {
+  int32_t         cab[4];
+  DoubleMatrix3D *m;
+  FILE           *f = fopen(fich, "rb");
+
+  if (f == NULL)
+    return NULL;
+  if (fread(cab, sizeof(cab), 1, f) != 1 || memcmp(cab, "HS3D", 4) != 0 ||
+      cab[1] != planes || cab[2] != lines || cab[3] != columns) {
+    fclose(f);
+    return NULL;
+  }
+  m = dm3dNew(planes, lines, columns);
+  if (m != NULL &&
+      fread(m->data, sizeof(double), (size_t) planes * lines * columns, f) !=
+      (size_t) planes * lines * columns) {
+    dm3dFree(m);
+    m = NULL;
+  }
+  fclose(f);
+  return m;
+}
@@ -0,0 +1,49 @@
+/*
+// Biblioteca de matrizes 3D alocadas dinamicamente
+// Sistemas Operativos, DEI/IST/ULisboa 2017-18
+//
+// Os dados estao guardados por planos z, cada um com n_l linhas de n_c
+// colunas, pelo que um plano tem a mesma disposicao que uma
+// DoubleMatrix2D e pode ser visto como tal com dm3dPlano.
+*/
+
+#ifndef MATRIX_3D_H
+#define MATRIX_3D_H
+
+#include "matrix2d.h"
+
+typedef struct double_matrix_3d {
+  int     n_z;
+  int     n_l;
+  int     n_c;
+  double *data;
+} DoubleMatrix3D;
+
+DoubleMatrix3D *dm3dNew (int planes, int lines, int columns);
+void            dm3dFree (DoubleMatrix3D *matrix);
+double         *dm3dGetLine (DoubleMatrix3D *matrix, int plane, int line);
+DoubleMatrix2D  dm3dPlano (DoubleMatrix3D *matrix, int plane);
+void            dm3dSetFaceTo (DoubleMatrix3D *matrix, int eixo, int indice, double value);
+void            dm3dCopy (DoubleMatrix3D *to, DoubleMatrix3D *from);
+void            dm3dPrint (DoubleMatrix3D *matrix);
+
+/*--------------------------------------------------------------------
+| Function: dm3dGuardar / dm3dCarregar
+| Description: Salvaguarda binaria: "HS3D", int32 n_z, n_l, n_c e os
+|              dados. dm3dGuardar escreve num descritor ja' aberto e
+|              devolve 0 em caso de sucesso; dm3dCarregar devolve NULL
+|              se o ficheiro nao existir ou nao tiver as dimensoes
+|              pedidas.
+---------------------------------------------------------------------*/
+int             dm3dGuardar (DoubleMatrix3D *matrix, int fd);
+DoubleMatrix3D *dm3dCarregar (char const *fich, int planes, int lines, int columns);
+
+#define         DM3D_EIXO_Z 0
+#define         DM3D_EIXO_L 1
+#define         DM3D_EIXO_C 2
+
+#define         dm3dIndice(m,z,l,c)      ((((long)(z)*m->n_l)+(l))*m->n_c+(c))
+#define         dm3dGetEntry(m,z,l,c)    m->data[dm3dIndice(m,z,l,c)]
+#define         dm3dSetEntry(m,z,l,c,v)  m->data[dm3dIndice(m,z,l,c)]=v
+
+#endif
@@ -0,0 +1,74 @@
+/*
+// Medicao de tempos e largura de banda
+// Sistemas Operativos, DEI/IST/ULisboa 2017-18
+*/
+
+#include "medicao.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/*--------------------------------------------------------------------
+| Function: tempoAgora
+---------------------------------------------------------------------*/
+
+double tempoAgora(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/*--------------------------------------------------------------------
+| Function: medirLarguraBandaCopia
+---------------------------------------------------------------------*/
+
+double medirLarguraBandaCopia(size_t bytes, int repeticoes) {
+  size_t n = bytes / sizeof(double);
+  double *a = (double*) malloc(n * sizeof(double));
+  double *b = (double*) malloc(n * sizeof(double));
+  double melhor = 0;
+
+  if (a == NULL || b == NULL) {
+    free(a);
+    free(b);
+    return 0;
+  }
+
+  // tocar em todas as paginas antes de medir
+  for (size_t i = 0; i < n; i++) {
+    a[i] = 1.0;
+    b[i] = 0.0;
+  }
+
+  for (int r = 0; r < repeticoes; r++) {
+    double t0 = tempoAgora();
+    for (size_t i = 0; i < n; i++)
+      b[i] = a[i];
+    double t = tempoAgora() - t0;
+    // impedir que o compilador elimine a copia
+    a[r % n] += b[(r * 7) % n];
+    if (t > 0 && 2.0 * n * sizeof(double) / t / 1e9 > melhor)
+      melhor = 2.0 * n * sizeof(double) / t / 1e9;
+  }
+
+  free(a);
+  free(b);
+  return melhor;
+}
+
+/*--------------------------------------------------------------------
+| Function: bytesPorIteracao
+---------------------------------------------------------------------*/
+
+double bytesPorIteracao(int N) {
+  return 2.0 * sizeof(double) * (double) N * (double) N;
+}
+
+/*--------------------------------------------------------------------
+| Function: bytesPorIteracao3D
+---------------------------------------------------------------------*/
+
+double bytesPorIteracao3D(int N) {
+  return bytesPorIteracao(N) * (double) N;
+}
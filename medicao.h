@@ -0,0 +1,40 @@
+/*
+// Medicao de tempos e largura de banda
+// Sistemas Operativos, DEI/IST/ULisboa 2017-18
+*/
+
+#ifndef MEDICAO_H
+#define MEDICAO_H
+
+#include <stddef.h>
+
+/*--------------------------------------------------------------------
+| Function: tempoAgora
+| Description: Devolve o tempo monotonico actual em segundos
+---------------------------------------------------------------------*/
+double tempoAgora(void);
+
+/*--------------------------------------------------------------------
+| Function: medirLarguraBandaCopia
+| Description: Mede a largura de banda de memoria (GB/s) com um kernel
+|              de copia ao estilo STREAM sobre dois vectores de 'bytes'
+|              bytes cada. Devolve o melhor de 'repeticoes' medicoes,
+|              ou 0 se nao conseguir alocar memoria.
+---------------------------------------------------------------------*/
+double medirLarguraBandaCopia(size_t bytes, int repeticoes);
+
+/*--------------------------------------------------------------------
+| Function: bytesPorIteracao
+| Description: Trafego minimo de memoria de uma iteracao de Jacobi
+|              sobre N x N pontos interiores: ler a matriz actual e
+|              escrever a seguinte.
+---------------------------------------------------------------------*/
+double bytesPorIteracao(int N);
+
+/*--------------------------------------------------------------------
+| Function: bytesPorIteracao3D
+| Description: O mesmo para N x N x N pontos interiores
+---------------------------------------------------------------------*/
+double bytesPorIteracao3D(int N);
+
+#endif
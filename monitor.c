@@ -0,0 +1,269 @@
+/*
+// Monitor do progresso por socket Unix
+// Sistemas Operativos, DEI/IST/ULisboa 2017-18
+//
+// Protocolo: o cliente liga-se, envia uma linha com o comando
+// ("estado" ou vazia) e recebe linhas chave=valor ate' o servidor
+// fechar a ligacao, p.ex.
+//   echo estado | socat - UNIX-CONNECT:/tmp/heatSim.sock
+*/
+
+#include "monitor.h"
+#include "medicao.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+#include <pthread.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+// intervalo entre amostras usadas para a taxa de convergencia
+#define AMOSTRA_SEGUNDOS 0.5
+
+/*--------------------------------------------------------------------
+| Global variables
+| As variaveis publicadas sao escritas so' com operacoes atomicas, pela
+| tarefa que fecha cada iteracao, e lidas pela tarefa do monitor.
+---------------------------------------------------------------------*/
+
+static int          iteracao_publicada = 0;
+static double       delta_publicado    = INFINITY;
+static int          salvaguardas       = 0;
+static double       ultima_salvaguarda = 0;
+
+static char         caminho_socket[108];
+static int          fd_servidor = -1;
+static int          parar       = 0;
+static pthread_t    tarefa_monitor;
+
+static int          monitor_base;      // iteracoes feitas antes do arranque
+static int          monitor_iter_max;
+static double       monitor_maxD;
+static int          monitor_periodoS;
+static double       t_inicio;
+
+// amostra anterior, para a taxa de convergencia (so' a tarefa do monitor)
+static int          amostra_iter;
+static double       amostra_delta;
+static double       amostra_t;
+static double       taxa_conv = 0;  // factor de reducao do delta por iteracao
+
+/*--------------------------------------------------------------------
+| Function: monitorPublicar
+---------------------------------------------------------------------*/
+
+void monitorPublicar(int iteracao, double delta) {
+  __atomic_store(&delta_publicado, &delta, __ATOMIC_RELAXED);
+  __atomic_store_n(&iteracao_publicada, iteracao, __ATOMIC_RELEASE);
+}
+
+/*--------------------------------------------------------------------
+| Function: monitorSalvaguarda
+---------------------------------------------------------------------*/
+
+void monitorSalvaguarda(void) {
+  double agora = tempoAgora();
+  __atomic_store(&ultima_salvaguarda, &agora, __ATOMIC_RELAXED);
+  __atomic_add_fetch(&salvaguardas, 1, __ATOMIC_RELEASE);
+}
+
+/*--------------------------------------------------------------------
+| Function: amostrar
+| Description: Actualiza a estimativa do factor de reducao do delta
+|              por iteracao, assumindo convergencia geometrica
+---------------------------------------------------------------------*/
+
+static void amostrar(void) {
+  double agora = tempoAgora();
+  int    it    = __atomic_load_n(&iteracao_publicada, __ATOMIC_ACQUIRE);
+  double d;
+
+  __atomic_load(&delta_publicado, &d, __ATOMIC_RELAXED);
+  if (agora - amostra_t < AMOSTRA_SEGUNDOS)
+    return;
+  if (it > amostra_iter && amostra_delta > 0 && d > 0 && isfinite(amostra_delta))
+    taxa_conv = pow(d / amostra_delta, 1.0 / (it - amostra_iter));
+  amostra_iter  = it;
+  amostra_delta = d;
+  amostra_t     = agora;
+}
+
+/*--------------------------------------------------------------------
+| Function: enviar
+| Description: Envia n bytes ao cliente. Com MSG_NOSIGNAL, um cliente
+|              que ja' fechou a ligacao da' EPIPE em vez de SIGPIPE, que
+|              terminaria o processo; o cliente e' simplesmente largado.
+---------------------------------------------------------------------*/
+
+static void enviar(int fd, char const *buf, int n) {
+  for (int escrito = 0; escrito < n; ) {
+    ssize_t r = send(fd, buf + escrito, n - escrito, MSG_NOSIGNAL);
+    if (r < 0 && errno == EINTR)
+      continue;
+    if (r <= 0)
+      return;
+    escrito += r;
+  }
+}
+
+/*--------------------------------------------------------------------
+| Function: responder
+| Description: Escreve o estado actual no descritor do cliente
+---------------------------------------------------------------------*/
+
+static void responder(int fd) {
+  char   resp[1024];
+  double agora = tempoAgora();
+  int    it    = __atomic_load_n(&iteracao_publicada, __ATOMIC_ACQUIRE);
+  int    nsalv = __atomic_load_n(&salvaguardas, __ATOMIC_ACQUIRE);
+  double d, t_salv;
+
+  __atomic_load(&delta_publicado, &d, __ATOMIC_RELAXED);
+  __atomic_load(&ultima_salvaguarda, &t_salv, __ATOMIC_RELAXED);
+
+  double ips = agora > t_inicio ? (it - monitor_base) / (agora - t_inicio) : 0;
+
+  // iteracoes restantes: ate' iter_max, ou ate' delta < maxD se a
+  // convergencia geometrica observada la' chegar antes
+  double restantes = monitor_iter_max - it;
+  if (taxa_conv > 0 && taxa_conv < 1 && d > monitor_maxD && monitor_maxD > 0) {
+    double ate_maxD = log(monitor_maxD / d) / log(taxa_conv);
+    if (ate_maxD < restantes)
+      restantes = ate_maxD;
+  } else if (d < monitor_maxD) {
+    restantes = 0;
+  }
+
+  int n = snprintf(resp, sizeof(resp),
+                   "iteracao=%d\n"
+                   "iter_max=%d\n"
+                   "delta=%.6e\n"
+                   "maxD=%.6e\n"
+                   "tempo_decorrido=%.3f\n"
+                   "iter_por_segundo=%.3f\n",
+                   it, monitor_iter_max, d, monitor_maxD, agora - t_inicio, ips);
+  if (ips > 0)
+    n += snprintf(resp + n, sizeof(resp) - n, "eta_segundos=%.3f\neta_iteracoes=%.0f\n",
+                  restantes / ips, restantes);
+  else
+    n += snprintf(resp + n, sizeof(resp) - n, "eta_segundos=desconhecido\n");
+  n += snprintf(resp + n, sizeof(resp) - n,
+                "salvaguarda=%s\nperiodo_salvaguarda=%d\nsalvaguardas=%d\n",
+                monitor_periodoS > 0 ? "activa" : "inactiva", monitor_periodoS, nsalv);
+  if (nsalv > 0)
+    n += snprintf(resp + n, sizeof(resp) - n, "ultima_salvaguarda_ha=%.3f\n", agora - t_salv);
+
+  enviar(fd, resp, n);
+}
+
+/*--------------------------------------------------------------------
+| Function: servir
+| Description: Ciclo da tarefa do monitor
+---------------------------------------------------------------------*/
+
+static void *servir(void *arg) {
+  while (!__atomic_load_n(&parar, __ATOMIC_ACQUIRE)) {
+    struct pollfd p = { fd_servidor, POLLIN, 0 };
+
+    amostrar();
+    if (poll(&p, 1, 200) <= 0)
+      continue;
+
+    int cliente = accept(fd_servidor, NULL, NULL);
+    if (cliente < 0)
+      continue;
+
+    // ler o comando, sem esperar indefinidamente por clientes lentos
+    char cmd[64] = "";
+    struct pollfd pc = { cliente, POLLIN, 0 };
+    if (poll(&pc, 1, 100) > 0) {
+      ssize_t r = read(cliente, cmd, sizeof(cmd) - 1);
+      cmd[r > 0 ? r : 0] = 0;
+    }
+    cmd[strcspn(cmd, "\r\n")] = 0;
+
+    if (cmd[0] == 0 || strcmp(cmd, "estado") == 0)
+      responder(cliente);
+    else {
+      char const *erro = "erro=comando desconhecido (use: estado)\n";
+      enviar(cliente, erro, strlen(erro));
+    }
+    close(cliente);
+  }
+  return NULL;
+}
+
+/*--------------------------------------------------------------------
+| Function: monitorIniciar
+---------------------------------------------------------------------*/
+
+int monitorIniciar(char const *caminho, int base, int iter_max, double maxD, int periodoS) {
+  struct sockaddr_un end;
+  struct stat        st;
+
+  if (strlen(caminho) >= sizeof(end.sun_path))
+    return -1;
+  // so' se remove um socket deixado por uma execucao anterior; qualquer
+  // outro ficheiro nesse caminho e' um erro
+  if (lstat(caminho, &st) == 0) {
+    if (!S_ISSOCK(st.st_mode) || unlink(caminho) != 0)
+      return -1;
+  } else if (errno != ENOENT) {
+    return -1;
+  }
+
+  monitor_base     = base;
+  monitor_iter_max = iter_max;
+  monitor_maxD     = maxD;
+  monitor_periodoS = periodoS;
+  t_inicio         = tempoAgora();
+  amostra_t        = t_inicio;
+  amostra_iter     = base;
+  // ate' 'a primeira iteracao publicada, o ponto de partida
+  __atomic_store_n(&iteracao_publicada, base, __ATOMIC_RELEASE);
+  amostra_delta    = INFINITY;
+  snprintf(caminho_socket, sizeof(caminho_socket), "%s", caminho);
+
+  fd_servidor = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd_servidor < 0)
+    return -1;
+
+  memset(&end, 0, sizeof(end));
+  end.sun_family = AF_UNIX;
+  snprintf(end.sun_path, sizeof(end.sun_path), "%s", caminho);
+
+  if (bind(fd_servidor, (struct sockaddr*) &end, sizeof(end)) != 0 ||
+      listen(fd_servidor, 8) != 0) {
+    close(fd_servidor);
+    fd_servidor = -1;
+    return -1;
+  }
+
+  if (pthread_create(&tarefa_monitor, NULL, servir, NULL) != 0) {
+    close(fd_servidor);
+    fd_servidor = -1;
+    unlink(caminho);
+    return -1;
+  }
+  return 0;
+}
+
+/*--------------------------------------------------------------------
+| Function: monitorParar
+---------------------------------------------------------------------*/
+
+void monitorParar(void) {
+  if (fd_servidor < 0)
+    return;
+  __atomic_store_n(&parar, 1, __ATOMIC_RELEASE);
+  pthread_join(tarefa_monitor, NULL);
+  close(fd_servidor);
+  unlink(caminho_socket);
+  fd_servidor = -1;
+}
@@ -0,0 +1,43 @@
+/*
+// Monitor do progresso por socket Unix
+// Sistemas Operativos, DEI/IST/ULisboa 2017-18
+*/
+
+#ifndef MONITOR_H
+#define MONITOR_H
+
+/*--------------------------------------------------------------------
+| Function: monitorIniciar
+| Description: Cria o socket Unix em 'caminho' e lanca a tarefa que
+|              responde aos pedidos. 'base' sao as iteracoes ja' feitas
+|              ao arrancar (de uma retoma), que nao contam para as
+|              iteracoes por segundo. 'iter_max' e 'maxD' sao os
+|              criterios de paragem e 'periodoS' o periodo de
+|              salvaguarda (0 se desactivada), usados para estimar o
+|              tempo restante e reportar o estado. Um socket antigo em
+|              'caminho' e' substituido; se la' houver outro tipo de
+|              ficheiro, falha. Devolve 0 em caso de sucesso.
+---------------------------------------------------------------------*/
+int  monitorIniciar(char const *caminho, int base, int iter_max, double maxD, int periodoS);
+
+/*--------------------------------------------------------------------
+| Function: monitorPublicar
+| Description: Publica a iteracao concluida e o delta global. Chamada
+|              na barreira; so' escreve em variaveis atomicas.
+---------------------------------------------------------------------*/
+void monitorPublicar(int iteracao, double delta);
+
+/*--------------------------------------------------------------------
+| Function: monitorSalvaguarda
+| Description: Regista o inicio de uma salvaguarda periodica. Segura
+|              para chamar num signal handler.
+---------------------------------------------------------------------*/
+void monitorSalvaguarda(void);
+
+/*--------------------------------------------------------------------
+| Function: monitorParar
+| Description: Termina a tarefa do monitor e remove o socket
+---------------------------------------------------------------------*/
+void monitorParar(void);
+
+#endif
@@ -0,0 +1,623 @@
+/*
+// mpBench - medicoes da biblioteca de troca de mensagens (mplib3)
+// Sistemas Operativos, DEI/IST/ULisboa 2017-18
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <malloc.h>
+#include <pthread.h>
+
+#include "mplib3.h"
+#include "mpcoletivas.h"
+#include "pool.h"
+#include "medicao.h"
+#include "util.h"
+
+#define MAX_LISTA    32
+#define MAX_LINHAS   1024
+#define TAM_MSG      64
+#define NUM_OPS      4
+
+static char const *nomes_ops[NUM_OPS] = { "barreira", "difusao", "reducao", "reducao_raiz" };
+
+typedef enum { PINGPONG, FLUXO, CONCENTRACAO, HALO, NUM_PADROES } Padrao;
+
+static char const *nomes_padroes[NUM_PADROES] = { "pingpong", "fluxo", "concentracao", "halo" };
+
+/*--------------------------------------------------------------------
+| Function: dividir_lista
+| Description: Parte uma lista separada por virgulas, alterando str.
+|              Devolve o numero de elementos.
+---------------------------------------------------------------------*/
+
+static int dividir_lista(char *str, char **itens, int max) {
+  int n = 0;
+  for (char *tok = strtok(str, ","); tok != NULL && n < max; tok = strtok(NULL, ","))
+    itens[n++] = tok;
+  return n;
+}
+
+static int comparar_doubles(const void *a, const void *b) {
+  double x = *(const double*) a, y = *(const double*) b;
+  return (x > y) - (x < y);
+}
+
+/*--------------------------------------------------------------------
+| Function: quantil
+| Description: Quantil q de um vector ordenado, com interpolacao linear
+---------------------------------------------------------------------*/
+
+static double quantil(double *ordenado, int n, double q) {
+  double pos = q * (n - 1);
+  int    i   = (int) pos;
+  double f   = pos - i;
+  if (i + 1 >= n)
+    return ordenado[n - 1];
+  return ordenado[i] * (1 - f) + ordenado[i + 1] * f;
+}
+
+/*--------------------------------------------------------------------
+| Function: memoria_em_uso
+| Description: Bytes reservados pelo malloc neste momento
+---------------------------------------------------------------------*/
+
+static long memoria_em_uso(void) {
+  struct mallinfo2 mi = mallinfo2();
+  return (long) (mi.uordblks + mi.hblkhd);
+}
+
+/*--------------------------------------------------------------------
+| Function: troca_vizinhas
+| Description: Cada uma das n tarefas envia uma mensagem a t-1 e a
+|              t+1 e recebe as das vizinhas, como no estencil. Corre
+|              numa so' tarefa, com os pedidos assincronos, para medir
+|              so' a biblioteca.
+---------------------------------------------------------------------*/
+
+static void troca_vizinhas(int n) {
+  PedidoMP *ped = (PedidoMP*) malloc(sizeof(PedidoMP) * 4 * n);
+  char      msg[TAM_MSG], buf[TAM_MSG];
+  int       k = 0;
+
+  if (ped == NULL)
+    die("Erro ao alocar memoria para os pedidos");
+  memset(msg, 0, sizeof(msg));
+  for (int t = 0; t < n; t++) {
+    if (t > 0)     ped[k++] = enviarMensagemAssinc(t, t-1, msg, TAM_MSG);
+    if (t < n - 1) ped[k++] = enviarMensagemAssinc(t, t+1, msg, TAM_MSG);
+  }
+  for (int t = 0; t < n; t++) {
+    if (t > 0)     ped[k++] = receberMensagemAssinc(t-1, t, buf, TAM_MSG);
+    if (t < n - 1) ped[k++] = receberMensagemAssinc(t+1, t, buf, TAM_MSG);
+  }
+  esperarTodos(ped, k, NULL);
+  free(ped);
+}
+
+/*--------------------------------------------------------------------
+| Function: medir_canais
+| Description: Tempo de inicializacao e de libertacao e memoria usada
+|              pela biblioteca com n tarefas, antes e depois de uma
+|              troca com as vizinhas. Uma segunda troca mede o regime
+|              estavel: os blocos da primeira ja' estao no pool e nao
+|              deve haver reservas ao sistema.
+---------------------------------------------------------------------*/
+
+static void medir_canais(FILE *f, int n, int capacidade) {
+  long   m0 = memoria_em_uso();
+  double t0 = tempoAgora();
+  inicializarMPlib(capacidade, n);
+  double t_ini = tempoAgora() - t0;
+  long   m_ini = memoria_em_uso() - m0;
+
+  t0 = tempoAgora();
+  troca_vizinhas(n);
+  double t_troca = tempoAgora() - t0;
+  long   m_troca = memoria_em_uso() - m0;
+
+  EstatPool antes, depois;
+  poolEstatisticas(&antes);
+  t0 = tempoAgora();
+  troca_vizinhas(n);
+  double t_troca2 = tempoAgora() - t0;
+  poolEstatisticas(&depois);
+
+  t0 = tempoAgora();
+  libertarMPlib();
+  double t_fim = tempoAgora() - t0;
+
+  fprintf(f, "%d,%d,%.6e,%.6e,%.6e,%.6e,%ld,%ld,%lu,%lu\n",
+          n, capacidade, t_ini, t_troca, t_troca2, t_fim, m_ini, m_troca,
+          depois.alocacoes - antes.alocacoes, depois.reservas - antes.reservas);
+  fflush(f);
+  fprintf(stderr, "tarefas=%-6d inicializar %.3e s  troca %.3e s (estavel %.3e s)"
+                  "  libertar %.3e s  memoria %ld KB (depois da troca %ld KB)"
+                  "  pool: %lu blocos, %lu reservas\n",
+          n, t_ini, t_troca, t_troca2, t_fim, m_ini >> 10, m_troca >> 10,
+          depois.alocacoes - antes.alocacoes, depois.reservas - antes.reservas);
+}
+
+/*--------------------------------------------------------------------
+| Function: reduzir_pela_raiz
+| Description: Reducao maxima ingenua, para comparacao: a tarefa 0
+|              recebe os P-1 valores, um a um, e devolve o maximo
+---------------------------------------------------------------------*/
+
+static void reduzir_pela_raiz(int tarefa, double *valor) {
+  int P = numeroTarefasMP();
+
+  if (tarefa == 0) {
+    for (int t = 1; t < P; t++) {
+      double v;
+      receberMensagemEtiq(MP_QUALQUER_ORIGEM, 0, 1, &v, sizeof(double), NULL);
+      *valor = v > *valor ? v : *valor;
+    }
+    for (int t = 1; t < P; t++)
+      enviarMensagemEtiq(0, t, 2, valor, sizeof(double));
+  } else {
+    enviarMensagemEtiq(tarefa, 0, 1, valor, sizeof(double));
+    receberMensagemEtiq(0, tarefa, 2, valor, sizeof(double), NULL);
+  }
+}
+
+/*--------------------------------------------------------------------
+| Type: Coletiva
+| Description: Argumentos e resultados de cada tarefa da medicao das
+|              operacoes coletivas
+---------------------------------------------------------------------*/
+
+typedef struct {
+  int     id;
+  int     reps;
+  double *tempos;     // so' a tarefa 0: reps por operacao
+  int     erros;
+} Coletiva;
+
+/*--------------------------------------------------------------------
+| Function: tarefa_coletivas
+| Description: Corre 'reps' vezes cada operacao, separadas por uma
+|              barreira; a tarefa 0 mede cada uma. Confere o maximo
+|              e o valor difundido.
+---------------------------------------------------------------------*/
+
+static void *tarefa_coletivas(void *arg) {
+  Coletiva *c = (Coletiva*) arg;
+  int       P = numeroTarefasMP();
+
+  for (int op = 0; op < NUM_OPS; op++) {
+    for (int r = 0; r < c->reps; r++) {
+      double v = c->id == r % P ? 1e9 + r : c->id;
+      double t0;
+
+      barreiraMP(c->id);
+      t0 = tempoAgora();
+      switch (op) {
+        case 0: barreiraMP(c->id);                                break;
+        case 1: difundirMP(c->id, r % P, &v, sizeof(double));     break;
+        case 2: reduzirTodosMP(c->id, &v, 1, MP_MAX);             break;
+        case 3: reduzir_pela_raiz(c->id, &v);                     break;
+      }
+      if (c->tempos != NULL)
+        c->tempos[op * c->reps + r] = tempoAgora() - t0;
+      if (op > 0 && v != 1e9 + r)
+        c->erros++;
+    }
+  }
+  return NULL;
+}
+
+/*--------------------------------------------------------------------
+| Function: medir_coletivas
+| Description: Mediana da latencia de cada operacao com P tarefas
+---------------------------------------------------------------------*/
+
+static void medir_coletivas(FILE *f, int P, int capacidade, int reps) {
+  pthread_t *tarefas = (pthread_t*) malloc(sizeof(pthread_t) * P);
+  Coletiva  *args    = (Coletiva*) malloc(sizeof(Coletiva) * P);
+  double    *tempos  = (double*) malloc(sizeof(double) * NUM_OPS * reps);
+  int        erros   = 0;
+  EstatPool  antes, depois;
+
+  if (tarefas == NULL || args == NULL || tempos == NULL)
+    die("Erro ao alocar memoria para as tarefas");
+
+  poolEstatisticas(&antes);
+  inicializarMPlib(capacidade, P);
+  for (int t = 0; t < P; t++) {
+    args[t].id     = t;
+    args[t].reps   = reps;
+    args[t].tempos = t == 0 ? tempos : NULL;
+    args[t].erros  = 0;
+    if (pthread_create(&tarefas[t], NULL, tarefa_coletivas, &args[t]) != 0)
+      die("Erro ao criar tarefa");
+  }
+  for (int t = 0; t < P; t++) {
+    if (pthread_join(tarefas[t], NULL) != 0)
+      die("Erro ao esperar por tarefa");
+    erros += args[t].erros;
+  }
+  libertarMPlib();
+  poolEstatisticas(&depois);
+
+  fprintf(stderr, "tarefas=%-5d", P);
+  for (int op = 0; op < NUM_OPS; op++) {
+    double *t = &tempos[op * reps];
+    qsort(t, reps, sizeof(double), comparar_doubles);
+    fprintf(f, "%d,%d,%s,%d,%.6e\n", P, capacidade, nomes_ops[op], reps, t[reps / 2]);
+    fprintf(stderr, "  %s %.2e s", nomes_ops[op], t[reps / 2]);
+  }
+  fprintf(stderr, "  pool: %lu blocos (%lu de outra tarefa), %lu reservas%s\n",
+          depois.alocacoes - antes.alocacoes, depois.remotas - antes.remotas,
+          depois.reservas - antes.reservas, erros ? "  RESULTADOS ERRADOS" : "");
+  fflush(f);
+
+  free(tarefas);
+  free(args);
+  free(tempos);
+}
+
+/*--------------------------------------------------------------------
+| Type: Medidor
+| Description: Argumentos e amostras de cada tarefa de um padrao de
+|              troca de mensagens
+---------------------------------------------------------------------*/
+
+typedef struct {
+  int     id;
+  int     P;
+  Padrao  padrao;
+  int     reps;
+  long    tamanho;
+  char   *msg;
+  char   *buf[2];
+  double *amostras;
+  int     n_amostras;
+  long    recebidas;
+  double  ini, fim;
+} Medidor;
+
+/*--------------------------------------------------------------------
+| Function: tarefa_padrao
+| Description: Uma tarefa de um padrao, 'reps' vezes:
+|              pingpong     - pares (2i, 2i+1): ida e volta; amostra
+|                             e' metade do tempo de ida e volta
+|              fluxo        - pares: 2i envia seguidas, 2i+1 mede
+|                             cada rececao
+|              concentracao - todas enviam a 0, que recebe de
+|                             qualquer origem e mede cada rececao
+|              halo         - cada tarefa troca com t-1 e t+1, como
+|                             no estencil; amostra e' a troca toda
+|              Com P impar, a ultima tarefa dos pares fica parada.
+---------------------------------------------------------------------*/
+
+static void *tarefa_padrao(void *arg) {
+  Medidor *m   = (Medidor*) arg;
+  int      id  = m->id, par = id ^ 1;
+  long     tam = m->tamanho;
+
+  barreiraMP(id);
+  m->ini = tempoAgora();
+
+  switch (m->padrao) {
+    case PINGPONG:
+      if (par >= m->P)
+        break;
+      for (int r = 0; r < m->reps; r++) {
+        double t0 = tempoAgora();
+        if (id % 2 == 0) {
+          enviarMensagem(id, par, m->msg, tam);
+          receberMensagem(par, id, m->buf[0], tam);
+          m->amostras[m->n_amostras++] = (tempoAgora() - t0) / 2;
+        } else {
+          receberMensagem(par, id, m->buf[0], tam);
+          enviarMensagem(id, par, m->msg, tam);
+        }
+        m->recebidas++;
+      }
+      break;
+
+    case FLUXO:
+      if (par >= m->P)
+        break;
+      for (int r = 0; r < m->reps; r++) {
+        if (id % 2 == 0) {
+          enviarMensagem(id, par, m->msg, tam);
+        } else {
+          double t0 = tempoAgora();
+          receberMensagem(par, id, m->buf[0], tam);
+          m->amostras[m->n_amostras++] = tempoAgora() - t0;
+          m->recebidas++;
+        }
+      }
+      break;
+
+    case CONCENTRACAO:
+      if (id > 0) {
+        for (int r = 0; r < m->reps; r++)
+          enviarMensagem(id, 0, m->msg, tam);
+        break;
+      }
+      for (int r = 0; r < m->reps * (m->P - 1); r++) {
+        double t0 = tempoAgora();
+        receberMensagemEtiq(MP_QUALQUER_ORIGEM, 0, 0, m->buf[0], tam, NULL);
+        m->amostras[m->n_amostras++] = tempoAgora() - t0;
+        m->recebidas++;
+      }
+      break;
+
+    case HALO:
+      for (int r = 0; r < m->reps; r++) {
+        PedidoMP ped[4];
+        int      k  = 0;
+        double   t0 = tempoAgora();
+        if (id > 0) {
+          ped[k++] = receberMensagemEtiqAssinc(id-1, id, r, m->buf[0], tam, NULL);
+          ped[k++] = enviarMensagemEtiqAssinc(id, id-1, r, m->msg, tam);
+        }
+        if (id < m->P - 1) {
+          ped[k++] = receberMensagemEtiqAssinc(id+1, id, r, m->buf[1], tam, NULL);
+          ped[k++] = enviarMensagemEtiqAssinc(id, id+1, r, m->msg, tam);
+        }
+        esperarTodos(ped, k, NULL);
+        m->amostras[m->n_amostras++] = tempoAgora() - t0;
+        m->recebidas += k / 2;
+      }
+      break;
+
+    default:
+      break;
+  }
+
+  m->fim = tempoAgora();
+  return NULL;
+}
+
+/*--------------------------------------------------------------------
+| Function: medir_padrao
+| Description: Percentis das amostras de todas as tarefas e mensagens
+|              recebidas por segundo, de um padrao com P tarefas
+---------------------------------------------------------------------*/
+
+static void medir_padrao(FILE *f, Padrao padrao, int P, int capacidade, long tamanho,
+                         int reps) {
+  pthread_t *tarefas = (pthread_t*) malloc(sizeof(pthread_t) * P);
+  Medidor   *med     = (Medidor*) calloc(P, sizeof(Medidor));
+  int        max_am  = padrao == CONCENTRACAO ? reps * (P - 1) : reps;
+  double    *todas   = (double*) malloc(sizeof(double) * (size_t) max_am * P);
+  double     ini = 0, fim = 0;
+  long       recebidas = 0;
+  int        n = 0;
+
+  if (tarefas == NULL || med == NULL || todas == NULL)
+    die("Erro ao alocar memoria para as tarefas");
+
+  inicializarMPlib(capacidade, P);
+  for (int t = 0; t < P; t++) {
+    Medidor *m = &med[t];
+    m->id       = t;
+    m->P        = P;
+    m->padrao   = padrao;
+    m->reps     = reps;
+    m->tamanho  = tamanho;
+    m->msg      = (char*) calloc(1, tamanho);
+    m->buf[0]   = (char*) malloc(tamanho);
+    m->buf[1]   = (char*) malloc(tamanho);
+    m->amostras = (double*) malloc(sizeof(double) * max_am);
+    if (m->msg == NULL || m->buf[0] == NULL || m->buf[1] == NULL || m->amostras == NULL)
+      die("Erro ao alocar memoria para as mensagens");
+    if (pthread_create(&tarefas[t], NULL, tarefa_padrao, m) != 0)
+      die("Erro ao criar tarefa");
+  }
+  for (int t = 0; t < P; t++) {
+    Medidor *m = &med[t];
+    if (pthread_join(tarefas[t], NULL) != 0)
+      die("Erro ao esperar por tarefa");
+    memcpy(&todas[n], m->amostras, sizeof(double) * m->n_amostras);
+    n         += m->n_amostras;
+    recebidas += m->recebidas;
+    ini = t == 0 || m->ini < ini ? m->ini : ini;
+    fim = t == 0 || m->fim > fim ? m->fim : fim;
+    free(m->msg);
+    free(m->buf[0]);
+    free(m->buf[1]);
+    free(m->amostras);
+  }
+  libertarMPlib();
+
+  qsort(todas, n, sizeof(double), comparar_doubles);
+  double p50  = quantil(todas, n, 0.5);
+  double p99  = quantil(todas, n, 0.99);
+  double p999 = quantil(todas, n, 0.999);
+  double msgs = recebidas / (fim - ini);
+
+  fprintf(f, "%s,%d,%d,%ld,%d,%.6e,%.6e,%.6e,%.6e,%.6e\n", nomes_padroes[padrao], P,
+          capacidade, tamanho, n, p50, p99, p999, msgs, msgs * tamanho / 1e6);
+  fflush(f);
+  fprintf(stderr, "%-12s tarefas=%-4d cap=%-3d %7ld B  p50 %.2e s  p99 %.2e s  p999 %.2e s"
+                  "  %.3e msg/s  %8.1f MB/s\n",
+          nomes_padroes[padrao], P, capacidade, tamanho, p50, p99, p999, msgs,
+          msgs * tamanho / 1e6);
+
+  free(tarefas);
+  free(med);
+  free(todas);
+}
+
+/*--------------------------------------------------------------------
+| Type: Linha
+| Description: Uma linha de resultados do modo padroes
+---------------------------------------------------------------------*/
+
+typedef struct {
+  char   padrao[32];
+  int    P, capacidade, amostras;
+  long   tamanho;
+  double p50, p99, p999, msgs, mbs;
+} Linha;
+
+/*--------------------------------------------------------------------
+| Function: ler_padroes
+| Description: Le um ficheiro de resultados do modo padroes. Devolve
+|              o numero de linhas lidas ou -1 se o ficheiro nao abrir.
+---------------------------------------------------------------------*/
+
+static int ler_padroes(char const *nome, Linha *res, int max) {
+  FILE *f = fopen(nome, "r");
+  char  linha[512];
+  int   n = 0;
+
+  if (f == NULL)
+    return -1;
+
+  while (n < max && fgets(linha, sizeof(linha), f) != NULL) {
+    Linha *l = &res[n];
+    if (sscanf(linha, "%31[^,],%d,%d,%ld,%d,%lf,%lf,%lf,%lf,%lf",
+               l->padrao, &l->P, &l->capacidade, &l->tamanho, &l->amostras,
+               &l->p50, &l->p99, &l->p999, &l->msgs, &l->mbs) == 10)
+      n++;
+  }
+  fclose(f);
+  return n;
+}
+
+/*--------------------------------------------------------------------
+| Function: comparar
+| Description: Compara dois ficheiros do modo padroes e assinala as
+|              configuracoes cujo p50 ou p99 piorou mais do que
+|              'limiar' (fraccao). Devolve o numero de regressoes.
+---------------------------------------------------------------------*/
+
+static int comparar(char const *base_nome, char const *novo_nome, double limiar) {
+  static Linha base[MAX_LINHAS], novo[MAX_LINHAS];
+  int nb = ler_padroes(base_nome, base, MAX_LINHAS);
+  int nn = ler_padroes(novo_nome, novo, MAX_LINHAS);
+  int regressoes = 0;
+
+  if (nb < 0 || nn < 0)
+    die("Nao foi possivel ler os ficheiros de resultados");
+
+  printf("%-12s %5s %4s %7s %11s %11s %8s %11s %11s %8s\n", "padrao", "tar", "cap", "bytes",
+         "base p50", "novo p50", "var", "base p99", "novo p99", "var");
+  for (int i = 0; i < nn; i++) {
+    Linha *n = &novo[i];
+    for (int j = 0; j < nb; j++) {
+      Linha *b = &base[j];
+      if (strcmp(b->padrao, n->padrao) != 0 || b->P != n->P ||
+          b->capacidade != n->capacidade || b->tamanho != n->tamanho)
+        continue;
+
+      double v50 = n->p50 / b->p50 - 1, v99 = n->p99 / b->p99 - 1;
+      int    pior = v50 > limiar || v99 > limiar;
+      regressoes += pior;
+      printf("%-12s %5d %4d %7ld %11.3e %11.3e %+7.1f%% %11.3e %11.3e %+7.1f%%%s\n",
+             n->padrao, n->P, n->capacidade, n->tamanho, b->p50, n->p50, 100 * v50,
+             b->p99, n->p99, 100 * v99, pior ? "  REGRESSAO" : "");
+      break;
+    }
+  }
+  printf("\n%d regressao(oes) acima de %.1f%%\n", regressoes, 100 * limiar);
+  return regressoes;
+}
+
+/*--------------------------------------------------------------------
+| Function: main
+---------------------------------------------------------------------*/
+
+int main(int argc, char **argv) {
+  char const *saida      = "mpbench_resultados.csv";
+  char const *modo       = "canais";
+  char        listaN[256] = "";
+  char        listaC[256] = "";
+  char        listaS[256] = "8,4096";
+  char        listaP[256] = "pingpong,fluxo,concentracao,halo";
+  int         reps       = 0;
+  int         opt;
+
+  if (argc >= 2 && strcmp(argv[1], "-C") == 0) {
+    if (argc < 4) {
+      fprintf(stderr, "Utilizacao: ./mpBench -C base.csv novo.csv [limiar%%]\n");
+      return 2;
+    }
+    double limiar = argc > 4 ? parse_double_or_exit(argv[4], "limiar", 0) / 100 : 0.05;
+    return comparar(argv[2], argv[3], limiar) > 0;
+  }
+
+  while ((opt = getopt(argc, argv, "m:n:c:s:p:r:o:")) != -1) {
+    switch (opt) {
+      case 'm': modo = optarg; break;
+      case 'n': snprintf(listaN, sizeof(listaN), "%s", optarg); break;
+      case 'c': snprintf(listaC, sizeof(listaC), "%s", optarg); break;
+      case 's': snprintf(listaS, sizeof(listaS), "%s", optarg); break;
+      case 'p': snprintf(listaP, sizeof(listaP), "%s", optarg); break;
+      case 'r': reps = parse_integer_or_exit(optarg, "repeticoes", 1); break;
+      case 'o': saida = optarg; break;
+      default:
+        fprintf(stderr, "Utilizacao: ./mpBench [-m canais|coletivas|padroes] [-n 16,64,256]"
+                        " [-c 0,2] [-s 8,4096] [-p pingpong,fluxo,concentracao,halo]"
+                        " [-r repeticoes] [-o resultados.csv]\n"
+                        "            ./mpBench -C base.csv novo.csv [limiar%%]\n");
+        return 2;
+    }
+  }
+  int coletivas = strcmp(modo, "coletivas") == 0;
+  int padroes   = strcmp(modo, "padroes") == 0;
+  if (!coletivas && !padroes && strcmp(modo, "canais") != 0)
+    die("Modo desconhecido (canais, coletivas, padroes)");
+  if (listaN[0] == '\0')
+    snprintf(listaN, sizeof(listaN), "%s", coletivas ? "2,4,8,16,32,64" :
+                                           padroes   ? "2,8,32,128" : "16,64,256,1024");
+  if (listaC[0] == '\0')
+    snprintf(listaC, sizeof(listaC), "%s", padroes ? "0,16" : "2");
+  if (reps == 0)
+    reps = padroes ? 1000 : 101;
+
+  char *Ns[MAX_LISTA], *Cs[MAX_LISTA], *Ss[MAX_LISTA], *Ps[MAX_LISTA];
+  int   nN = dividir_lista(listaN, Ns, MAX_LISTA);
+  int   nC = dividir_lista(listaC, Cs, MAX_LISTA);
+  int   nS = dividir_lista(listaS, Ss, MAX_LISTA);
+  int   nP = dividir_lista(listaP, Ps, MAX_LISTA);
+  Padrao pads[MAX_LISTA];
+
+  for (int p = 0; p < nP; p++) {
+    int k = 0;
+    while (k < NUM_PADROES && strcmp(Ps[p], nomes_padroes[k]) != 0)
+      k++;
+    if (k == NUM_PADROES)
+      die("Padrao desconhecido (pingpong, fluxo, concentracao, halo)");
+    pads[p] = (Padrao) k;
+  }
+
+  FILE *f = fopen(saida, "w");
+  if (f == NULL)
+    die("Erro ao abrir ficheiro de resultados");
+  if (coletivas)
+    fprintf(f, "tarefas,capacidade,operacao,repeticoes,mediana_s\n");
+  else if (padroes)
+    fprintf(f, "padrao,tarefas,capacidade,tamanho,amostras,p50_s,p99_s,p999_s,"
+               "mensagens_s,mb_s\n");
+  else
+    fprintf(f, "tarefas,capacidade,inicializar_s,troca_s,troca_estavel_s,libertar_s,"
+               "memoria_inicial,memoria_troca,blocos_estavel,reservas_estavel\n");
+
+  for (int c = 0; c < nC; c++) {
+    int capacidade = parse_integer_or_exit(Cs[c], "capacidade", 0);
+    for (int a = 0; a < nN; a++) {
+      int n = parse_integer_or_exit(Ns[a], "tarefas", 2);
+      if (coletivas)
+        medir_coletivas(f, n, capacidade, reps);
+      else if (!padroes)
+        medir_canais(f, n, capacidade);
+      else
+        for (int p = 0; p < nP; p++)
+          for (int s = 0; s < nS; s++)
+            medir_padrao(f, pads[p], n, capacidade,
+                         parse_integer_or_exit(Ss[s], "tamanho", 1), reps);
+    }
+  }
+
+  fclose(f);
+  return 0;
+}
@@ -0,0 +1,129 @@
+/*
+// Operacoes coletivas sobre a mplib3
+// Sistemas Operativos, DEI/IST/ULisboa 2017-18
+*/
+
+#include "mpcoletivas.h"
+#include "mplib3.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// etiquetas reservadas; a ronda k soma-se a base
+#define ETIQ_BARREIRA   (-1000)
+#define ETIQ_DIFUSAO    (-2000)
+#define ETIQ_REDUCAO    (-3000)
+#define ETIQ_JUNTAR     (-3100)
+#define ETIQ_DEVOLVER   (-3101)
+
+/*--------------------------------------------------------------------
+| Function: trocar
+| Description: Envia para 'dest' e recebe de 'orig' sem depender de
+|              buffer nos canais: o envio so' e' esperado depois da
+|              rececao
+---------------------------------------------------------------------*/
+
+static void trocar(int tarefa, int dest, int orig, int etiqueta,
+                   void *env, void *rec, long tamanho) {
+  PedidoMP p = enviarMensagemEtiqAssinc(tarefa, dest, etiqueta, env, tamanho);
+  receberMensagemEtiq(orig, tarefa, etiqueta, rec, tamanho, NULL);
+  esperarPedido(&p);
+}
+
+/*--------------------------------------------------------------------
+| Function: barreiraMP
+---------------------------------------------------------------------*/
+
+void barreiraMP(int tarefa) {
+  int  P = numeroTarefasMP();
+  char env = 0, rec;
+
+  for (int k = 0, d = 1; d < P; k++, d <<= 1)
+    trocar(tarefa, (tarefa + d) % P, (tarefa - d + P) % P, ETIQ_BARREIRA - k,
+           &env, &rec, 1);
+}
+
+/*--------------------------------------------------------------------
+| Function: difundirMP
+---------------------------------------------------------------------*/
+
+void difundirMP(int tarefa, int raiz, void *buffer, long tamanho) {
+  int      P = numeroTarefasMP();
+  int      v = (tarefa - raiz + P) % P;     // posicao relativa a raiz
+  int      mask = 1, n = 0;
+  PedidoMP env[32];
+
+  // recebe do pai: v sem o bit menos significativo
+  while (mask < P) {
+    if (v & mask) {
+      receberMensagemEtiq((v - mask + raiz) % P, tarefa, ETIQ_DIFUSAO, buffer, tamanho, NULL);
+      break;
+    }
+    mask <<= 1;
+  }
+  // envia aos filhos: v mais cada bit abaixo desse
+  for (mask >>= 1; mask > 0; mask >>= 1)
+    if (v + mask < P)
+      env[n++] = enviarMensagemEtiqAssinc(tarefa, (v + mask + raiz) % P, ETIQ_DIFUSAO,
+                                          buffer, tamanho);
+  esperarTodos(env, n, NULL);
+}
+
+/*--------------------------------------------------------------------
+| Function: combinar
+---------------------------------------------------------------------*/
+
+static void combinar(double *acc, double const *outro, int n, OperacaoMP op) {
+  for (int i = 0; i < n; i++) {
+    switch (op) {
+      case MP_MAX:  acc[i] = outro[i] > acc[i] ? outro[i] : acc[i]; break;
+      case MP_MIN:  acc[i] = outro[i] < acc[i] ? outro[i] : acc[i]; break;
+      case MP_SOMA: acc[i] = acc[i] + outro[i];                     break;
+    }
+  }
+}
+
+/*--------------------------------------------------------------------
+| Function: reduzirTodosMP
+| Description: Combina 'valores' (n por tarefa) de todas as tarefas e
+|              deixa o resultado em 'valores' em todas elas
+---------------------------------------------------------------------*/
+
+void reduzirTodosMP(int tarefa, double *valores, int n, OperacaoMP op) {
+  int     P   = numeroTarefasMP();
+  int     p2  = 1;
+  long    tam = n * sizeof(double);
+  double *outro = (double*) malloc(tam);
+
+  if (outro == NULL) {
+    fprintf(stderr, "\nErro ao alocar memória para a reducao\n");
+    exit(1);
+  }
+  while (2 * p2 <= P)
+    p2 *= 2;
+
+  if (tarefa >= p2) {
+    // tarefa a mais: entrega o seu valor e espera pelo resultado
+    enviarMensagemEtiq(tarefa, tarefa - p2, ETIQ_JUNTAR, valores, tam);
+    receberMensagemEtiq(tarefa - p2, tarefa, ETIQ_DEVOLVER, valores, tam, NULL);
+    free(outro);
+    return;
+  }
+  if (tarefa + p2 < P) {
+    receberMensagemEtiq(tarefa + p2, tarefa, ETIQ_JUNTAR, outro, tam, NULL);
+    combinar(valores, outro, n, op);
+  }
+
+  // com a soma, a+b e b+a sao iguais, pelo que as duas parceiras ficam
+  // sempre com o mesmo valor
+  for (int k = 0, m = 1; m < p2; k++, m <<= 1) {
+    int parceira = tarefa ^ m;
+    trocar(tarefa, parceira, parceira, ETIQ_REDUCAO - k, valores, outro, tam);
+    combinar(valores, outro, n, op);
+  }
+
+  if (tarefa + p2 < P)
+    enviarMensagemEtiq(tarefa, tarefa + p2, ETIQ_DEVOLVER, valores, tam);
+  free(outro);
+}
@@ -0,0 +1,27 @@
+/*
+// Operacoes coletivas sobre a mplib3
+// Sistemas Operativos, DEI/IST/ULisboa 2017-18
+//
+// Todas as tarefas 0..P-1 chamam a mesma operacao pela mesma ordem.
+// So' usam envios e rececoes ponto a ponto com etiqueta (etiquetas
+// negativas, reservadas), pelo que servem para qualquer transporte que
+// implemente essas funcoes, com ou sem buffer nos canais. Cada
+// operacao tem latencia O(log P):
+//   barreiraMP:     disseminacao, ceil(log2 P) rondas
+//   difundirMP:     arvore binomial a partir da raiz
+//   reduzirTodosMP: duplicacao recursiva; com P que nao e' potencia
+//                   de 2, as tarefas a mais juntam-se primeiro a uma
+//                   parceira e recebem dela o resultado
+// O resultado da reducao e' igual, bit a bit, em todas as tarefas.
+*/
+
+#ifndef MPCOLETIVAS_H
+#define MPCOLETIVAS_H
+
+typedef enum { MP_MAX, MP_MIN, MP_SOMA } OperacaoMP;
+
+void barreiraMP(int tarefa);
+void difundirMP(int tarefa, int raiz, void *buffer, long tamanho);
+void reduzirTodosMP(int tarefa, double *valores, int n, OperacaoMP op);
+
+#endif
@@ -5,6 +5,7 @@
 
 #include "mplib3.h"
 #include "leQueue.h"
+#include "pool.h"
 
 #include <pthread.h>
 #include <stdlib.h>
@@ -16,22 +17,87 @@
 
 /*--------------------------------------------------------------------
 | Types
+|
+| As mensagens para a tarefa d ficam na caixa de d, protegida por um
+| so' mutex, em filas por etiqueta: a fila (o, etiqueta) do canal o->d
+| e a fila (qualquer origem, etiqueta) da caixa. Cada mensagem esta'
+| nas duas, pela ordem de chegada, e as rececoes por satisfazer ficam
+| na fila da origem que pediram. As filas sao encontradas por tabelas
+| indexadas pela etiqueta (leQueTab) e libertadas quando ficam vazias.
+|
+| Os canais o->d so' sao criados quando sao usados pela primeira vez,
+| e ficam numa tabela da caixa de d indexada pela origem, tambem
+| protegida pelo mutex da caixa. A memoria cresce assim com os pares
+| de tarefas que comunicam, e nao com o quadrado do numero de tarefas.
+|
+| Mensagens, conteudos, filas, pedidos e canais vem do pool (pool.h):
+| a mensagem reservada por quem envia e libertada por quem recebe
+| volta 'a lista livre de quem a enviou, sem passar pelo malloc.
 ---------------------------------------------------------------------*/
 
+struct pedido_t;
+struct message_t;
+
+typedef struct fila_t {
+  QueElem          elem;        // na tabela; a chave e' a etiqueta
+  QueTab           *tab;
+  QueHead          mensagens;   // Ligacao_t
+  QueHead          rececoes;    // Pedido_t, por ordem de pedido
+} Fila_t;
+
+typedef struct ligacao_t {
+  QueElem          elem;
+  struct message_t *mess;
+} Ligacao_t;
+
 typedef struct message_t {
-  QueElem   elem;
-  void      *contents;
-  int       mess_size;
-  int       consumed;
+  Ligacao_t        lig[2];      // [0] na fila do canal, [1] na da caixa
+  Fila_t           *filas[2];
+  int              orig;
+  int              etiqueta;
+  void             *contents;
+  long             mess_size;
+  struct pedido_t  *envio;      // envio a concluir quando for consumida
 } Message_t;
 
 typedef struct channel_t {
-  QueHead           *message_list;
-  pthread_mutex_t   mutex;
-  pthread_cond_t    wait_for_free_space;
-  pthread_cond_t    wait_for_messages;
+  QueElem          elem;        // na tabela da caixa; a chave e' a origem
+  QueTab           filas;
+  int              ocupadas;    // mensagens em fila, com buffer
+  QueHead          *envios_pendentes;
 } Channel_t;
 
+typedef struct caixa_t {
+  pthread_mutex_t  mutex;
+  QueTab           canais;      // Channel_t, pela origem
+  QueTab           filas;       // rececoes de qualquer origem
+  unsigned long    ordem;       // numera as rececoes registadas
+} Caixa_t;
+
+// quem espera por um ou mais pedidos
+typedef struct notificador_t {
+  pthread_mutex_t   mutex;
+  pthread_cond_t    cond;
+  int               sinal;
+} Notificador_t;
+
+typedef struct pedido_t {
+  QueElem          elem;        // numa fila de rececoes ou de envios
+  Caixa_t          *caixa;
+  Message_t        *mess;       // envio pendente com buffer
+  void             *buffer;     // rececao: destino e tamanho maximo
+  long             tamanho;
+  long             feito;       // bytes transferidos
+  int              completo;
+  Notificador_t    *notificar;
+  unsigned long    ordem;
+  int              *origem;     // rececao: onde por a origem
+} Pedido_t;
+
+// valores iniciais; as tabelas crescem com o uso
+#define NUM_BALDES_CANAL  4
+#define NUM_BALDES_CAIXA  4
+
 
 /*--------------------------------------------------------------------
 | Global Variables
@@ -39,46 +105,52 @@ typedef struct channel_t {
 
 int                channel_capacity;
 int                number_of_tasks;
-Channel_t          **channel_array;
+Caixa_t            *caixas;
 
 /*--------------------------------------------------------------------
   | Function: createChannel
-  | Description: Cria um canal de comunicação com suporte para uma lista
-  | de mensagens e um mutex para síncronização dessa lista.
+  | Description: Cria um canal de comunicação, com a tabela das filas
+  | de mensagens por etiqueta e a lista de envios pendentes.
   ---------------------------------------------------------------------*/
 
-Channel_t* createChannel () {
-  Channel_t     *channel = (Channel_t*) malloc (sizeof(Channel_t));
+Channel_t* createChannel (int orig) {
+  Channel_t     *channel = (Channel_t*) poolAlocar (sizeof(Channel_t));
 
   if (channel == NULL) {
     fprintf(stderr, "\nErro ao criar canal\n");
     exit(1);
   }
 
-  channel->message_list = leQueNewHead();
+  channel->envios_pendentes = leQueNewHead();
 
-  if (channel->message_list == NULL) {
+  if (channel->envios_pendentes == NULL ||
+      leQueTabInit(&channel->filas, NUM_BALDES_CANAL) != 0) {
     fprintf(stderr, "\nErro ao criar lista de mensagens\n");
     exit(1);
   }
 
-  if(pthread_mutex_init(&(channel->mutex), NULL) != 0) {
-    fprintf(stderr, "\nErro ao inicializar mutex\n");
-    exit(1);
-  }
+  leQueElemInit (channel);
+  leQueSetKey (channel, orig);
+  leQueHeadInit (channel->envios_pendentes, 0);
+  channel->ocupadas = 0;
 
-  if(pthread_cond_init(&(channel->wait_for_free_space), NULL) != 0) {
-    fprintf(stderr, "\nErro ao inicializar variável de condição\n");
-    exit(1);
-  }
+  return channel;
+}
 
-  if(pthread_cond_init(&(channel->wait_for_messages), NULL) != 0){
-    fprintf(stderr, "\nErro ao inicializar variável de condição\n");
-    exit(1);
-  }
+/*--------------------------------------------------------------------
+  | Function: obterCanal
+  | Description: Canal orig->dest, criado no primeiro uso. Chamada com
+  | o mutex da caixa de dest.
+  ---------------------------------------------------------------------*/
 
-  leQueHeadInit (channel->message_list, 0);
+static Channel_t *obterCanal(int tarefaOrig, int tarefaDest) {
+  Caixa_t   *caixa   = &caixas[tarefaDest];
+  Channel_t *channel = (Channel_t*) leQueTabFind(&caixa->canais, tarefaOrig);
 
+  if (channel == NULL) {
+    channel = createChannel(tarefaOrig);
+    leQueTabIns(&caixa->canais, &channel->elem);
+  }
   return channel;
 }
 
@@ -89,29 +161,74 @@ Channel_t* createChannel () {
 
 int inicializarMPlib(int capacidade_de_cada_canal, int ntasks) {
   int           i;
-  Channel_t     *channel;
 
   number_of_tasks  = ntasks;
   channel_capacity = capacidade_de_cada_canal;
-  channel_array    = (Channel_t**) malloc (sizeof(Channel_t*)*ntasks*ntasks);
+  caixas           = (Caixa_t*) malloc (sizeof(Caixa_t)*(size_t)ntasks);
 
-  if (channel_array == NULL) {
+  if (caixas == NULL) {
     fprintf(stderr, "\nErro ao inicializar MPlib\n");
     exit(1);
   }
 
-  for (i = 0; i < ntasks * ntasks; i++) {
-    channel = createChannel();
-    if (channel == NULL)
+  for (i = 0; i < ntasks; i++) {
+    if (pthread_mutex_init(&(caixas[i].mutex), NULL) != 0) {
+      fprintf(stderr, "\nErro ao inicializar mutex\n");
       exit(1);
-
-    channel_array[i] = channel;
+    }
+    if (leQueTabInit(&caixas[i].filas, NUM_BALDES_CAIXA) != 0 ||
+        leQueTabInit(&caixas[i].canais, NUM_BALDES_CAIXA) != 0) {
+      fprintf(stderr, "\nErro ao inicializar MPlib\n");
+      exit(1);
+    }
+    caixas[i].ordem = 0;
   }
 
   return 0;
 }
 
 
+/*--------------------------------------------------------------------
+  | Function: numeroTarefasMP
+  ---------------------------------------------------------------------*/
+
+int numeroTarefasMP() {
+  return number_of_tasks;
+}
+
+
+/*--------------------------------------------------------------------
+  | Function: libertarFilas
+  | Description: Liberta as filas de uma tabela, as rececoes que ainda
+  | la' estao e, se 'mensagens', as mensagens (so' nas do canal, para
+  | que cada uma seja libertada uma vez).
+  ---------------------------------------------------------------------*/
+
+static void libertarFilas(QueTab *tab, int mensagens) {
+  for (int b = 0; b < tab->nbuckets; b++) {
+    QueHead *balde = &tab->buckets[b];
+    Fila_t  *fila;
+
+    while ((fila = (Fila_t*) leQueRemFirst(balde))) {
+      QueHead   *msgs = &fila->mensagens, *recs = &fila->rececoes;
+      Ligacao_t *lig;
+      QueElem   *ped;
+
+      while ((lig = (Ligacao_t*) leQueRemFirst(msgs))) {
+        if (mensagens) {
+          if (channel_capacity > 0)
+            poolLibertar (lig->mess->contents);
+          poolLibertar (lig->mess);
+        }
+      }
+      while ((ped = leQueRemFirst(recs)))
+        poolLibertar (ped);
+      poolLibertar (fila);
+    }
+  }
+  leQueTabFree(tab);
+}
+
 /*--------------------------------------------------------------------
   | Function: libertarMPlib
   | Description: Liberta a memória usada por esta API
@@ -120,118 +237,347 @@ int inicializarMPlib(int capacidade_de_cada_canal, int ntasks) {
 void libertarMPlib() {
   int i;
 
-  for (i = 0; i < number_of_tasks * number_of_tasks; ++i) {
-    Channel_t   *channel = channel_array[i];
-    Message_t   *mess    = (Message_t*) leQueRemFirst(channel->message_list);
-
-    while (mess) {
-      if (channel_capacity > 0)
-        free (mess->contents);
-      free (mess);
-      mess = (Message_t*) leQueRemFirst(channel->message_list);
+  for (i = 0; i < number_of_tasks; i++) {
+    QueTab      *canais = &caixas[i].canais;
+
+    for (int b = 0; b < canais->nbuckets; b++) {
+      QueHead   *balde = &canais->buckets[b];
+      Channel_t *channel;
+
+      while ((channel = (Channel_t*) leQueRemFirst(balde))) {
+        // pedidos nunca concluidos: os handles ficam invalidos
+        Pedido_t    *ped = (Pedido_t*) leQueRemFirst(channel->envios_pendentes);
+        while (ped) {
+          poolLibertar (ped->mess->contents);
+          poolLibertar (ped->mess);
+          poolLibertar (ped);
+          ped = (Pedido_t*) leQueRemFirst(channel->envios_pendentes);
+        }
+
+        libertarFilas(&channel->filas, 1);
+        leQueFreeHead (channel->envios_pendentes);
+        poolLibertar (channel);
+      }
     }
-
-    if(pthread_mutex_destroy(&(channel->mutex)) != 0) {
+    leQueTabFree(canais);
+    libertarFilas(&caixas[i].filas, 0);
+    if (pthread_mutex_destroy(&(caixas[i].mutex)) != 0) {
       fprintf(stderr, "\nErro ao destruir mutex\n");
       exit(1);
     }
+  }
 
-    if(pthread_cond_destroy(&(channel->wait_for_free_space)) != 0) {
-      fprintf(stderr, "\nErro ao destruir variável de condição\n");
-      exit(1);
-    }
+  free (caixas);
+}
+
+
+/*--------------------------------------------------------------------
+  | Function: bloquear / desbloquear
+  ---------------------------------------------------------------------*/
 
-    if(pthread_cond_destroy(&(channel->wait_for_messages)) != 0) {
-      fprintf(stderr, "\nErro ao destruir variável de condição\n");
+static void bloquear(pthread_mutex_t *mutex) {
+  if (pthread_mutex_lock(mutex) != 0) {
+    fprintf(stderr, "\nErro ao bloquear mutex\n");
+    exit(1);
+  }
+}
+
+static void desbloquear(pthread_mutex_t *mutex) {
+  if (pthread_mutex_unlock(mutex) != 0) {
+    fprintf(stderr, "\nErro ao desbloquear mutex\n");
+    exit(1);
+  }
+}
+
+/*--------------------------------------------------------------------
+  | Function: obterFila / largarFila
+  | Description: Fila da etiqueta na tabela, criada se 'criar'; a fila
+  | e' libertada quando fica sem mensagens nem rececoes.
+  ---------------------------------------------------------------------*/
+
+static Fila_t *obterFila(QueTab *tab, int etiqueta, int criar) {
+  Fila_t *fila = (Fila_t*) leQueTabFind(tab, etiqueta);
+
+  if (fila == NULL && criar) {
+    fila = (Fila_t*) poolAlocar (sizeof(Fila_t));
+    if (fila == NULL) {
+      fprintf(stderr, "\nErro ao alocar memória para fila\n");
       exit(1);
     }
-
-    free (channel);
+    QueHead *msgs = &fila->mensagens, *recs = &fila->rececoes;
+    leQueElemInit (fila);
+    leQueSetKey (fila, etiqueta);
+    leQueHeadInit (msgs, 0);
+    leQueHeadInit (recs, 0);
+    fila->tab = tab;
+    leQueTabIns (tab, &fila->elem);
   }
+  return fila;
+}
 
-  free (channel_array);
+static void largarFila(Fila_t *fila) {
+  if (leQueTestEmpty(&fila->mensagens) && leQueTestEmpty(&fila->rececoes)) {
+    leQueTabRem (fila->tab, &fila->elem);
+    poolLibertar (fila);
+  }
 }
 
+/*--------------------------------------------------------------------
+  | Function: novoPedido
+  ---------------------------------------------------------------------*/
+
+static Pedido_t *novoPedido(Caixa_t *caixa, void *buffer, long tamanho) {
+  Pedido_t *ped = (Pedido_t*) poolAlocar (sizeof(Pedido_t));
+
+  if (ped == NULL) {
+    fprintf(stderr, "\nErro ao alocar memória para pedido\n");
+    exit(1);
+  }
+  leQueElemInit (ped);
+  ped->caixa     = caixa;
+  ped->mess      = NULL;
+  ped->buffer    = buffer;
+  ped->tamanho   = tamanho;
+  ped->feito     = 0;
+  ped->completo  = 0;
+  ped->notificar = NULL;
+  ped->ordem     = 0;
+  ped->origem    = NULL;
+  return ped;
+}
 
 /*--------------------------------------------------------------------
-  | Function: receberMensagem
-  | Description: Lê uma mensagem que esteja pendente na lista de
-  | mensagens do canal ou bloqueia a tarefa que chama a função enquanto
-  | não há mensagens para ler.
+  | Function: concluir
+  | Description: Marca o pedido como concluido e acorda quem espera
+  | por ele. Chamada com o mutex da caixa do pedido.
   ---------------------------------------------------------------------*/
 
-int receberMensagem(int tarefaOrig, int tarefaDest, void *buffer, int tamanho) {
-  Channel_t      *channel;
-  Message_t      *mess;
-  int            copysize;
+static void concluir(Pedido_t *ped, long feito) {
+  ped->feito    = feito;
+  ped->completo = 1;
+
+  if (ped->notificar != NULL) {
+    bloquear(&ped->notificar->mutex);
+    ped->notificar->sinal = 1;
+    if (pthread_cond_signal(&ped->notificar->cond) != 0) {
+      fprintf(stderr, "\nErro ao desbloquear variável de condição\n");
+      exit(1);
+    }
+    desbloquear(&ped->notificar->mutex);
+  }
+}
 
-  channel = (Channel_t*) channel_array[tarefaDest*number_of_tasks+tarefaOrig];
+/*--------------------------------------------------------------------
+  | Function: tirarRececao
+  | Description: Retira a rececao mais antiga que aceita uma mensagem
+  | do canal com esta etiqueta, da origem ou de qualquer origem.
+  ---------------------------------------------------------------------*/
 
-  if(pthread_mutex_lock(&(channel->mutex)) != 0) {
-    fprintf(stderr, "\nErro ao bloquear mutex\n");
-    exit(1);
+static Pedido_t *tirarRececao(Caixa_t *caixa, Channel_t *channel, int etiqueta) {
+  Fila_t   *filas[2] = { obterFila(&channel->filas, etiqueta, 0),
+                         obterFila(&caixa->filas, etiqueta, 0) };
+  Pedido_t *rec = NULL;
+  int       k = -1;
+
+  for (int i = 0; i < 2; i++) {
+    Pedido_t *r = filas[i] ? (Pedido_t*) leQueGetFirst(&filas[i]->rececoes) : NULL;
+    if (r != NULL && (rec == NULL || r->ordem < rec->ordem)) {
+      rec = r;
+      k   = i;
+    }
   }
+  if (rec != NULL) {
+    leQueRemElem (&filas[k]->rececoes, &rec->elem);
+    largarFila(filas[k]);
+  }
+  return rec;
+}
 
-  mess    = (Message_t*) leQueRemFirst (channel->message_list);
+/*--------------------------------------------------------------------
+  | Function: tirarEnvio
+  | Description: Retira o envio pendente mais antigo com esta etiqueta
+  | do canal de tarefaOrig ou, com MP_QUALQUER_ORIGEM, de um canal
+  | qualquer da caixa, e poe o canal em *canal. Chamada com o mutex.
+  ---------------------------------------------------------------------*/
 
-  while (!mess) {
-    if(pthread_cond_wait(&(channel->wait_for_messages), &(channel->mutex)) != 0) {
-        fprintf(stderr, "\nErro ao esperar pela variável de condição\n");
-        exit(1);
+static Pedido_t *tirarEnvioCanal(Channel_t *channel, int etiqueta) {
+  QueHead  *pendentes = channel->envios_pendentes;
+  Pedido_t *env = (Pedido_t*) leQueGetFirst(pendentes);
+
+  while (env != NULL && env->mess->etiqueta != etiqueta)
+    env = (Pedido_t*) leQueGetNext(pendentes, &env->elem);
+  if (env != NULL)
+    leQueRemElem (pendentes, &env->elem);
+  return env;
+}
+
+static Pedido_t *tirarEnvio(Caixa_t *caixa, int tarefaOrig, int tarefaDest, int etiqueta,
+                            Channel_t **canal) {
+  Pedido_t *env = NULL;
+
+  if (tarefaOrig != MP_QUALQUER_ORIGEM) {
+    *canal = obterCanal(tarefaOrig, tarefaDest);
+    return tirarEnvioCanal(*canal, etiqueta);
+  }
+  for (int b = 0; env == NULL && b < caixa->canais.nbuckets; b++) {
+    QueHead   *balde = &caixa->canais.buckets[b];
+    Channel_t *channel = (Channel_t*) leQueGetFirst(balde);
+    for (; env == NULL && channel != NULL;
+         channel = (Channel_t*) leQueGetNext(balde, &channel->elem)) {
+      env    = tirarEnvioCanal(channel, etiqueta);
+      *canal = channel;
     }
-    mess = (Message_t*) leQueRemFirst (channel->message_list);
   }
+  return env;
+}
 
-  copysize = (mess->mess_size<tamanho) ? mess->mess_size : tamanho;
-  memcpy(buffer, mess->contents, copysize);
+/*--------------------------------------------------------------------
+  | Function: consumir
+  | Description: Copia a mensagem para a rececao e conclui-a, e tambem
+  | o envio se ainda nao estiver concluido. Se a mensagem estava em
+  | fila com buffer, o lugar libertado passa aos envios pendentes.
+  | Chamada com o mutex.
+  ---------------------------------------------------------------------*/
+
+static void colocar(Caixa_t *caixa, Channel_t *channel, Message_t *mess);
+
+static void consumir(Caixa_t *caixa, Channel_t *channel, Message_t *mess, Pedido_t *rec,
+                     int em_fila) {
+  long copysize = (mess->mess_size < rec->tamanho) ? mess->mess_size : rec->tamanho;
+
+  memcpy(rec->buffer, mess->contents, copysize);
+  if (rec->origem != NULL)
+    *rec->origem = mess->orig;
+  concluir(rec, copysize);
+  if (mess->envio != NULL)
+    concluir(mess->envio, mess->mess_size);
 
   if (channel_capacity > 0) {
-    free(mess->contents);
-    free(mess);
+    poolLibertar(mess->contents);
+    if (em_fila)
+      channel->ocupadas--;
+    while (channel->ocupadas < channel_capacity &&
+           !leQueTestEmpty(channel->envios_pendentes)) {
+      Pedido_t  *env = (Pedido_t*) leQueRemFirst(channel->envios_pendentes);
+      Message_t *m   = env->mess;
+      m->envio  = NULL;
+      env->mess = NULL;
+      concluir(env, env->tamanho);
+      colocar(caixa, channel, m);
+    }
   }
-  else {
-    mess->consumed = 1;
+  poolLibertar(mess);
+}
+
+/*--------------------------------------------------------------------
+  | Function: colocar
+  | Description: Entrega a mensagem a rececao mais antiga que a aceite
+  | ou poe-na nas filas do canal e da caixa. Chamada com o mutex.
+  ---------------------------------------------------------------------*/
+
+static void colocar(Caixa_t *caixa, Channel_t *channel, Message_t *mess) {
+  Pedido_t *rec = tirarRececao(caixa, channel, mess->etiqueta);
+
+  if (rec != NULL) {
+    consumir(caixa, channel, mess, rec, 0);
+    return;
   }
 
-  if (pthread_cond_signal(&(channel->wait_for_free_space)) != 0) {
-    fprintf(stderr, "\nErro ao desbloquear variável de condição\n");
-    exit(1);
+  mess->filas[0] = obterFila(&channel->filas, mess->etiqueta, 1);
+  mess->filas[1] = obterFila(&caixa->filas, mess->etiqueta, 1);
+  for (int i = 0; i < 2; i++) {
+    leQueElemInit (&mess->lig[i]);
+    mess->lig[i].mess = mess;
+    leQueInsLast (&mess->filas[i]->mensagens, &mess->lig[i].elem);
   }
+  if (channel_capacity > 0)
+    channel->ocupadas++;
+}
 
-  if (pthread_mutex_unlock(&(channel->mutex)) != 0) {
-    fprintf(stderr, "\nErro ao desbloquear mutex\n");
-    exit(1);
+/*--------------------------------------------------------------------
+  | Function: receberMensagemEtiqAssinc
+  | Description: Recebe ja' a mensagem mais antiga da origem (ou de
+  | qualquer origem) com esta etiqueta, ou regista o pedido, a
+  | concluir pelo envio que lhe corresponder.
+  ---------------------------------------------------------------------*/
+
+PedidoMP receberMensagemEtiqAssinc(int tarefaOrig, int tarefaDest, int etiqueta,
+                                   void *buffer, long tamanho, int *origem) {
+  Caixa_t        *caixa = &caixas[tarefaDest];
+  Pedido_t       *rec   = novoPedido(caixa, buffer, tamanho);
+  QueTab         *tab;
+  Fila_t         *fila;
+
+  rec->origem = origem;
+  bloquear(&caixa->mutex);
+
+  if (tarefaOrig == MP_QUALQUER_ORIGEM)
+    tab = &caixa->filas;
+  else
+    tab = &obterCanal(tarefaOrig, tarefaDest)->filas;
+
+  fila = obterFila(tab, etiqueta, 0);
+  Ligacao_t *lig = fila ? (Ligacao_t*) leQueGetFirst(&fila->mensagens) : NULL;
+  Channel_t *canal = NULL;
+  Pedido_t  *env = NULL;
+
+  if (lig) {
+    Message_t *mess = lig->mess;
+    for (int i = 0; i < 2; i++) {
+      leQueRemElem (&mess->filas[i]->mensagens, &mess->lig[i].elem);
+      largarFila(mess->filas[i]);
+    }
+    consumir(caixa, obterCanal(mess->orig, tarefaDest), mess, rec, 1);
+  }
+  else if ((env = tirarEnvio(caixa, tarefaOrig, tarefaDest, etiqueta, &canal)) != NULL) {
+    // sem mensagem em fila, um envio pendente (canal cheio) com esta
+    // etiqueta passa 'a frente dos que la' estao, de outras etiquetas
+    Message_t *mess = env->mess;
+    env->mess = NULL;
+    consumir(caixa, canal, mess, rec, 0);
+  }
+  else {
+    fila       = obterFila(tab, etiqueta, 1);
+    rec->ordem = caixa->ordem++;
+    leQueInsLast (&fila->rececoes, &rec->elem);
   }
 
-  return copysize;
+  desbloquear(&caixa->mutex);
+  return rec;
 }
 
 /*--------------------------------------------------------------------
-  | Function: enviarMensagem
-  | Description: Envia uma mensagem pelo canal correspondente caso
-  | não exceda a capacidade do canal. Caso exceda, a tarefa que
-  | chamou a função espera.
+  | Function: enviarMensagemEtiqAssinc
+  | Description: Entrega a mensagem a uma rececao pendente, se houver,
+  | ou poe-na no canal. Com buffer, o conteudo e' copiado e o envio
+  | conclui quando houver espaco no canal ou quando uma rececao da sua
+  | etiqueta o tirar da lista de pendentes; sem buffer, conclui quando
+  | a mensagem for consumida, e ate' la' 'msg' nao pode ser alterada.
   ---------------------------------------------------------------------*/
 
-int enviarMensagem(int tarefaOrig, int tarefaDest, void *msg, int tamanho) {
+PedidoMP enviarMensagemEtiqAssinc(int tarefaOrig, int tarefaDest, int etiqueta,
+                                  void *msg, long tamanho) {
+  Caixa_t       *caixa = &caixas[tarefaDest];
   Channel_t     *channel;
   Message_t     *mess;
+  Pedido_t      *env;
 
-  channel = (Channel_t*) channel_array[tarefaDest*number_of_tasks+tarefaOrig];
-  mess = (Message_t*) malloc (sizeof(Message_t));
+  mess = (Message_t*) poolAlocar (sizeof(Message_t));
+  env  = novoPedido(caixa, msg, tamanho);
 
   if (mess == NULL) {
     fprintf(stderr, "\nErro ao alocar memória para mensagem\n");
     exit(1);
   }
 
-  leQueElemInit (mess);
+  mess->orig      = tarefaOrig;
+  mess->etiqueta  = etiqueta;
   mess->mess_size = tamanho;
+  mess->envio     = env;
 
   // If channels are buffered, copy message to a temporary buffer
   if (channel_capacity > 0) {
-    mess->contents = malloc (tamanho);
-    mess->consumed = 0;
+    mess->contents = poolAlocar (tamanho);
 
     if(mess->contents == NULL) {
       fprintf(stderr, "\nErro ao alocar memória para o conteúdo da mensagem\n");
@@ -243,47 +589,187 @@ int enviarMensagem(int tarefaOrig, int tarefaDest, void *msg, int tamanho) {
   // if channels are not buffered, message will be copied directly from sender to receiver
   else {
     mess->contents = msg;
-    mess->consumed = 0;
   }
 
-  if (pthread_mutex_lock(&(channel->mutex)) != 0) {
-    fprintf(stderr, "\nErro ao bloquear mutex\n");
-    exit(1);
-  }
+  bloquear(&caixa->mutex);
+  channel = obterCanal(tarefaOrig, tarefaDest);
 
-  // if channels are buffered, wait until there is buffer available
-  if (channel_capacity > 0) {
-    while (leQueSize(channel->message_list) >= channel_capacity) {
-      if (pthread_cond_wait(&(channel->wait_for_free_space), &(channel->mutex)) != 0) {
-        fprintf(stderr, "\nErro ao esperar pela variável de condição\n");
-        exit(1);
-      }
+  if (channel_capacity == 0) {
+    colocar(caixa, channel, mess);
+  }
+  else if (leQueTestEmpty(channel->envios_pendentes) &&
+           channel->ocupadas < channel_capacity) {
+    // concluido ja': o pedido pode ser libertado antes da rececao
+    mess->envio = NULL;
+    concluir(env, tamanho);
+    colocar(caixa, channel, mess);
+  }
+  else {
+    // canal cheio: uma rececao ja' registada recebe-o logo; senao fica
+    // pendente ate' uma rececao libertar espaco ou o pedir, atras dos
+    // que ja' la' estao, para manter a ordem
+    Pedido_t *rec = tirarRececao(caixa, channel, etiqueta);
+    if (rec != NULL) {
+      consumir(caixa, channel, mess, rec, 0);
+    } else {
+      env->mess = mess;
+      leQueInsLast (channel->envios_pendentes, env);
     }
   }
 
-  leQueInsLast (channel->message_list, mess);
+  desbloquear(&caixa->mutex);
+  return env;
+}
+
+PedidoMP receberMensagemAssinc(int tarefaOrig, int tarefaDest, void *buffer, long tamanho) {
+  return receberMensagemEtiqAssinc(tarefaOrig, tarefaDest, 0, buffer, tamanho, NULL);
+}
+
+PedidoMP enviarMensagemAssinc(int tarefaOrig, int tarefaDest, void *msg, long tamanho) {
+  return enviarMensagemEtiqAssinc(tarefaOrig, tarefaDest, 0, msg, tamanho);
+}
+
+/*--------------------------------------------------------------------
+  | Function: testarPedido
+  ---------------------------------------------------------------------*/
+
+int testarPedido(PedidoMP *pedido, long *tamanho) {
+  Pedido_t *ped = *pedido;
+  int       completo;
+
+  if (ped == NULL)
+    return 1;
+
+  bloquear(&ped->caixa->mutex);
+  completo = ped->completo;
+  desbloquear(&ped->caixa->mutex);
+
+  if (completo) {
+    if (tamanho != NULL)
+      *tamanho = ped->feito;
+    poolLibertar(ped);
+    *pedido = NULL;
+  }
+  return completo;
+}
+
+/*--------------------------------------------------------------------
+  | Function: esperarQualquer
+  | Description: Regista um notificador em todos os pedidos por
+  | concluir, espera que um deles o assinale e retira-o de todos.
+  ---------------------------------------------------------------------*/
 
-  if (pthread_cond_signal(&(channel->wait_for_messages)) != 0) {
-    fprintf(stderr, "\nErro ao desbloquear variável de condição\n");
+int esperarQualquer(PedidoMP *pedidos, int n, long *tamanho) {
+  Notificador_t notif;
+  int           ativos = 0, feito = -1;
+
+  notif.sinal = 0;
+  if (pthread_mutex_init(&notif.mutex, NULL) != 0 ||
+      pthread_cond_init(&notif.cond, NULL) != 0) {
+    fprintf(stderr, "\nErro ao inicializar notificador\n");
     exit(1);
   }
 
-  // if channels are not buffered, wait for message to be read
-  if (channel_capacity == 0) {
-    while (!mess->consumed) {
-      if(pthread_cond_wait(&(channel->wait_for_free_space), &(channel->mutex)) != 0) {
+  for (int i = 0; i < n && feito < 0; i++) {
+    Pedido_t *ped = pedidos[i];
+    if (ped == NULL)
+      continue;
+    ativos++;
+    bloquear(&ped->caixa->mutex);
+    if (ped->completo)
+      feito = i;
+    else
+      ped->notificar = &notif;
+    desbloquear(&ped->caixa->mutex);
+  }
+
+  if (feito < 0 && ativos > 0) {
+    bloquear(&notif.mutex);
+    while (!notif.sinal) {
+      if (pthread_cond_wait(&notif.cond, &notif.mutex) != 0) {
         fprintf(stderr, "\nErro ao esperar pela variável de condição\n");
         exit(1);
       }
-
     }
-    free(mess);
+    desbloquear(&notif.mutex);
   }
 
-  if(pthread_mutex_unlock(&(channel->mutex)) != 0) {
-    fprintf(stderr, "\nErro ao desbloquear mutex\n");
-    exit(1);
+  // depois disto nenhum canal volta a tocar no notificador
+  for (int i = 0; i < n; i++) {
+    Pedido_t *ped = pedidos[i];
+    if (ped == NULL)
+      continue;
+    bloquear(&ped->caixa->mutex);
+    ped->notificar = NULL;
+    if (ped->completo && feito < 0)
+      feito = i;
+    desbloquear(&ped->caixa->mutex);
   }
 
+  pthread_cond_destroy(&notif.cond);
+  pthread_mutex_destroy(&notif.mutex);
+
+  if (feito >= 0)
+    testarPedido(&pedidos[feito], tamanho);
+  return feito;
+}
+
+/*--------------------------------------------------------------------
+  | Function: esperarPedido / esperarTodos
+  ---------------------------------------------------------------------*/
+
+long esperarPedido(PedidoMP *pedido) {
+  long tamanho = 0;
+
+  if (*pedido != NULL)
+    esperarQualquer(pedido, 1, &tamanho);
   return tamanho;
 }
+
+void esperarTodos(PedidoMP *pedidos, int n, long *tamanhos) {
+  for (int i = 0; i < n; i++) {
+    long t = esperarPedido(&pedidos[i]);
+    if (tamanhos != NULL)
+      tamanhos[i] = t;
+  }
+}
+
+/*--------------------------------------------------------------------
+  | Function: receberMensagem
+  | Description: Lê uma mensagem que esteja pendente na lista de
+  | mensagens do canal ou bloqueia a tarefa que chama a função enquanto
+  | não há mensagens para ler.
+  ---------------------------------------------------------------------*/
+
+long receberMensagem(int tarefaOrig, int tarefaDest, void *buffer, long tamanho) {
+  PedidoMP rec = receberMensagemAssinc(tarefaOrig, tarefaDest, buffer, tamanho);
+  return esperarPedido(&rec);
+}
+
+/*--------------------------------------------------------------------
+  | Function: enviarMensagem
+  | Description: Envia uma mensagem pelo canal correspondente caso
+  | não exceda a capacidade do canal. Caso exceda, a tarefa que
+  | chamou a função espera.
+  ---------------------------------------------------------------------*/
+
+long enviarMensagem(int tarefaOrig, int tarefaDest, void *msg, long tamanho) {
+  PedidoMP env = enviarMensagemAssinc(tarefaOrig, tarefaDest, msg, tamanho);
+  return esperarPedido(&env);
+}
+
+/*--------------------------------------------------------------------
+  | Function: receberMensagemEtiq / enviarMensagemEtiq
+  ---------------------------------------------------------------------*/
+
+long receberMensagemEtiq(int tarefaOrig, int tarefaDest, int etiqueta, void *buffer,
+                         long tamanho, int *origem) {
+  PedidoMP rec = receberMensagemEtiqAssinc(tarefaOrig, tarefaDest, etiqueta, buffer,
+                                           tamanho, origem);
+  return esperarPedido(&rec);
+}
+
+long enviarMensagemEtiq(int tarefaOrig, int tarefaDest, int etiqueta, void *msg, long tamanho) {
+  PedidoMP env = enviarMensagemEtiqAssinc(tarefaOrig, tarefaDest, etiqueta, msg, tamanho);
+  return esperarPedido(&env);
+}
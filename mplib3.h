@@ -8,8 +8,45 @@
 
 int inicializarMPlib(int capacidade_de_cada_canal, int ntasks);
 void libertarMPlib();
+int  numeroTarefasMP();
 
-int receberMensagem(int tarefaOrig, int tarefaDest, void *buffer, int tamanho);
-int enviarMensagem(int tarefaOrig, int tarefaDest, void *msg, int tamanho);
+// tamanhos em bytes, de 64 bits: uma linha da matriz pode ter mais
+// de 2GB
+long receberMensagem(int tarefaOrig, int tarefaDest, void *buffer, long tamanho);
+long enviarMensagem(int tarefaOrig, int tarefaDest, void *msg, long tamanho);
+
+// Pedidos assincronos. Cada envio ou rececao devolve um pedido, que se
+// conclui com testarPedido (nao bloqueia) ou esperarPedido,
+// esperarTodos ou esperarQualquer. Estes libertam o pedido concluido e
+// poem o handle a NULL; os NULL sao ignorados. Ate' o pedido concluir,
+// o buffer da rececao nao pode ser lido nem, sem buffer nos canais, o
+// do envio alterado. As mensagens de cada canal chegam pela ordem dos
+// envios, e as rececoes sao servidas pela ordem em que foram feitas.
+typedef struct pedido_t *PedidoMP;
+
+PedidoMP receberMensagemAssinc(int tarefaOrig, int tarefaDest, void *buffer, long tamanho);
+PedidoMP enviarMensagemAssinc(int tarefaOrig, int tarefaDest, void *msg, long tamanho);
+int      testarPedido(PedidoMP *pedido, long *tamanho);
+long     esperarPedido(PedidoMP *pedido);
+void     esperarTodos(PedidoMP *pedidos, int n, long *tamanhos);
+// devolve o indice do pedido concluido, ou -1 se forem todos NULL
+int      esperarQualquer(PedidoMP *pedidos, int n, long *tamanho);
+
+// Mensagens com etiqueta. A rececao aceita so' mensagens com a mesma
+// etiqueta, da origem dada ou, com MP_QUALQUER_ORIGEM, de qualquer
+// uma; nesse caso a origem fica em *origem (se nao for NULL). Entre
+// mensagens da mesma origem e etiqueta mantem-se a ordem; a capacidade
+// do canal conta as mensagens de todas as etiquetas. As funcoes sem
+// etiqueta usam a etiqueta 0.
+#define MP_QUALQUER_ORIGEM (-1)
+
+PedidoMP receberMensagemEtiqAssinc(int tarefaOrig, int tarefaDest, int etiqueta,
+                                   void *buffer, long tamanho, int *origem);
+PedidoMP enviarMensagemEtiqAssinc(int tarefaOrig, int tarefaDest, int etiqueta,
+                                  void *msg, long tamanho);
+long     receberMensagemEtiq(int tarefaOrig, int tarefaDest, int etiqueta, void *buffer,
+                             long tamanho, int *origem);
+long     enviarMensagemEtiq(int tarefaOrig, int tarefaDest, int etiqueta, void *msg,
+                            long tamanho);
 
 #endif
@@ -0,0 +1,151 @@
+/*
+// Publicacao do campo em memoria partilhada, para leitores externos
+// Sistemas Operativos, DEI/IST/ULisboa 2017-18
+*/
+
+#include "partilha.h"
+#include "campopartilhado.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/*--------------------------------------------------------------------
+| Global variables
+---------------------------------------------------------------------*/
+
+static CampoCabecalho *cabecalho = NULL;
+static size_t          tamanho;
+static int             periodo_partilha;
+static int             iteracoes_max;
+static double          delta_max;
+static int             trabalhadoras;
+static int             proximo;            // slot a escrever a seguir
+static int             pendente = -1;      // slot aberto, ou -1
+static int             iteracao_pendente;
+static int             faltam;             // trabalhadoras que ainda nao copiaram
+
+static CampoSlot *slot_escrita(int s) {
+  return (CampoSlot*) campoSlot(cabecalho, s);
+}
+
+/*--------------------------------------------------------------------
+| Function: abrir_slot / fechar_slot
+| Description: Metades de escrita do seqlock. Os leitores que virem
+|              'seq' impar, ou diferente no fim, repetem a leitura.
+---------------------------------------------------------------------*/
+
+static CampoSlot *abrir_slot(int iteracoes, double delta) {
+  CampoSlot *s = slot_escrita(proximo);
+
+  __atomic_store_n(&s->seq, s->seq + 1, __ATOMIC_RELAXED);
+  // os dados so' podem ser escritos depois de 'seq' ficar impar
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  s->iteracao = iteracoes;
+  s->delta    = delta;
+  return s;
+}
+
+static void fechar_slot(CampoSlot *s) {
+  __atomic_store_n(&s->seq, s->seq + 1, __ATOMIC_RELEASE);
+  __atomic_store_n(&cabecalho->ultimo, (uint32_t) proximo, __ATOMIC_RELEASE);
+  __atomic_store_n(&cabecalho->publicacoes, cabecalho->publicacoes + 1, __ATOMIC_RELEASE);
+  proximo = (proximo + 1) % cabecalho->nslots;
+}
+
+/*--------------------------------------------------------------------
+| Function: partilhaIniciar
+---------------------------------------------------------------------*/
+
+int partilhaIniciar(char const *nome, DoubleMatrix2D *inicial, int periodo, int nslots,
+                    int iter_max, double maxD, int trab) {
+  size_t dados    = sizeof(double) * (size_t) inicial->n_l * inicial->n_c;
+  size_t tam_slot = sizeof(CampoSlot) + (dados + 63) / 64 * 64;
+  int    fd;
+
+  // um leitor antigo fica com o segmento anterior, ja' terminado
+  shm_unlink(nome);
+  fd = shm_open(nome, O_CREAT | O_EXCL | O_RDWR, 0644);
+  if (fd < 0)
+    return -1;
+  tamanho = sizeof(CampoCabecalho) + nslots * tam_slot;
+  if (ftruncate(fd, tamanho) != 0) {
+    close(fd);
+    shm_unlink(nome);
+    return -1;
+  }
+  cabecalho = (CampoCabecalho*) mmap(NULL, tamanho, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (cabecalho == MAP_FAILED) {
+    cabecalho = NULL;
+    shm_unlink(nome);
+    return -1;
+  }
+
+  // o segmento novo vem a zeros
+  cabecalho->linhas   = inicial->n_l;
+  cabecalho->colunas  = inicial->n_c;
+  cabecalho->nslots   = nslots;
+  cabecalho->periodo  = periodo;
+  cabecalho->tam_slot = tam_slot;
+  cabecalho->versao   = CAMPO_VERSAO;
+  __atomic_store_n(&cabecalho->magia, CAMPO_MAGIA, __ATOMIC_RELEASE);
+
+  periodo_partilha = periodo;
+  iteracoes_max    = iter_max;
+  delta_max        = maxD;
+  trabalhadoras    = trab;
+  proximo          = 0;
+  pendente         = -1;
+
+  CampoSlot *s = abrir_slot(0, 0);
+  memcpy(s + 1, inicial->data, dados);
+  fechar_slot(s);
+  return 0;
+}
+
+/*--------------------------------------------------------------------
+| Function: partilhaReservar
+---------------------------------------------------------------------*/
+
+void partilhaReservar(int iteracoes, double delta, int ultima) {
+  pendente = -1;
+  if (cabecalho == NULL)
+    return;
+  if (iteracoes % periodo_partilha != 0 && iteracoes < iteracoes_max && delta >= delta_max &&
+      !ultima)
+    return;
+
+  // as copias da publicacao anterior acabaram antes desta barreira
+  abrir_slot(iteracoes, delta);
+  faltam            = trabalhadoras;
+  iteracao_pendente = iteracoes;
+  pendente          = proximo;
+}
+
+/*--------------------------------------------------------------------
+| Function: partilhaCopiar
+---------------------------------------------------------------------*/
+
+void partilhaCopiar(int iteracoes, DoubleMatrix2D *m, int lo, int hi) {
+  if (pendente < 0 || iteracao_pendente != iteracoes)
+    return;
+
+  CampoSlot *s = slot_escrita(pendente);
+  double    *d = (double*) (s + 1);
+
+  memcpy(&d[(long) lo * m->n_c], dm2dGetLine(m, lo), sizeof(double) * (size_t) (hi - lo) * m->n_c);
+  if (__atomic_sub_fetch(&faltam, 1, __ATOMIC_ACQ_REL) == 0)
+    fechar_slot(s);
+}
+
+/*--------------------------------------------------------------------
+| Function: partilhaParar
+---------------------------------------------------------------------*/
+
+void partilhaParar(void) {
+  if (cabecalho == NULL)
+    return;
+  __atomic_store_n(&cabecalho->terminado, 1, __ATOMIC_RELEASE);
+  munmap(cabecalho, tamanho);
+  cabecalho = NULL;
+}
@@ -0,0 +1,51 @@
+/*
+// Publicacao do campo em memoria partilhada, para leitores externos
+// Sistemas Operativos, DEI/IST/ULisboa 2017-18
+//
+// O formato do segmento e a forma de o ler estao em campopartilhado.h.
+*/
+
+#ifndef PARTILHA_H
+#define PARTILHA_H
+
+#include "matrix2d.h"
+
+/*--------------------------------------------------------------------
+| Function: partilhaIniciar
+| Description: Cria o segmento 'nome' (substituindo um anterior) com
+|              'nslots' slots e publica 'inicial' como iteracao 0.
+|              Publica de 'periodo' em 'periodo' iteracoes e tambem a
+|              ultima, reconhecida por 'iter_max' e 'maxD'. 'trab' e'
+|              o numero de trabalhadoras que copiam cada publicacao.
+|              Devolve 0 em caso de sucesso.
+---------------------------------------------------------------------*/
+int  partilhaIniciar(char const *nome, DoubleMatrix2D *inicial, int periodo, int nslots,
+                     int iter_max, double maxD, int trab);
+
+/*--------------------------------------------------------------------
+| Function: partilhaReservar
+| Description: Chamada na barreira no fim de cada iteracao. Se houver
+|              publicacao, abre a escrita do slot seguinte. 'ultima'
+|              indica que a simulacao para nesta iteracao antes de
+|              iter_max e maxD (prazo ou SIGINT), e tambem a publica.
+---------------------------------------------------------------------*/
+void partilhaReservar(int iteracoes, double delta, int ultima);
+
+/*--------------------------------------------------------------------
+| Function: partilhaCopiar
+| Description: Chamada por cada trabalhadora logo depois da barreira
+|              da iteracao 'iteracoes': copia as linhas [lo, hi[ de
+|              'm' para o slot aberto. A ultima a copiar fecha-o e
+|              torna-o o mais recente.
+---------------------------------------------------------------------*/
+void partilhaCopiar(int iteracoes, DoubleMatrix2D *m, int lo, int hi);
+
+/*--------------------------------------------------------------------
+| Function: partilhaParar
+| Description: Marca o campo como terminado e desmapeia-o. O segmento
+|              fica, com a ultima publicacao, ate' ao proximo heatSim
+|              com o mesmo nome (ou shm_unlink).
+---------------------------------------------------------------------*/
+void partilhaParar(void);
+
+#endif
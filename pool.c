@@ -0,0 +1,237 @@
+/*
+// Reserva de memoria por classes de tamanho, com uma cache por tarefa
+// Sistemas Operativos, DEI/IST/ULisboa 2017-18
+*/
+
+#include "pool.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#define NUM_CLASSES  13           // blocos de 16 a 65536 bytes
+#define MIN_CLASSE   16
+#define TAM_LAJE     (64 * 1024)
+#define MIN_BLOCOS   4            // por laje, nas classes grandes
+
+struct cache_t;
+
+// antes de cada bloco; 16 bytes, para manter o alinhamento
+typedef struct {
+  struct cache_t *dono;           // NULL nos blocos grandes
+  long            classe;
+} __attribute__((aligned(16))) Cabecalho_t;
+
+// um bloco livre guarda o seguinte da lista no lugar dos dados
+typedef struct livre_t {
+  struct livre_t *seguinte;
+} Livre_t;
+
+typedef struct cache_t {
+  Livre_t        *livres[NUM_CLASSES];
+  Livre_t        *devolvidos;     // pilha, libertados por outras tarefas
+  struct cache_t *seguinte;       // na lista de todas as caches
+  int             orfa;           // a tarefa terminou
+  unsigned long   alocacoes;      // so' a dona escreve os contadores
+  unsigned long   libertacoes;
+  unsigned long   remotas;
+  unsigned long   reservas;
+  size_t          bytes;
+} Cache_t;
+
+
+/*--------------------------------------------------------------------
+| Global Variables
+---------------------------------------------------------------------*/
+
+static pthread_mutex_t  mutex_caches = PTHREAD_MUTEX_INITIALIZER;
+static Cache_t         *todas_caches = NULL;
+static pthread_key_t    chave_cache;
+static pthread_once_t   chave_criada = PTHREAD_ONCE_INIT;
+static __thread Cache_t *cache_local = NULL;
+
+// lidos por poolEstatisticas noutra tarefa, dai' os acessos atomicos
+#define CONTAR(c, campo, n) \
+  __atomic_store_n(&(c)->campo, __atomic_load_n(&(c)->campo, __ATOMIC_RELAXED) + (n), \
+                   __ATOMIC_RELAXED)
+
+/*--------------------------------------------------------------------
+| Function: largar_cache
+| Description: Destrutor da chave: a cache de uma tarefa que termina
+|              fica 'a espera da proxima, com os seus blocos
+---------------------------------------------------------------------*/
+
+static void largar_cache(void *arg) {
+  Cache_t *c = (Cache_t*) arg;
+
+  pthread_mutex_lock(&mutex_caches);
+  c->orfa = 1;
+  pthread_mutex_unlock(&mutex_caches);
+}
+
+static void criar_chave(void) {
+  if (pthread_key_create(&chave_cache, largar_cache) != 0) {
+    fprintf(stderr, "\nErro ao criar chave do pool\n");
+    exit(1);
+  }
+}
+
+/*--------------------------------------------------------------------
+| Function: obter_cache
+| Description: Cache desta tarefa: uma orfa, se houver, ou uma nova
+---------------------------------------------------------------------*/
+
+static Cache_t *obter_cache(void) {
+  Cache_t *c;
+
+  if (cache_local != NULL)
+    return cache_local;
+
+  pthread_once(&chave_criada, criar_chave);
+  pthread_mutex_lock(&mutex_caches);
+  for (c = todas_caches; c != NULL && !c->orfa; c = c->seguinte)
+    ;
+  if (c == NULL) {
+    c = (Cache_t*) calloc(1, sizeof(Cache_t));
+    if (c == NULL) {
+      fprintf(stderr, "\nErro ao alocar cache do pool\n");
+      exit(1);
+    }
+    c->seguinte  = todas_caches;
+    todas_caches = c;
+  }
+  c->orfa = 0;
+  pthread_mutex_unlock(&mutex_caches);
+
+  pthread_setspecific(chave_cache, c);
+  cache_local = c;
+  return c;
+}
+
+/*--------------------------------------------------------------------
+| Function: recolher_devolvidos
+| Description: Passa a pilha de devolvidos para as listas livres
+---------------------------------------------------------------------*/
+
+static void recolher_devolvidos(Cache_t *c) {
+  Livre_t *l = __atomic_exchange_n(&c->devolvidos, NULL, __ATOMIC_ACQUIRE);
+
+  while (l != NULL) {
+    Livre_t     *seg = l->seguinte;
+    Cabecalho_t *cab = (Cabecalho_t*) l - 1;
+    l->seguinte = c->livres[cab->classe];
+    c->livres[cab->classe] = l;
+    l = seg;
+  }
+}
+
+/*--------------------------------------------------------------------
+| Function: nova_laje
+| Description: Reserva uma laje da classe k e poe os blocos na lista
+|              livre. Devolve -1 se o malloc falhar.
+---------------------------------------------------------------------*/
+
+static int nova_laje(Cache_t *c, int k) {
+  size_t bloco = sizeof(Cabecalho_t) + ((size_t) MIN_CLASSE << k);
+  size_t n     = TAM_LAJE / bloco < MIN_BLOCOS ? MIN_BLOCOS : TAM_LAJE / bloco;
+  char  *laje  = (char*) malloc(n * bloco);
+
+  if (laje == NULL)
+    return -1;
+  for (size_t i = n; i-- > 0; ) {
+    Cabecalho_t *cab = (Cabecalho_t*) (laje + i * bloco);
+    Livre_t     *l   = (Livre_t*) (cab + 1);
+    cab->dono   = c;
+    cab->classe = k;
+    l->seguinte = c->livres[k];
+    c->livres[k] = l;
+  }
+  CONTAR(c, reservas, 1);
+  CONTAR(c, bytes, n * bloco);
+  return 0;
+}
+
+/*--------------------------------------------------------------------
+| Function: poolAlocar
+---------------------------------------------------------------------*/
+
+void *poolAlocar(size_t tam) {
+  Cache_t *c = obter_cache();
+  int      k = 0;
+
+  CONTAR(c, alocacoes, 1);
+  if (tam > POOL_MAX_BLOCO) {
+    Cabecalho_t *cab = (Cabecalho_t*) malloc(sizeof(Cabecalho_t) + tam);
+    if (cab == NULL)
+      return NULL;
+    cab->dono   = NULL;
+    cab->classe = -1;
+    CONTAR(c, reservas, 1);
+    return cab + 1;
+  }
+
+  while (((size_t) MIN_CLASSE << k) < tam)
+    k++;
+  if (c->livres[k] == NULL)
+    recolher_devolvidos(c);
+  if (c->livres[k] == NULL && nova_laje(c, k) != 0)
+    return NULL;
+
+  Livre_t *l = c->livres[k];
+  c->livres[k] = l->seguinte;
+  return l;
+}
+
+/*--------------------------------------------------------------------
+| Function: poolLibertar
+---------------------------------------------------------------------*/
+
+void poolLibertar(void *p) {
+  Cache_t     *c;
+  Cabecalho_t *cab;
+  Livre_t     *l = (Livre_t*) p;
+
+  if (p == NULL)
+    return;
+  c   = obter_cache();
+  cab = (Cabecalho_t*) p - 1;
+  CONTAR(c, libertacoes, 1);
+
+  if (cab->dono == NULL) {
+    free(cab);
+  }
+  else if (cab->dono == c) {
+    l->seguinte = c->livres[cab->classe];
+    c->livres[cab->classe] = l;
+  }
+  else {
+    // empilha nos devolvidos da dona; ela so' os retira todos de uma vez
+    Cache_t *dono = cab->dono;
+    l->seguinte = __atomic_load_n(&dono->devolvidos, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&dono->devolvidos, &l->seguinte, l, 1,
+                                        __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+      ;
+    CONTAR(c, remotas, 1);
+  }
+}
+
+/*--------------------------------------------------------------------
+| Function: poolEstatisticas
+---------------------------------------------------------------------*/
+
+void poolEstatisticas(EstatPool *e) {
+  e->alocacoes = e->libertacoes = e->remotas = e->reservas = 0;
+  e->bytes  = 0;
+  e->caches = 0;
+
+  pthread_mutex_lock(&mutex_caches);
+  for (Cache_t *c = todas_caches; c != NULL; c = c->seguinte) {
+    e->alocacoes   += __atomic_load_n(&c->alocacoes, __ATOMIC_RELAXED);
+    e->libertacoes += __atomic_load_n(&c->libertacoes, __ATOMIC_RELAXED);
+    e->remotas     += __atomic_load_n(&c->remotas, __ATOMIC_RELAXED);
+    e->reservas    += __atomic_load_n(&c->reservas, __ATOMIC_RELAXED);
+    e->bytes       += __atomic_load_n(&c->bytes, __ATOMIC_RELAXED);
+    e->caches++;
+  }
+  pthread_mutex_unlock(&mutex_caches);
+}
@@ -0,0 +1,55 @@
+/*
+// Reserva de memoria por classes de tamanho, com uma cache por tarefa
+// Sistemas Operativos, DEI/IST/ULisboa 2017-18
+//
+// Os blocos pequenos (ate' POOL_MAX_BLOCO bytes) sao tirados de lajes
+// de uma classe de tamanho (potencias de 2 a partir de 16) e cada um
+// pertence a cache da tarefa que o reservou. Quem o liberta devolve-o
+// 'a lista livre da dona: sem sincronizacao, se for a propria dona, ou
+// pela pilha de devolvidos da dona (sem trincos), que esta' recolhe
+// quando a sua lista fica vazia. As lajes nunca sao devolvidas ao
+// sistema; a cache de uma tarefa que termina passa 'a seguinte que
+// comecar a usar o pool. Os blocos maiores vao direitos ao malloc.
+*/
+
+#ifndef POOL_H
+#define POOL_H
+
+#include <stddef.h>
+
+#define POOL_MAX_BLOCO  65536
+
+/*--------------------------------------------------------------------
+| Type: EstatPool
+| Description: Contadores somados sobre todas as caches; aproximados
+|              enquanto outras tarefas estao a usar o pool
+---------------------------------------------------------------------*/
+
+typedef struct {
+  unsigned long alocacoes;     // blocos pedidos
+  unsigned long libertacoes;   // blocos devolvidos
+  unsigned long remotas;       // devolvidos por outra tarefa que nao a dona
+  unsigned long reservas;      // chamadas ao malloc (lajes e blocos grandes)
+  size_t        bytes;         // total reservado em lajes
+  int           caches;
+} EstatPool;
+
+/*--------------------------------------------------------------------
+| Function: poolAlocar
+| Description: Bloco de pelo menos 'tam' bytes, alinhado a 16, ou NULL
+---------------------------------------------------------------------*/
+void *poolAlocar(size_t tam);
+
+/*--------------------------------------------------------------------
+| Function: poolLibertar
+| Description: Devolve um bloco de poolAlocar, de qualquer tarefa.
+|              Aceita NULL.
+---------------------------------------------------------------------*/
+void  poolLibertar(void *p);
+
+/*--------------------------------------------------------------------
+| Function: poolEstatisticas
+---------------------------------------------------------------------*/
+void  poolEstatisticas(EstatPool *e);
+
+#endif
@@ -0,0 +1,141 @@
+/*
+// Formas reduzidas de escrever o resultado
+// Sistemas Operativos, DEI/IST/ULisboa 2017-18
+*/
+
+#include "saida.h"
+
+#include <string.h>
+
+/*--------------------------------------------------------------------
+| Function: saidaModoPorNome
+---------------------------------------------------------------------*/
+
+int saidaModoPorNome(char const *nome, ModoSaida *modo) {
+  if (strcmp(nome, "completa") == 0)
+    *modo = SAIDA_COMPLETA;
+  else if (strcmp(nome, "regiao") == 0)
+    *modo = SAIDA_REGIAO;
+  else if (strcmp(nome, "amostra") == 0)
+    *modo = SAIDA_AMOSTRA;
+  else if (strcmp(nome, "estatisticas") == 0)
+    *modo = SAIDA_ESTATISTICAS;
+  else
+    return -1;
+  return 0;
+}
+
+/*--------------------------------------------------------------------
+| Function: saidaRegiao
+---------------------------------------------------------------------*/
+
+void saidaRegiao(FILE *f, DoubleMatrix2D *m, int l0, int c0, int l1, int c1) {
+  if (l0 < 0) l0 = 0;
+  if (c0 < 0) c0 = 0;
+  if (l1 > m->n_l) l1 = m->n_l;
+  if (c1 > m->n_c) c1 = m->n_c;
+
+  fprintf (f, "\n");
+  for (int i = l0; i < l1; i++) {
+    for (int j = c0; j < c1; j++)
+      fprintf(f, " %8.4f", dm2dGetEntry(m, i, j));
+    fprintf (f, "\n");
+  }
+}
+
+/*--------------------------------------------------------------------
+| Function: saidaAmostra
+---------------------------------------------------------------------*/
+
+void saidaAmostra(FILE *f, DoubleMatrix2D *m, int tam) {
+  // lado de cada bloco, arredondado para cima
+  int bl = (m->n_l + tam - 1) / tam;
+  int bc = (m->n_c + tam - 1) / tam;
+
+  fprintf (f, "\n");
+  for (int i = 0; i < m->n_l; i += bl) {
+    int fi = i + bl < m->n_l ? i + bl : m->n_l;
+    for (int j = 0; j < m->n_c; j += bc) {
+      int    fj   = j + bc < m->n_c ? j + bc : m->n_c;
+      double soma = 0;
+      for (int a = i; a < fi; a++)
+        for (int b = j; b < fj; b++)
+          soma += dm2dGetEntry(m, a, b);
+      fprintf(f, " %8.4f", soma / ((fi - i) * (fj - j)));
+    }
+    fprintf (f, "\n");
+  }
+}
+
+/*--------------------------------------------------------------------
+| Function: estatParcial
+---------------------------------------------------------------------*/
+
+void estatParcial(DoubleMatrix2D *m, int l0, int l1, int c0, int c1, Estatisticas *e) {
+  double min = dm2dGetEntry(m, l0, c0), max = min, soma = 0;
+
+  for (int i = l0; i < l1; i++) {
+    double *linha = dm2dGetLine(m, i);
+    for (int j = c0; j < c1; j++) {
+      double v = linha[j];
+      min = v < min ? v : min;
+      max = v > max ? v : max;
+      soma += v;
+    }
+  }
+  e->min  = min;
+  e->max  = max;
+  e->soma = soma;
+  e->n    = (long) (l1 - l0) * (c1 - c0);
+}
+
+/*--------------------------------------------------------------------
+| Function: estatHistograma
+---------------------------------------------------------------------*/
+
+void estatHistograma(DoubleMatrix2D *m, int l0, int l1, int c0, int c1,
+                     double min, double max, Estatisticas *e) {
+  double escala = max > min ? e->nbins / (max - min) : 0;
+
+  for (int i = l0; i < l1; i++) {
+    double *linha = dm2dGetLine(m, i);
+    for (int j = c0; j < c1; j++) {
+      int b = (int) ((linha[j] - min) * escala);
+      if (b >= e->nbins) b = e->nbins - 1;
+      if (b < 0)         b = 0;
+      e->hist[b]++;
+    }
+  }
+}
+
+/*--------------------------------------------------------------------
+| Function: estatJuntar
+---------------------------------------------------------------------*/
+
+void estatJuntar(Estatisticas *total, Estatisticas const *parcial) {
+  if (parcial->n == 0)
+    return;
+  if (total->n == 0 || parcial->min < total->min)
+    total->min = parcial->min;
+  if (total->n == 0 || parcial->max > total->max)
+    total->max = parcial->max;
+  total->soma += parcial->soma;
+  total->n    += parcial->n;
+  for (int b = 0; b < total->nbins && b < parcial->nbins; b++)
+    total->hist[b] += parcial->hist[b];
+}
+
+/*--------------------------------------------------------------------
+| Function: saidaEstatisticas
+---------------------------------------------------------------------*/
+
+void saidaEstatisticas(FILE *f, Estatisticas const *e) {
+  double largura = (e->max - e->min) / e->nbins;
+
+  fprintf(f, "pontos=%ld\nmin=%.6f\nmax=%.6f\nmedia=%.6f\n",
+          e->n, e->min, e->max, e->n > 0 ? e->soma / e->n : 0);
+  fprintf(f, "histograma:\n");
+  for (int b = 0; b < e->nbins; b++)
+    fprintf(f, "  [%10.4f, %10.4f%c %ld\n", e->min + b * largura, e->min + (b + 1) * largura,
+            b == e->nbins - 1 ? ']' : '[', e->hist[b]);
+}
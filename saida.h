@@ -0,0 +1,78 @@
+/*
+// Formas reduzidas de escrever o resultado
+// Sistemas Operativos, DEI/IST/ULisboa 2017-18
+*/
+
+#ifndef SAIDA_H
+#define SAIDA_H
+
+#include <stdio.h>
+#include "matrix2d.h"
+
+/*--------------------------------------------------------------------
+| Type: ModoSaida
+| Description: O que escrever no fim da simulacao
+---------------------------------------------------------------------*/
+
+typedef enum {
+  SAIDA_COMPLETA,
+  SAIDA_REGIAO,
+  SAIDA_AMOSTRA,
+  SAIDA_ESTATISTICAS
+} ModoSaida;
+
+/*--------------------------------------------------------------------
+| Type: Estatisticas
+| Description: Resumo de um conjunto de pontos. 'hist' tem 'nbins'
+|              contadores sobre [min, max].
+---------------------------------------------------------------------*/
+
+typedef struct {
+  double  min;
+  double  max;
+  double  soma;
+  long    n;
+  int     nbins;
+  long   *hist;
+} Estatisticas;
+
+int  saidaModoPorNome(char const *nome, ModoSaida *modo);
+
+/*--------------------------------------------------------------------
+| Function: saidaRegiao
+| Description: Escreve as linhas [l0, l1[ e colunas [c0, c1[, no
+|              mesmo formato de dm2dPrint
+---------------------------------------------------------------------*/
+void saidaRegiao(FILE *f, DoubleMatrix2D *m, int l0, int c0, int l1, int c1);
+
+/*--------------------------------------------------------------------
+| Function: saidaAmostra
+| Description: Escreve uma versao reduzida da matriz com no maximo
+|              'tam' x 'tam' pontos, cada um a media de um bloco
+---------------------------------------------------------------------*/
+void saidaAmostra(FILE *f, DoubleMatrix2D *m, int tam);
+
+/*--------------------------------------------------------------------
+| Function: estatParcial
+| Description: Minimo, maximo e soma das linhas [l0, l1[ e colunas
+|              [c0, c1[ de m. Nao mexe no histograma.
+---------------------------------------------------------------------*/
+void estatParcial(DoubleMatrix2D *m, int l0, int l1, int c0, int c1, Estatisticas *e);
+
+/*--------------------------------------------------------------------
+| Function: estatHistograma
+| Description: Acumula em e->hist o histograma das linhas [l0, l1[ e
+|              colunas [c0, c1[ de m, com bins sobre [min, max]
+---------------------------------------------------------------------*/
+void estatHistograma(DoubleMatrix2D *m, int l0, int l1, int c0, int c1,
+                     double min, double max, Estatisticas *e);
+
+/*--------------------------------------------------------------------
+| Function: estatJuntar
+| Description: Junta 'parcial' em 'total' (min, max, soma, n e hist)
+---------------------------------------------------------------------*/
+void estatJuntar(Estatisticas *total, Estatisticas const *parcial);
+
+void saidaEstatisticas(FILE *f, Estatisticas const *e);
+
+#endif
@@ -0,0 +1,177 @@
+/*
+// Cache de solucoes base para sobreposicao das fronteiras
+// Sistemas Operativos, DEI/IST/ULisboa 2017-18
+*/
+
+#include "sobreposicao.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static char const *nomes_borda[4] = { "esq", "sup", "dir", "inf" };
+
+/*--------------------------------------------------------------------
+| Type: CabecalhoBase
+---------------------------------------------------------------------*/
+
+typedef struct {
+  char    magico[4];
+  int32_t N;
+  int32_t borda;
+  int32_t iteracoes;
+  double  tolerancia;
+} CabecalhoBase;
+
+/*--------------------------------------------------------------------
+| Type: TarefaCombinar
+---------------------------------------------------------------------*/
+
+typedef struct {
+  DoubleMatrix2D *destino;
+  double        **bases;
+  double const   *coef;
+  long            ini;
+  long            fim;
+} TarefaCombinar;
+
+/*--------------------------------------------------------------------
+| Function: sobreposicaoLimiteErro
+---------------------------------------------------------------------*/
+
+double sobreposicaoLimiteErro(int N, double delta) {
+  double rho = cos(M_PI / (N + 1));
+  return rho / (1 - rho) * N * delta;
+}
+
+static void nome_base(char *buf, size_t tam, char const *dir, int N, int borda) {
+  snprintf(buf, tam, "%s/base_N%d_%s.bin", dir, N, nomes_borda[borda]);
+}
+
+/*--------------------------------------------------------------------
+| Function: sobreposicaoCarregar
+---------------------------------------------------------------------*/
+
+double *sobreposicaoCarregar(char const *dir, int N, int borda, double tol, double *tol_base) {
+  char          nome[512];
+  CabecalhoBase cab;
+  size_t        pontos = (size_t) (N + 2) * (N + 2);
+
+  nome_base(nome, sizeof(nome), dir, N, borda);
+  int fd = open(nome, O_RDONLY);
+  if (fd < 0)
+    return NULL;
+
+  struct stat st;
+  if (read(fd, &cab, sizeof(cab)) != sizeof(cab) || memcmp(cab.magico, "HSSB", 4) != 0 ||
+      cab.N != N || cab.borda != borda || cab.tolerancia > tol ||
+      fstat(fd, &st) != 0 || (size_t) st.st_size != sizeof(cab) + pontos * sizeof(double)) {
+    close(fd);
+    return NULL;
+  }
+
+  // o cabecalho tem 24 bytes, pelo que os dados ficam alinhados a 8
+  char *mapa = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mapa == MAP_FAILED)
+    return NULL;
+
+  *tol_base = cab.tolerancia;
+  return (double*) (mapa + sizeof(cab));
+}
+
+/*--------------------------------------------------------------------
+| Function: sobreposicaoLibertar
+---------------------------------------------------------------------*/
+
+void sobreposicaoLibertar(double *dados, int N) {
+  size_t tam = sizeof(CabecalhoBase) + (size_t) (N + 2) * (N + 2) * sizeof(double);
+  munmap((char*) dados - sizeof(CabecalhoBase), tam);
+}
+
+/*--------------------------------------------------------------------
+| Function: sobreposicaoGuardar
+---------------------------------------------------------------------*/
+
+int sobreposicaoGuardar(char const *dir, int N, int borda, double tol, int iteracoes,
+                        DoubleMatrix2D *m) {
+  char          nome[512], tmp[520];
+  CabecalhoBase cab;
+  size_t        pontos = (size_t) (N + 2) * (N + 2);
+
+  mkdir(dir, 0755);
+  nome_base(nome, sizeof(nome), dir, N, borda);
+  snprintf(tmp, sizeof(tmp), "%s~", nome);
+
+  memcpy(cab.magico, "HSSB", 4);
+  cab.N          = N;
+  cab.borda      = borda;
+  cab.iteracoes  = iteracoes;
+  cab.tolerancia = tol;
+
+  FILE *f = fopen(tmp, "wb");
+  if (f == NULL)
+    return -1;
+  if (fwrite(&cab, sizeof(cab), 1, f) != 1 || fwrite(m->data, sizeof(double), pontos, f) != pontos) {
+    fclose(f);
+    unlink(tmp);
+    return -1;
+  }
+  if (fclose(f) != 0)
+    return -1;
+  return rename(tmp, nome);
+}
+
+/*--------------------------------------------------------------------
+| Function: combinar_linhas
+---------------------------------------------------------------------*/
+
+static void *combinar_linhas(void *arg) {
+  TarefaCombinar *t = (TarefaCombinar*) arg;
+  long            nc = t->destino->n_c;
+
+  for (long i = t->ini * nc; i < t->fim * nc; i++)
+    t->destino->data[i] = t->coef[0] * t->bases[0][i] + t->coef[1] * t->bases[1][i] +
+                          t->coef[2] * t->bases[2][i] + t->coef[3] * t->bases[3][i];
+  return NULL;
+}
+
+/*--------------------------------------------------------------------
+| Function: sobreposicaoCombinar
+---------------------------------------------------------------------*/
+
+void sobreposicaoCombinar(DoubleMatrix2D *destino, double *bases[4], double const coef[4],
+                          int trab) {
+  pthread_t      *tarefas = (pthread_t*) malloc(trab * sizeof(pthread_t));
+  TarefaCombinar *info    = (TarefaCombinar*) malloc(trab * sizeof(TarefaCombinar));
+  long            linhas  = destino->n_l;
+
+  if (tarefas == NULL || info == NULL) {
+    fprintf(stderr, "\nErro ao alocar memoria para tarefas\n");
+    exit(1);
+  }
+
+  for (int i = 0; i < trab; i++) {
+    info[i].destino = destino;
+    info[i].bases   = bases;
+    info[i].coef    = coef;
+    info[i].ini     = linhas * i / trab;
+    info[i].fim     = linhas * (i + 1) / trab;
+    if (pthread_create(&tarefas[i], NULL, combinar_linhas, &info[i]) != 0) {
+      fprintf(stderr, "\nErro ao criar tarefa\n");
+      exit(1);
+    }
+  }
+  for (int i = 0; i < trab; i++)
+    pthread_join(tarefas[i], NULL);
+
+  free(tarefas);
+  free(info);
+}
@@ -0,0 +1,59 @@
+/*
+// Cache de solucoes base para sobreposicao das fronteiras
+// Sistemas Operativos, DEI/IST/ULisboa 2017-18
+//
+// O estado estacionario e' linear nas quatro temperaturas de
+// fronteira: u = tEsq*uE + tSup*uS + tDir*uD + tInf*uI, onde cada
+// solucao base tem uma fronteira a 1 e as restantes a 0. As bases sao
+// guardadas em DIR/base_N<N>_<borda>.bin com o cabecalho
+//   "HSSB", int32 N, int32 borda, int32 iteracoes, double tolerancia
+// seguido de (N+2)*(N+2) doubles.
+*/
+
+#ifndef SOBREPOSICAO_H
+#define SOBREPOSICAO_H
+
+#include "matrix2d.h"
+
+#define BORDA_ESQ 0
+#define BORDA_SUP 1
+#define BORDA_DIR 2
+#define BORDA_INF 3
+
+/*--------------------------------------------------------------------
+| Function: sobreposicaoLimiteErro
+| Description: Limite garantido para o erro maximo de uma iteracao de
+|              Jacobi sobre N x N pontos que parou com delta 'delta':
+|              |e|inf <= |e|2 <= rho/(1-rho) * N * delta, com
+|              rho = cos(pi/(N+1)) o raio espectral
+---------------------------------------------------------------------*/
+double sobreposicaoLimiteErro(int N, double delta);
+
+/*--------------------------------------------------------------------
+| Function: sobreposicaoCarregar
+| Description: Mapeia a base da 'borda' para N em memoria, se existir
+|              com tolerancia <= 'tol'. Devolve o ponteiro para os
+|              dados (a libertar com sobreposicaoLibertar) ou NULL.
+|              A tolerancia da base fica em *tol_base.
+---------------------------------------------------------------------*/
+double *sobreposicaoCarregar(char const *dir, int N, int borda, double tol, double *tol_base);
+
+/*--------------------------------------------------------------------
+| Function: sobreposicaoGuardar
+| Description: Guarda a matriz 'm' como base da 'borda'. Devolve 0 em
+|              caso de sucesso.
+---------------------------------------------------------------------*/
+int     sobreposicaoGuardar(char const *dir, int N, int borda, double tol, int iteracoes,
+                            DoubleMatrix2D *m);
+
+void    sobreposicaoLibertar(double *dados, int N);
+
+/*--------------------------------------------------------------------
+| Function: sobreposicaoCombinar
+| Description: destino = soma de coef[b] * bases[b], em paralelo com
+|              'trab' tarefas, cada uma com um bloco de linhas
+---------------------------------------------------------------------*/
+void    sobreposicaoCombinar(DoubleMatrix2D *destino, double *bases[4], double const coef[4],
+                             int trab);
+
+#endif
@@ -0,0 +1,126 @@
+/*
+// heatTeste64 - aritmetica de indices e tamanhos acima de INT_MAX
+// Sistemas Operativos, DEI/IST/ULisboa 2017-18
+//
+// Com N > 46340 o numero de pontos ja' nao cabe num int. A matriz e' um
+// mapeamento anonimo esparso: so' as paginas escritas ocupam memoria,
+// pelo que o teste corre sem os 20 GB que a grelha teria. As mensagens
+// da mplib3 usam canais sem buffer, que nao copiam o envio, e a rececao
+// so' le o inicio da mensagem.
+*/
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <sys/mman.h>
+
+#include "matrix2d.h"
+#include "mplib3.h"
+
+// 50000 x 50000 pontos: 2.5e9 > INT_MAX
+#define LADO 50000L
+
+static int falhas = 0;
+
+/*--------------------------------------------------------------------
+| Function: verificar
+---------------------------------------------------------------------*/
+
+static void verificar(int ok, char const *descricao) {
+  printf("%-7s %s\n", ok ? "ok" : "FALHOU", descricao);
+  if (!ok)
+    falhas++;
+}
+
+/*--------------------------------------------------------------------
+| Function: mapear
+| Description: Reserva 'bytes' de memoria a zero, sem a ocupar
+---------------------------------------------------------------------*/
+
+static void *mapear(size_t bytes) {
+  void *p = mmap(NULL, bytes, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  return p == MAP_FAILED ? NULL : p;
+}
+
+/*--------------------------------------------------------------------
+| Function: testar_matriz
+---------------------------------------------------------------------*/
+
+static void testar_matriz(void) {
+  size_t         bytes = sizeof(double) * LADO * LADO;
+  DoubleMatrix2D m = { LADO, LADO, NULL };
+  int            l = 46341, c = 46341;   // l * LADO + c > INT_MAX
+
+  m.data = (double*) mapear(bytes);
+  if (m.data == NULL) {
+    printf("ignorado: nao foi possivel reservar %zu bytes\n", bytes);
+    return;
+  }
+  DoubleMatrix2D *mp = &m;
+
+  dm2dSetEntry(mp, l, c, 1.5);
+  verificar((char*) &dm2dGetEntry(mp, l, c) - (char*) m.data ==
+            (long) sizeof(double) * ((long) l * LADO + c),
+            "dm2dGetEntry: deslocamento de (46341, 46341)");
+  verificar(dm2dGetLine(mp, l) == m.data + (long) l * LADO && dm2dGetLine(mp, l)[c] == 1.5,
+            "dm2dGetLine: linha 46341");
+  verificar(&dm2dGetEntry(mp, LADO - 1, LADO - 1) == m.data + LADO * LADO - 1,
+            "dm2dGetEntry: ultimo ponto");
+
+  dm2dSetLineTo(mp, LADO - 1, 2.0);
+  verificar(m.data[LADO * LADO - 1] == 2.0 && m.data[(LADO - 1) * LADO] == 2.0 &&
+            m.data[(LADO - 1) * LADO - 1] == 0,
+            "dm2dSetLineTo: ultima linha, sem tocar na anterior");
+
+  dm2dSetColumnTo(mp, LADO - 1, 3.0);
+  verificar(m.data[LADO * LADO - 1] == 3.0 && m.data[(long) l * LADO + LADO - 1] == 3.0 &&
+            m.data[(long) l * LADO + LADO] == 0,
+            "dm2dSetColumnTo: ultima coluna, linhas acima de 46340");
+
+  munmap(m.data, bytes);
+}
+
+/*--------------------------------------------------------------------
+| Function: testar_mensagens
+| Description: Uma tarefa envia a si propria, sem buffer, uma mensagem
+|              com o tamanho de uma matriz acima de INT_MAX, cujo
+|              resto modulo 2^32 e' menor do que a rececao
+---------------------------------------------------------------------*/
+
+static void testar_mensagens(void) {
+  long   n_l = 65537, n_c = 8192;   // (2^16 + 1) * 2^13 doubles: 2^32 + 64K bytes
+  long   tamanho = n_l * n_c * (long) sizeof(double);
+  char  *msg = (char*) mapear(tamanho);
+  char   recebido[1 << 17];
+
+  if (msg == NULL) {
+    printf("ignorado: nao foi possivel reservar %ld bytes\n", tamanho);
+    return;
+  }
+  memset(msg, 7, sizeof(recebido));
+
+  inicializarMPlib(0, 1);
+  PedidoMP env = enviarMensagemAssinc(0, 0, msg, tamanho);
+  long r = receberMensagem(0, 0, recebido, sizeof(recebido));
+  long e = esperarPedido(&env);
+  libertarMPlib();
+
+  verificar(tamanho > INT_MAX && r == (long) sizeof(recebido) &&
+            recebido[sizeof(recebido) - 1] == 7,
+            "receberMensagem: copia o buffer todo de uma mensagem de 2^32+64K bytes");
+  verificar(e == tamanho, "esperarPedido: envio concluido com o tamanho de 64 bits");
+
+  munmap(msg, tamanho);
+}
+
+int main(void) {
+  testar_matriz();
+  testar_mensagens();
+  if (falhas > 0)
+    printf("%d verificacoes falharam\n", falhas);
+  return falhas > 0;
+}
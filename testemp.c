@@ -0,0 +1,122 @@
+/*
+// heatTesteMP - rececoes por etiqueta fora de ordem na mplib3
+// Sistemas Operativos, DEI/IST/ULisboa 2017-18
+//
+// Com canais de capacidade 1, o segundo envio fica pendente ate' haver
+// espaco. Uma rececao da etiqueta desse envio tem de o receber sem
+// esperar que a mensagem em fila seja consumida, e um envio para uma
+// rececao ja' registada nao pode ficar pendente. Tudo corre numa so'
+// tarefa, com envios assincronos; um impasse termina o teste pelo
+// alarme.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <unistd.h>
+
+#include "mplib3.h"
+
+#define LIMITE_SEGUNDOS 5
+
+static int falhas = 0;
+
+/*--------------------------------------------------------------------
+| Function: verificar
+---------------------------------------------------------------------*/
+
+static void verificar(int ok, char const *descricao) {
+  printf("%-7s %s\n", ok ? "ok" : "FALHOU", descricao);
+  if (!ok)
+    falhas++;
+}
+
+/*--------------------------------------------------------------------
+| Function: impasse
+| Description: Handler de SIGALRM: uma rececao ficou bloqueada
+---------------------------------------------------------------------*/
+
+static void impasse(int sinal) {
+  static char const msg[] = "FALHOU  impasse: rececao bloqueada\n";
+  if (write(STDOUT_FILENO, msg, sizeof(msg) - 1) < 0)
+    _exit(2);
+  _exit(1);
+}
+
+/*--------------------------------------------------------------------
+| Function: testar_pendente
+| Description: Envios com as etiquetas 1, 2, 2 de 0 para 1; recebem-se
+|              os de etiqueta 2, pela ordem, antes do de etiqueta 1
+---------------------------------------------------------------------*/
+
+static void testar_pendente(void) {
+  int      a = 1, b = 2, c = 3, r[3] = { 0, 0, 0 };
+  PedidoMP env[3];
+
+  inicializarMPlib(1, 2);
+  env[0] = enviarMensagemEtiqAssinc(0, 1, 1, &a, sizeof(int));
+  env[1] = enviarMensagemEtiqAssinc(0, 1, 2, &b, sizeof(int));
+  env[2] = enviarMensagemEtiqAssinc(0, 1, 2, &c, sizeof(int));
+  receberMensagemEtiq(0, 1, 2, &r[0], sizeof(int), NULL);
+  receberMensagemEtiq(0, 1, 2, &r[1], sizeof(int), NULL);
+  receberMensagemEtiq(0, 1, 1, &r[2], sizeof(int), NULL);
+  esperarTodos(env, 3, NULL);
+  libertarMPlib();
+
+  verificar(r[0] == b && r[1] == c && r[2] == a,
+            "etiqueta 2 recebida antes da 1 com o envio pendente, pela ordem");
+}
+
+/*--------------------------------------------------------------------
+| Function: testar_qualquer_origem
+| Description: Como testar_pendente, com a rececao de qualquer origem
+---------------------------------------------------------------------*/
+
+static void testar_qualquer_origem(void) {
+  int      a = 1, b = 2, r = 0, origem = -1;
+  PedidoMP env[2];
+
+  inicializarMPlib(1, 3);
+  env[0] = enviarMensagemEtiqAssinc(1, 2, 1, &a, sizeof(int));
+  env[1] = enviarMensagemEtiqAssinc(1, 2, 2, &b, sizeof(int));
+  receberMensagemEtiq(MP_QUALQUER_ORIGEM, 2, 2, &r, sizeof(int), &origem);
+  receberMensagemEtiq(1, 2, 1, &a, sizeof(int), NULL);
+  esperarTodos(env, 2, NULL);
+  libertarMPlib();
+
+  verificar(r == b && origem == 1, "qualquer origem: envio pendente da tarefa 1");
+}
+
+/*--------------------------------------------------------------------
+| Function: testar_rececao_registada
+| Description: A rececao da etiqueta 2 e' registada antes dos envios; o
+|              segundo envio, com o canal cheio, conclui-a logo
+---------------------------------------------------------------------*/
+
+static void testar_rececao_registada(void) {
+  int      a = 1, b = 2, r = 0, r1 = 0;
+  PedidoMP rec, env[2];
+
+  inicializarMPlib(1, 2);
+  rec    = receberMensagemEtiqAssinc(0, 1, 2, &r, sizeof(int), NULL);
+  env[0] = enviarMensagemEtiqAssinc(0, 1, 1, &a, sizeof(int));
+  env[1] = enviarMensagemEtiqAssinc(0, 1, 2, &b, sizeof(int));
+  int pronta = testarPedido(&rec, NULL);
+  receberMensagemEtiq(0, 1, 1, &r1, sizeof(int), NULL);
+  esperarPedido(&rec);
+  esperarTodos(env, 2, NULL);
+  libertarMPlib();
+
+  verificar(pronta && r == b && r1 == a, "envio com o canal cheio entregue 'a rececao registada");
+}
+
+int main(void) {
+  signal(SIGALRM, impasse);
+  alarm(LIMITE_SEGUNDOS);
+  testar_pendente();
+  testar_qualquer_origem();
+  testar_rececao_registada();
+  if (falhas > 0)
+    printf("%d verificacoes falharam\n", falhas);
+  return falhas > 0;
+}